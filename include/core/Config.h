@@ -22,12 +22,18 @@ public:
     float kFactor() const { return kFactor_; }
     float readyByTargetTemp() const { return readyByTargetTemp_; }
     float autoCalibTargetCapC() const { return autoCalibTargetCap_; }
+    uint8_t filterMode() const;                             // SampleFilter::Mode value
+    float filterGateC() const { return filterGateC_; }      // innovation gate, 0 = off
+    uint8_t aggregateMode() const;                          // AggregateMode value
+    uint8_t aggregateSensor() const;                        // sensor index for Named
+    float heaterPowerW() const { return heaterPowerW_; }    // learned from Shelly metering
 
     // Boolean getters
     bool deadzoneEnabled() const { return deadzoneEnabled_; }
     bool heaterTaskEnabled() const { return heaterTaskEnabled_; }
     bool readyByActive() const { return readyByActive_; }
     bool autoCalibrationEnabled() const { return autoCalibrationEnabled_; }
+    bool recordingEnabled() const { return recordingEnabled_; }
     uint16_t autoCalibStartMin() const;
     uint16_t autoCalibEndMin() const;
 
@@ -44,11 +50,17 @@ public:
     void setKFactor(float v);
     void setReadyByTargetTemp(float v);
     void setAutoCalibTargetCapC(float v);
+    void setFilterMode(uint8_t mode);
+    void setFilterGateC(float v);
+    void setAggregateMode(uint8_t mode);
+    void setAggregateSensor(uint8_t index);
+    void setHeaterPowerW(float v);
     // Boolean setters
     void setDeadzoneEnabled(bool v);
     void setHeaterTaskEnabled(bool v);
     void setReadyByActive(bool v);
     void setAutoCalibrationEnabled(bool v);
+    void setRecordingEnabled(bool v);
     void setAutoCalibStartMin(uint16_t m);
     void setAutoCalibEndMin(uint16_t m);
     // uint64 setters
@@ -107,12 +119,18 @@ private:
     float autoCalibStartMinF_;
     float autoCalibEndMinF_;
     float autoCalibTargetCap_;
+    float filterModeF_; // stored as float enum value
+    float filterGateC_;
+    float aggregateModeF_;   // stored as float enum value
+    float aggregateSensorF_; // stored as float index
+    float heaterPowerW_;
 
     // booleans (persisted via BOOL_FIELDS)
     bool deadzoneEnabled_;
     bool heaterTaskEnabled_;
     bool readyByActive_;
     bool autoCalibrationEnabled_;
+    bool recordingEnabled_;
 
     // uint64s (persisted via UINT64_FIELDS)
     uint64_t readyByTargetEpochUtc_;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include <initializer_list>
+#include <type_traits>
+
+// Log entries are stored as compact binary records and only turned into
+// text when read (/api/logs, the WebSocket feed, Serial dumps):
+//
+//   [u32 UTC seconds, 0 = time unknown][u8 LogEvent][u8 argc][args...]
+//
+// Each arg is a type byte followed by 4 little-endian bytes, or by a
+// length byte and the characters for Str. Producers pass the raw values;
+// the format table in LogEvents.cpp holds the text around them.
+enum class LogEvent : uint8_t
+{
+    Text = 0,           // {text}; free-form or migrated lines
+    Tagged,             // [tag] message
+    HeaterOn,           // current °C, target °C
+    HeaterOff,          // current °C, target °C
+    DeadzoneEnter,
+    DeadzoneExit,
+    ActuatorOn,         // name
+    ActuatorOff,        // name
+    ActuatorOnAt,       // name, sensor, °C
+    ActuatorOffAt,      // name, sensor, °C
+    WdHeaterRestart,
+    WdEspRestartHeater,
+    WdEspRestartLink,
+    WdWifiReconnect,
+    WdShellyReconnect,
+    WdShellyRestart,
+    ReadyByScheduled,   // target epoch, target °C
+    ReadyByPastTarget,  // reached °C, target °C
+    ReadyByForceOn,     // ambient °C, target °C, warmup s
+    ReadyByReachedEarly,// target °C, minutes early, ambient °C
+    ReadyBySlow,        // observed, predicted °C/min, minutes late
+    LogDropped,         // lines
+    Count
+};
+
+struct LogArg
+{
+    enum class Type : uint8_t
+    {
+        U32 = 0,
+        I32 = 1,
+        F32 = 2,
+        Str = 3,
+        Epoch = 4 // UTC seconds, rendered as a date
+    };
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogArg(T v) : type(std::is_signed<T>::value ? Type::I32 : Type::U32)
+    {
+        if (std::is_signed<T>::value)
+            i = static_cast<int32_t>(v);
+        else
+            u = static_cast<uint32_t>(v);
+    }
+    LogArg(float v) : type(Type::F32), f(v) {}
+    LogArg(double v) : type(Type::F32), f(static_cast<float>(v)) {}
+    LogArg(const char *s) : type(Type::Str), str(s ? s : ""), len(strlen(str)) {}
+    LogArg(const String &s) : type(Type::Str), str(s.c_str()), len(s.length()) {}
+    LogArg(const char *s, size_t n) : type(Type::Str), str(s), len(n) {}
+
+    static LogArg epoch(uint64_t utc)
+    {
+        LogArg a(static_cast<uint32_t>(utc));
+        a.type = Type::Epoch;
+        return a;
+    }
+
+    Type type;
+    union
+    {
+        uint32_t u;
+        int32_t i;
+        float f;
+        const char *str;
+    };
+    size_t len = 0; // Str only
+};
+
+// Encode one record into out (at most outSize bytes, Str args are
+// truncated to fit). Returns the record length.
+size_t encodeLogRecord(uint8_t *out, size_t outSize, uint32_t utc, LogEvent event,
+                       std::initializer_list<LogArg> args);
+
+// Timestamp of a record (0 if unknown or malformed)
+uint32_t logRecordUtc(const uint8_t *rec, size_t len);
+
+// Render a record as "YYYY-MM-DD HH:MM:SS <text>" (local time) into out,
+// always NUL-terminated. Returns the text length.
+size_t renderLogRecord(const uint8_t *rec, size_t len, char *out, size_t outSize);
@@ -3,39 +3,170 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <atomic>
 #include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
+#include "core/LogEvents.h"
+#include "core/LogStore.h"
+
+// Any task may log: the entry is encoded as a binary record (LogEvents.h)
+// into a slot of a lock-free multi-producer queue and the producer
+// returns without ever blocking or formatting text. A single logger task
+// drains the queue, numbers each entry, keeps the newest ones in a RAM
+// ring of fixed-size pages, hands each entry rendered as text to the
+// callback (WebSocket fan-out) and appends the entries to the LittleFS
+// history (LogStore) FLUSH_INTERVAL_MS after the first unsaved one or
+// once FLUSH_LINES are pending. When the queue is full the entry is
+// dropped, counted and reported in the log.
 class LogManager {
 public:
     LogManager();
 
-    using LogCallback = std::function<void(const String &)>;
+    using LogCallback = std::function<void(uint32_t seq, const String &)>;
 
+    // Runs on the logger task, one call per entry with its sequence number
+    // and rendered text
     void setCallback(LogCallback cb) { callback_ = cb; }
 
-    bool begin();  // call in setup()
+    // Call in setup(), after LittleFS is mounted: opens the history and
+    // preloads its newest entries into RAM
+    bool begin();
+
+    // Create the logger task (call after begin())
+    void start(uint32_t stackSize = 4096, UBaseType_t priority = 1);
+
+    // Log an event with its raw args, timestamped now. Never blocks; safe
+    // from any task.
+    void event(LogEvent id, std::initializer_list<LogArg> args = {});
+
+    // Free-form line (no newline, no timestamp needed); a Text event.
+    // Text beyond what fits in MAX_RECORD_LEN is truncated.
+    void append(const String& line) { event(LogEvent::Text, {line}); }
+
+    // "[tag] message" without building the combined string
+    void tagged(const char *tag, const String &msg) { event(LogEvent::Tagged, {tag, msg}); }
 
-    // Append a log line (no newline needed)
-    void append(const String& line);
+    // Store and persist every queued entry now (e.g. right before
+    // esp_restart()). Waits up to REQUEST_WAIT_MS for the logger task.
+    void flush();
 
-    // Dump all logs in time order to Serial (for debugging)
+    // Dump the RAM entries in time order to Serial (for debugging)
     void dumpToSerial() const;
 
-    String toStringNewestFirst(uint16_t maxLines = 0) const;
+    // Whole history: the stored entries, then those still only in RAM.
+    // 0 when empty.
+    uint32_t firstSeq() const;
+    uint32_t lastSeq() const;
 
+    // Visit up to maxCount entries in ascending order from cursor.seq,
+    // advancing the cursor; fn returns false to stop. Safe from any task.
+    size_t read(LogStore::Cursor &cursor, size_t maxCount, const LogStore::RecordFn &fn) const;
+
+    // Drop RAM and stored history; numbering continues
     void clear();
 
+    const LogStore &store() const { return store_; }
+
+    // Diagnostics
+    uint32_t syncs() const { return syncs_; }
+    uint16_t pendingLines() const { return unflushed_; }
+    uint32_t droppedLines() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static constexpr size_t   PAGE_COUNT        = 6;
+    static constexpr size_t   PAGE_BYTES        = 1024;
+    static constexpr size_t   MAX_RECORD_LEN    = 255;
+    static constexpr size_t   MAX_TEXT_LEN      = 320;  // one rendered entry
+    static constexpr uint16_t FLUSH_LINES       = 16;
+    static constexpr uint32_t FLUSH_INTERVAL_MS = 60000;
+    static constexpr uint32_t REQUEST_WAIT_MS   = 1000;
+    static constexpr uint32_t QUEUE_SLOTS       = 16;   // power of two
+
 private:
+    // Records are framed as [len][record][len]: the trailing length lets
+    // the readers walk a page backwards for newest-first output.
+    struct Page {
+        uint32_t firstSeq;   // sequence number of the first record
+        uint16_t used;       // bytes of data[] in use
+        uint16_t count;      // records in this page, 0 = empty
+        uint8_t  data[PAGE_BYTES - 8];
+    };
+    static_assert(sizeof(Page) == PAGE_BYTES, "old NVS pages are read as raw bytes");
+
+    // Bounded MPMC queue cell (Vyukov): seq == position means free for the
+    // producer claiming that position, seq == position + 1 means filled.
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        uint8_t len;
+        uint8_t rec[MAX_RECORD_LEN];
+    };
+    static_assert((QUEUE_SLOTS & (QUEUE_SLOTS - 1)) == 0, "QUEUE_SLOTS must be a power of two");
+
+    // Work other tasks hand to the logger task
+    enum Request : uint8_t {
+        REQ_FLUSH = 1,
+        REQ_CLEAR = 2,
+    };
+
     LogCallback callback_;
-    
-    static constexpr const char* NAMESPACE    = "logs";
-    static constexpr const char* KEY_HEAD     = "head";
-    static constexpr const char* KEY_COUNT    = "count";
-    static constexpr uint16_t    MAX_ENTRIES  = 50; // tune this
 
-    mutable Preferences prefs_;
-    uint16_t head_;   // next index to write [0..MAX_ENTRIES-1]
-    uint16_t count_;  // number of stored entries [0..MAX_ENTRIES]
+    // Earlier NVS formats, moved into the LogStore once by begin(): one
+    // string per line (e000.., head/count), text pages (p0..) and binary
+    // pages (b0..)
+    static constexpr const char* NAMESPACE       = "logs";
+    static constexpr const char* KEY_HEAD        = "head";
+    static constexpr const char* KEY_COUNT       = "count";
+    static constexpr uint16_t    OLD_MAX_ENTRIES = 50;
+    static constexpr uint8_t     OLD_PAGE_COUNT  = 6;
+
+    // Newest stored entries loaded into RAM at boot
+    static constexpr size_t PRELOAD_ENTRIES = 256;
+
+    LogStore store_;
+    bool ready_;
+
+    Page pages_[PAGE_COUNT];
+    uint8_t head_;          // page receiving appends
+    std::atomic<uint32_t> storedSeq_; // newest entry handed to store_
+    uint16_t unflushed_;    // entries not yet in store_
+    uint32_t syncs_;
+    uint32_t dirtySinceMs_; // when the oldest unsaved entry was stored
+
+    Slot slots_[QUEUE_SLOTS];
+    std::atomic<uint32_t> enqueuePos_;
+    uint32_t dequeuePos_;   // logger task only
+    std::atomic<uint32_t> dropped_;
+    uint32_t droppedReported_;
+
+    // Pages and store_ are written by the logger task only (begin() runs
+    // before it exists); mutex_ guards the pages against the readers.
+    // requestMutex_ serializes flush()/clear() callers; requestDone_ is
+    // given by the logger task once their request is handled.
+    SemaphoreHandle_t mutex_;
+    SemaphoreHandle_t requestMutex_;
+    SemaphoreHandle_t requestDone_;
+    std::atomic<uint8_t> requests_;
+    TaskHandle_t handle_;
+
+    static void taskEntry(void *pvParameters);
+    void run();
+
+    void request(Request req);
+    void handleRequests(uint8_t reqs);
+    uint32_t appendLocked(const uint8_t *rec, size_t len, uint32_t seq = 0);
+    uint32_t nextSeqLocked() const;
+    void resetLocked(uint32_t nextSeq);
+    void drain();
+    void store(const uint8_t *rec, size_t len);
+    void persist();
+    void preload();
+    void migrateNvs(Preferences &prefs);
+    void migrateRecord(const uint8_t *rec, size_t len);
+    void migrateText(const char *text, size_t len);
 
-    String makeKey(uint16_t index) const;
+    // fn(seq, record, len) returns false to stop
+    template <typename Fn>
+    static bool forEachInPage(const Page &page, Fn fn);
 };
@@ -0,0 +1,113 @@
+// LogStore.h
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Append-only log history on LittleFS, split into fixed-size segment files
+// under DIR. Each segment is a SegmentHeader followed by records framed as
+// [len][record][len], the same framing as LogManager's RAM pages. Entries
+// are numbered by a sequence number that only grows; within a segment
+// they are consecutive from header.firstSeq.
+//
+// A RAM index (one Segment per file, oldest first) holds each segment's
+// first sequence number and a non-decreasing timestamp, so seekSeq() and
+// seekTime() binary-search it and then scan at most one segment. Appends
+// go to the tail segment only; when it is full a new one is started and
+// the oldest is deleted once MAX_SEGMENTS exist, which bounds flash use
+// to MAX_SEGMENTS * SEGMENT_BYTES.
+class LogStore {
+public:
+    static constexpr const char* DIR           = "/logs";
+    static constexpr uint32_t    SEGMENT_BYTES = 32 * 1024;
+    static constexpr size_t      MAX_SEGMENTS  = 16; // ~20k typical entries
+
+    // Called per entry; return false to stop
+    using RecordFn = std::function<bool(uint32_t seq, const uint8_t *rec, size_t len)>;
+
+    struct Stats {
+        uint8_t  segments;
+        uint32_t bytes;
+        uint32_t firstSeq;  // 0 when empty
+        uint32_t lastSeq;
+    };
+
+    // Resumable read position: the next sequence number to visit and,
+    // once a read has passed through a segment, where it is in that file.
+    // Only seq needs setting; the rest lets the next read() continue
+    // without rescanning the segment.
+    struct Cursor {
+        uint32_t seq = 0;
+        uint32_t segId = UINT32_MAX;
+        uint32_t offset = 0;
+    };
+
+    LogStore();
+
+    // Scan DIR and build the index (LittleFS must be mounted)
+    bool begin();
+
+    // Append one record with its sequence number (> lastSeq(); a gap
+    // starts a new segment). Writes go to the tail file; call sync() after
+    // a batch.
+    bool append(uint32_t seq, uint32_t utc, const uint8_t *rec, size_t len);
+    void sync();
+
+    // Delete every segment; numbering continues at nextSeq
+    void clear(uint32_t nextSeq);
+
+    uint32_t firstSeq() const;  // 0 when empty
+    uint32_t lastSeq() const;   // 0 when empty
+
+    // First stored sequence number >= seq / with timestamp >= utc, or 0
+    uint32_t seekSeq(uint32_t seq) const;
+    uint32_t seekTime(uint32_t utc) const;
+
+    // Visit up to maxCount entries in ascending order, starting at the
+    // first one >= fromSeq. Returns the number visited.
+    size_t read(uint32_t fromSeq, size_t maxCount, const RecordFn &fn) const;
+
+    // Same, continuing at cursor and advancing it past each visited entry
+    size_t read(Cursor &cursor, size_t maxCount, const RecordFn &fn) const;
+
+    Stats stats() const;
+
+private:
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t firstSeq;
+        uint32_t firstUtc;  // running max of timestamps when it was started
+    };
+
+    struct Segment {
+        uint32_t id;        // file name, grows by one per segment
+        uint32_t firstSeq;
+        uint32_t firstUtc;
+        uint32_t bytes;     // file size, header included
+        uint32_t count;     // entries (only exact for scanned segments)
+    };
+
+    static constexpr uint32_t MAGIC = 0x31474F4C; // "LOG1"
+
+    static void segmentPath(uint32_t id, char *buf, size_t size);
+    bool startSegmentLocked(uint32_t firstSeq);
+    void dropOldestLocked();
+    uint32_t scanLocked(Segment &seg);
+    int findSegmentLocked(uint32_t seq) const;
+    size_t readSegmentLocked(const Segment &seg, Cursor &cursor, size_t maxCount,
+                             const RecordFn &fn, bool &stopped) const;
+
+    Segment segs_[MAX_SEGMENTS];
+    uint8_t count_;         // segments in use, segs_[0] oldest
+    uint32_t nextId_;       // never reused, so a stale Cursor cannot match
+    uint32_t maxUtc_;       // newest timestamp seen
+    bool ready_;
+    // Tail segment opened for append, closed by sync() and before reads
+    mutable File tail_;
+
+    // Guards the index and the files against reader tasks
+    SemaphoreHandle_t mutex_;
+};
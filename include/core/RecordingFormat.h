@@ -0,0 +1,90 @@
+#pragma once
+
+// On-disk layout of sensor recordings (see SampleRecorder). Shared with the
+// host replay tool in scripts/replay, so this header must stay free of
+// Arduino / ESP-IDF dependencies.
+//
+//   FileHeader
+//   { BlockHeader, Record[count] } ...
+//
+// Blocks are appended whole. Within a block each record stores the
+// milliseconds since the previous record; the block header holds the
+// absolute millis() of its first record. A gap that does not fit in 16 bits
+// simply starts a new block. A torn or corrupted block fails its CRC and is
+// skipped by readers without losing the rest of the file.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace recording
+{
+constexpr uint32_t FILE_MAGIC = 0x43524843; // "CHRC" little-endian
+constexpr uint16_t FILE_VERSION = 1;
+constexpr uint16_t BLOCK_MAGIC = 0xB10C;
+constexpr uint16_t RECORDS_PER_BLOCK = 64;
+
+// Record::sensor value for the aggregate control temperature
+constexpr uint8_t SENSOR_AGGREGATE = 0xFF;
+
+enum class RecordType : uint8_t
+{
+  Sample = 0,   // one sensor (or the aggregate) at one sampler cycle
+  RelayOn = 1,  // heater switched on
+  RelayOff = 2  // heater switched off
+};
+
+#pragma pack(push, 1)
+struct FileHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;      // sizeof(Record), lets readers reject foreign layouts
+  uint16_t recordsPerBlock; // upper bound; partial blocks are allowed
+  uint16_t reserved;
+  uint64_t startEpochUtc;   // wall clock at file creation, 0 if not synced
+  uint32_t startMs;         // millis() at file creation
+  uint32_t reserved2;
+};
+
+struct BlockHeader
+{
+  uint16_t magic;
+  uint16_t count;   // records that follow
+  uint32_t firstMs; // millis() of the first record
+  uint32_t crc32;   // over magic, count, firstMs and the records
+};
+
+struct Record
+{
+  uint16_t dtMs;      // since the previous record in this block
+  uint8_t type;       // RecordType
+  uint8_t sensor;     // registry index or SENSOR_AGGREGATE
+  int16_t rawCentiC;  // unfiltered (samples only)
+  int16_t centiC;     // filtered (samples only)
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 28, "FileHeader layout changed");
+static_assert(sizeof(BlockHeader) == 12, "BlockHeader layout changed");
+static_assert(sizeof(Record) == 8, "Record layout changed");
+
+// CRC-32 (IEEE, reflected), bitwise: blocks are small and written rarely
+inline uint32_t crc32(const void *data, size_t len, uint32_t crc = 0)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  crc = ~crc;
+  while (len--)
+  {
+    crc ^= *p++;
+    for (int i = 0; i < 8; ++i)
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+inline uint32_t blockCrc(const BlockHeader &h, const Record *records)
+{
+  uint32_t crc = crc32(&h, offsetof(BlockHeader, crc32));
+  return crc32(records, sizeof(Record) * h.count, crc);
+}
+} // namespace recording
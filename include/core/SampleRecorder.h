@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "core/RecordingFormat.h"
+#include "io/measurements.h"
+
+// SampleRecorder: append-only binary recording of sensor samples and relay
+// transitions on LittleFS, for offline replay (scripts/replay).
+//
+// Producers (sampler callback, heater relay callback) only fill a RAM block
+// under a spinlock. Full blocks are handed to a low-priority writer task,
+// so flash latency never reaches the sampler. flush() is a request to the
+// same task, so web handlers never write flash on the async_tcp task
+// either. The file rotates to
+// OLD_PATH at MAX_FILE_BYTES, which bounds flash use to twice that.
+class SampleRecorder
+{
+public:
+  static constexpr const char *PATH = "/rec.bin";
+  static constexpr const char *OLD_PATH = "/rec.old.bin";
+  static constexpr size_t MAX_FILE_BYTES = 256 * 1024;
+  static constexpr uint32_t FLUSH_WAIT_MS = 1000;
+
+  struct Stats
+  {
+    bool enabled;
+    uint32_t fileBytes;
+    uint32_t blocksWritten;
+    uint32_t blocksDropped; // writer fell behind or the FS write failed
+    uint16_t pending;       // records buffered in RAM
+  };
+
+  SampleRecorder();
+
+  // Creates the writer task. Recording stays off until setEnabled(true).
+  void start(uint32_t stackSize = 3072, UBaseType_t priority = 1);
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const { return enabled_; }
+
+  // Producers; cheap and non-blocking
+  void addSample(const Measurements &m);
+  void addRelay(bool on, uint32_t timestampMs);
+
+  // Has the writer task write the partial block now (e.g. before a
+  // download or reboot). Waits up to FLUSH_WAIT_MS for it.
+  void flush();
+
+  Stats stats() const;
+
+private:
+  struct Block
+  {
+    recording::BlockHeader header;
+    recording::Record records[recording::RECORDS_PER_BLOCK];
+  };
+
+  static void taskEntry(void *pvParameters);
+  void run();
+
+  void appendLocked(recording::RecordType type, uint8_t sensor,
+                    int32_t rawCentiC, int32_t centiC, uint32_t timestampMs);
+  void sealLocked();
+  void writePending(Block &scratch);
+  bool writeBlock(Block &block);
+  bool ensureFile(size_t nextBytes);
+
+  TaskHandle_t task_ = nullptr;
+  SemaphoreHandle_t fileMutex_ = nullptr;
+  // requestMutex_ serializes flush() callers; flushDone_ is given by the
+  // writer task once their request is handled
+  SemaphoreHandle_t requestMutex_ = nullptr;
+  SemaphoreHandle_t flushDone_ = nullptr;
+  std::atomic<bool> flushRequested_{false};
+  mutable portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+
+  volatile bool enabled_ = false;
+
+  Block active_{};
+  uint32_t lastMs_ = 0;
+  Block sealed_{};
+  bool sealedFull_ = false;
+
+  uint32_t fileBytes_ = 0;
+  uint32_t blocksWritten_ = 0;
+  uint32_t blocksDropped_ = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// TemperatureHistory: fixed-memory, multi-resolution temperature store.
+//
+//  - Tier 0: every sample (1 s sampler cadence)  x 600  = last 10 min
+//  - Tier 1: 1 min buckets (mean/min/max/duty)     x 1440 = last 24 h
+//  - Tier 2: 15 min buckets                        x 2880 = last 30 days
+//
+// All storage is inline (no heap); FOOTPRINT_BYTES is the whole cost.
+// append() is O(1): each tier rolls up into the next through a running
+// accumulator as its bucket closes. Safe to append from one task while
+// other tasks read.
+class TemperatureHistory
+{
+public:
+  enum class Tier : uint8_t
+  {
+    Raw = 0,
+    Minute = 1,
+    Quarter = 2
+  };
+
+  struct Sample
+  {
+    int16_t centiC;
+    uint8_t flags; // FLAG_HEATER_ON
+    uint8_t reserved;
+  };
+
+  struct Bucket
+  {
+    int16_t meanCentiC;
+    int16_t minCentiC;
+    int16_t maxCentiC;
+    uint8_t heaterOnPct; // share of samples with the heater on, 0..100
+    uint8_t reserved;
+  };
+
+  static constexpr uint8_t FLAG_HEATER_ON = 0x01;
+
+  static constexpr size_t RAW_CAPACITY = 600;
+  static constexpr size_t MINUTE_CAPACITY = 1440;
+  static constexpr size_t QUARTER_CAPACITY = 2880;
+  static constexpr uint32_t MINUTE_MS = 60UL * 1000UL;
+  static constexpr uint8_t MINUTES_PER_QUARTER = 15;
+
+  static constexpr size_t FOOTPRINT_BYTES =
+      RAW_CAPACITY * sizeof(Sample) +
+      (MINUTE_CAPACITY + QUARTER_CAPACITY) * sizeof(Bucket);
+
+  TemperatureHistory();
+
+  // Feed one sample (normally from the measurement callback)
+  void append(int32_t centiC, bool heaterOn, uint32_t timestampMs);
+
+  // Number of stored entries in a tier
+  size_t size(Tier tier) const;
+
+  // Entry by age, 0 = newest. Returns false if out of range.
+  // Raw samples are reported as a Bucket with mean == min == max.
+  bool at(Tier tier, size_t age, Bucket &out) const;
+
+  // millis() of the newest entry in a tier (0 if empty)
+  uint32_t newestMs(Tier tier) const;
+
+  // Nominal spacing of a tier's entries, in seconds
+  static uint32_t intervalSeconds(Tier tier);
+
+private:
+  // Running rollup for the bucket currently being filled
+  struct Accumulator
+  {
+    int32_t sum = 0;
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    uint32_t onCount = 0;
+    uint32_t count = 0;
+    uint32_t startMs = 0;
+
+    void add(int32_t sumCentiC, uint32_t n, int16_t lo, int16_t hi, uint32_t on);
+    Bucket close() const;
+  };
+
+  template <typename T, size_t N>
+  struct Ring
+  {
+    T items[N];
+    size_t head = 0; // next write position
+    size_t count = 0;
+    uint32_t newestMs = 0;
+
+    void push(const T &item, uint32_t ms)
+    {
+      items[head] = item;
+      head = (head + 1) % N;
+      if (count < N)
+        ++count;
+      newestMs = ms;
+    }
+    const T &fromNewest(size_t age) const { return items[(head + N - 1 - age) % N]; }
+  };
+
+  Ring<Sample, RAW_CAPACITY> raw_;
+  Ring<Bucket, MINUTE_CAPACITY> minutes_;
+  Ring<Bucket, QUARTER_CAPACITY> quarters_;
+
+  Accumulator minuteAcc_;
+  Accumulator quarterAcc_;
+  uint8_t minutesInQuarter_ = 0;
+
+  mutable portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "core/Config.h"
+#include "core/LogManager.h"
+#include "heating/HeaterTask.h"
+#include "heating/Thermostat.h"
+#include "io/ShellyHandler.h"
+
+// Drives the auxiliary heater outputs (engine block heater, battery
+// warmer, ...) next to the cabin heater that HeaterTask owns.
+//
+// Each actuator is a named relay output with its own ShellyHandler (a
+// separate Shelly or one channel of a multi-channel one), a schedule that
+// says when it may run, and an optional thermostat bound to one registered
+// sensor by name. Without a sensor binding it simply follows the schedule;
+// with one it also needs that sensor below target (and a valid reading).
+// The cabin deadzone applies to every actuator.
+//
+// The tick only reads cached relay state and queues commands. Each
+// ShellyHandler's worker does its own network I/O, so the outputs are
+// polled and switched concurrently and adding one does not lengthen the
+// tick. Settings are kept per actuator as a raw blob in NVS.
+class ActuatorTask
+{
+public:
+    enum class Schedule : uint8_t
+    {
+        Off = 0,
+        Always = 1,
+        Window = 2,  // daily local-time window [startMin, endMin), may wrap midnight
+        ReadyBy = 3  // the last leadMin minutes before the Ready-By target
+    };
+
+    struct Settings
+    {
+        uint8_t schedule = 0;          // Schedule
+        uint8_t reserved = 0;
+        uint16_t startMin = 0;         // Window, [0..1439]
+        uint16_t endMin = 0;
+        uint16_t leadMin = 120;        // ReadyBy
+        int16_t targetDeciC = 50;      // thermostat target, 0.1 °C
+        uint16_t hysteresisDeciC = 10; // 0.1 °C
+        char sensor[12] = {};          // bound sensor name, "" = schedule only
+    };
+    static_assert(sizeof(Settings) == 24, "Settings is persisted as raw bytes");
+
+    struct Status
+    {
+        const char *name;
+        const ShellyHandler *shelly;
+        Settings settings;
+        bool scheduled;  // schedule allows running right now
+        bool wantOn;     // last decision of the tick
+        bool isOn;       // relay state as last confirmed/commanded
+        float sensorC;   // bound sensor, NAN if none or invalid
+    };
+
+    static constexpr size_t MAX_ACTUATORS = 3;
+
+    ActuatorTask(Config &config, HeaterTask &heaterTask, LogManager &logManager);
+
+    // Register an output. Call from setup(), before start(). name is also
+    // the NVS key, so at most 15 characters.
+    bool add(const char *name, ShellyHandler &shelly);
+
+    // Load settings and create the FreeRTOS task (no-op without actuators)
+    void start(uint32_t stackSize = 3072, UBaseType_t priority = 1);
+
+    size_t count() const { return count_; }
+    int find(const char *name) const; // -1 if unknown
+    bool status(size_t index, Status &out) const;
+
+    // Validates, applies and persists. Returns false for a bad index.
+    bool setSettings(size_t index, const Settings &settings);
+
+    static const char *scheduleName(Schedule schedule);
+
+private:
+    struct Actuator
+    {
+        const char *name = nullptr;
+        ShellyHandler *shelly = nullptr;
+        Settings settings;
+        Thermostat thermostat{0.0f, 0.0f};
+        bool dirty = true; // settings changed; thermostat not updated yet
+        bool scheduled = false;
+        bool wantOn = false;
+        bool isOn = false;
+        float sensorC = NAN;
+    };
+
+    static void taskEntry(void *pvParameters);
+    void run();
+
+    void tick(Actuator &a);
+    bool scheduleAllows(const Settings &s) const;
+    static Settings sanitize(const Settings &s);
+    void onSwitchDone(const char *name, bool on, ShellyHandler::Result result) const;
+    void log(const String &msg) const;
+
+    Config &config_;
+    HeaterTask &heaterTask_;
+    LogManager &logger_;
+    Preferences prefs_;
+
+    Actuator actuators_[MAX_ACTUATORS];
+    size_t count_ = 0;
+    // Guards settings (written by web handlers) and the status fields
+    mutable portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+
+    // Relay state older than this many Shelly poll periods is not trusted
+    static constexpr uint32_t RELAY_STALE_PERIODS = 3;
+
+    TaskHandle_t handle_ = nullptr;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <array>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "core/Config.h"
+#include "io/ShellyHandler.h"
+
+// Per-heating-session energy accounting from the Shelly's metering.
+//
+// A session is either owned (ReadyBy run, calibration run: begin()/end()
+// from the owner) or a thermostat session, which opens on the first relay
+// ON while nothing else is open and closes once the relay has been off for
+// THERMOSTAT_GAP_MS, so one session spans a cluster of on/off cycles.
+//
+// Energy comes from the aenergy.total counter where the device has one;
+// otherwise apower (or, without metering, Config::heaterPowerW) is
+// integrated over the relay on-time. Finished sessions are kept as compact
+// records in NVS, and the mean power measured while on is blended into
+// Config::heaterPowerW so warm-up estimates follow the real wattage.
+class EnergyMeter
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Thermostat = 0,
+        ReadyBy = 1,
+        Calibration = 2
+    };
+
+    // How the session energy was obtained (worst source used wins)
+    enum class Source : uint8_t
+    {
+        Counter = 0,    // aenergy.total deltas
+        Integrated = 1, // apower x time
+        Assumed = 2     // configured wattage x on-time
+    };
+
+    struct Session
+    {
+        uint32_t startEpochUtc; // 0 if time was not set
+        uint32_t durationS;
+        uint32_t onS;
+        uint32_t energyDeciWh;  // 0.1 Wh
+        uint16_t avgOnW;        // mean power while on, 0 = unknown
+        uint8_t kind;           // Kind
+        uint8_t source;         // Source
+    };
+    static_assert(sizeof(Session) == 20, "Session is persisted as raw bytes");
+
+    static constexpr size_t MAX_SESSIONS = 16;
+
+    struct Snapshot
+    {
+        bool open;
+        Session current;     // running totals of the open session
+        size_t count;
+        std::array<Session, MAX_SESSIONS> sessions; // newest first
+    };
+
+    explicit EnergyMeter(Config &config);
+
+    // Load stored sessions; call once from setup
+    void begin();
+
+    // Feed the relay state and the latest Shelly reading (HeaterTask loop)
+    void tick(uint32_t nowMs, bool relayOn, const ShellyStatus &status);
+
+    // Owned sessions. begin() closes whatever is open first; end() only
+    // closes a session of the same kind.
+    void beginSession(Kind kind);
+    void endSession(Kind kind);
+
+    // Mean power while on of the open session, NAN if not metered yet
+    float currentAvgOnW() const;
+
+    Snapshot snapshot() const;
+
+    static const char *kindName(uint8_t kind);
+    static const char *sourceName(uint8_t source);
+
+private:
+    void openLocked(Kind kind, uint32_t nowMs);
+    void closeLocked(uint32_t endMs);
+    Session currentLocked(uint32_t endMs) const;
+    void saveLocked();
+
+    Config &config_;
+    Preferences prefs_;
+    SemaphoreHandle_t mutex_ = nullptr;
+
+    std::array<Session, MAX_SESSIONS> sessions_{};
+    size_t count_ = 0;
+
+    // Open session state
+    bool open_ = false;
+    Kind kind_ = Kind::Thermostat;
+    uint32_t startEpochUtc_ = 0;
+    uint32_t startMs_ = 0;
+    uint32_t lastTickMs_ = 0;
+    uint32_t lastOnMs_ = 0;
+    uint32_t onMs_ = 0;
+    bool lastRelayOn_ = false;
+    float energyWh_ = 0.0f;
+    float lastCounterWh_ = NAN;
+    float powerSumW_ = 0.0f;
+    uint32_t powerSamples_ = 0;
+    Source source_ = Source::Counter;
+
+    static constexpr uint32_t THERMOSTAT_GAP_MS = 30UL * 60UL * 1000UL;
+    static constexpr uint32_t MIN_SAVE_ON_S = 60;     // shorter sessions are dropped
+    static constexpr uint32_t MIN_POWER_SAMPLES = 6;  // before the wattage is learned
+    static constexpr float LEARN_WEIGHT = 0.5f;       // blend of a session into Config
+};
@@ -9,12 +9,15 @@
 #include "core/LogManager.h"
 #include "io/LedManager.h"
 
+class EnergyMeter;
+
 // Wrapper around the FreeRTOS heater control task
 class HeaterTask
 {
 public:
     using KickCallback = std::function<void(void)>;
     using wsTempUpdateCallback = std::function<void()>;
+    using RelayCallback = std::function<void(bool on)>;
 
     HeaterTask(Config &config,
                Thermostat &thermostat,
@@ -33,6 +36,12 @@ public:
 
     void setWsTempUpdateCallback(wsTempUpdateCallback cb) { wsTempUpdateCallback_ = cb; }
 
+    // Called whenever the commanded relay state changes (any caller)
+    void setRelayCallback(RelayCallback cb) { relayCallback_ = cb; }
+
+    // Optional: fed the relay state and Shelly metering every loop
+    void setEnergyMeter(EnergyMeter *meter) { energy_ = meter; }
+
     void setEnabled(bool enabled);
     bool isEnabled() const { return enabled_; }
 
@@ -43,6 +52,8 @@ public:
     float currentTemp() const { return currentTemp_; }
     bool isHeaterOn() const { return isHeaterOn_; }
 
+    // Queue a relay command on the Shelly worker; never blocks on the
+    // network. Returns false if the command was refused (deadzone).
     bool turnHeaterOn(bool force = false);
     bool turnHeaterOff();
 
@@ -65,9 +76,8 @@ private:
     void run();
 
     // Helpers
-    String logHeaterChange(bool isOn, float currentTemp) const;
-    String logDZChange(bool inDZ) const;
-    String log(const String &msg) const;
+    void onSwitchDone(bool on, ShellyHandler::Result result) const;
+    void log(const String &msg) const;
 
     Config &config_;
     Thermostat &thermostat_;
@@ -75,14 +85,24 @@ private:
     LogManager &logger_;
     LedManager &led_;
 
+    // Slack on top of measurementWaitMs() for reading the sensors out and
+    // publishing when waiting for the sample requested at the start of a tick
+    static constexpr uint32_t SAMPLE_WAIT_MARGIN_MS = 50;
+    // Relay state older than this many Shelly poll periods means it has
+    // stopped answering
+    static constexpr uint32_t RELAY_STALE_PERIODS = 3;
+
     TaskHandle_t handle_ = nullptr;
     bool lastInDeadzone_ = false;
+    bool sampleLate_ = false; // the last tick got no new sample in time
     bool enabled_ = true;
     bool dzEnabled_ = true;
 
     float currentTemp_;
-    bool isHeaterOn_;
+    bool isHeaterOn_ = false;
 
     KickCallback kickCallback_{nullptr};
     wsTempUpdateCallback wsTempUpdateCallback_{nullptr};
+    RelayCallback relayCallback_{nullptr};
+    EnergyMeter *energy_ = nullptr;
 };
@@ -18,12 +18,19 @@ public:
     // Convenience: same as above but in minutes.
     float estimateWarmupMinutes(float kFactor, float ambientTempC, float targetTempC) const;
 
+    // Expected cabin heating rate in °C/min with the heater on, for comparison
+    // with the measured slope.
+    float heatingRateCPerMin(float kFactor) const;
+
     // Accessors in case you want to show them in UI or adjust later
     float cabinVolume()    const { return cabinVolume_m3_; }
     float heaterPower()    const { return heaterPower_W_; }
     float airDensity()     const { return airDensity_kg_m3_; }
     float specificHeat()   const { return specificHeat_J_kgK_; }
 
+    // Replace the nominal wattage with a measured one (Config::heaterPowerW)
+    void setHeaterPower(float heaterPower_W);
+
 private:
     float cabinVolume_m3_;
     float heaterPower_W_;
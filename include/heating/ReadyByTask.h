@@ -7,6 +7,7 @@
 #include "heating/Thermostat.h"
 
 class KFactorCalibrationManager;
+class EnergyMeter;
 
 class ReadyByTask
 {
@@ -22,6 +23,7 @@ public:
     void start(uint32_t stackSize = 4096, UBaseType_t priority = 1);
 
     void setCalibrationManager(KFactorCalibrationManager *mgr) { calibMgr_ = mgr; }
+    void setEnergyMeter(EnergyMeter *meter) { energy_ = meter; }
 
     void setWsReadyByUpdateCallback(wsReadyByUpdateCallback callback) 
     { wsReadyByUpdateCallback_ = callback; }
@@ -34,6 +36,14 @@ public:
     // Cancel any scheduled event; also turns off forced heating if active.
     void cancel();
 
+    // Measured vs. model heating rate (°C/min) from the last evaluation.
+    // Observed is NAN until forced heating has run for a full slope window.
+    void heatingRates(float &observed, float &predicted) const
+    {
+        observed = observedRateCPerMin_;
+        predicted = predictedRateCPerMin_;
+    }
+
     bool isActive() const { return active_; }
     void setActive(bool v);
 
@@ -56,14 +66,16 @@ private:
     // internal helpers
     void clearScheduleLocked();   // used from task context
     void logScheduleInfo(const char *msgPrefix) const;
-    String log(const String &msg) const;
+    void log(const String &msg) const;
     void exitActions();
+    void checkHeatingRate(float slopeCPerMin, float ambient, float targetTmp, uint64_t secondsUntilTarget);
 
     Config             &config_;
     HeaterTask         &heaterTask_;
     LogManager         &logManager_;
     Thermostat         &thermostat_;
     KFactorCalibrationManager *calibMgr_ = nullptr;
+    EnergyMeter *energy_ = nullptr;
 
     TaskHandle_t handle_ = nullptr;
 
@@ -76,5 +88,11 @@ private:
     volatile float    targetTempC_    = 0.0f;
     volatile bool     targetTempReached_ = false;
 
+    // Heating rate tracking while forced on
+    uint32_t          forcedSinceMs_ = 0;
+    bool              slowRateLogged_ = false;
+    volatile float    observedRateCPerMin_  = NAN;
+    volatile float    predictedRateCPerMin_ = NAN;
+
     wsReadyByUpdateCallback wsReadyByUpdateCallback_{nullptr};
 };
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <stdint.h>
+
 class Thermostat {
 public:
     Thermostat(float targetTemp, float hysteresis);
 
     bool update(float currentTemp);
+    // Same decision on integer centi-degrees (sensor hot path, no soft-float)
+    bool updateCentiC(int32_t currentCentiC);
 
     void setTarget(float targetTemp);
     void setHysteresis(float hysteresis);
@@ -14,8 +18,14 @@ public:
     bool isHeaterOn() const;
 
 private:
+    void recomputeThresholds();
+
     float targetTemp_;
     float hysteresis_;
+    // target / target ± hysteresis/2 in centi-degrees, refreshed by the setters
+    int32_t targetCentiC_;
+    int32_t onBelowCentiC_;
+    int32_t offAboveCentiC_;
     bool  heaterOn_;
     bool  initialized_;
 };
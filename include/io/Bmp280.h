@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Bmp280: minimal register-level BMP280 driver with Bosch's integer
+// compensation (datasheet section 8.2). Temperature comes back in
+// centi-degrees and pressure in Pascals, so the sensor path never touches
+// soft-float on the FPU-less ESP32-C3.
+//
+// Conversions are split into trigger() / isMeasuring() / readRaw() so the
+// caller decides how to wait. Not thread-safe: one task should own it.
+class Bmp280 {
+public:
+    // Factory trim values read from 0x88..0x9F
+    struct Calibration {
+        uint16_t t1;
+        int16_t  t2;
+        int16_t  t3;
+        uint16_t p1;
+        int16_t  p2;
+        int16_t  p3;
+        int16_t  p4;
+        int16_t  p5;
+        int16_t  p6;
+        int16_t  p7;
+        int16_t  p8;
+        int16_t  p9;
+    };
+
+    // ADC value the chip reports for a skipped measurement
+    static constexpr int32_t ADC_SKIPPED = 0x80000;
+
+    // Probes the chip id, loads calibration and sets the IIR filter /
+    // standby fields. Leaves the chip in sleep mode.
+    bool begin(uint8_t address, TwoWire &wire = Wire);
+
+    // Starts one forced-mode conversion. osrsT / osrsP are the raw 3-bit
+    // oversampling codes (0 = skip, 1 = x1 ... 5 = x16).
+    bool trigger(uint8_t osrsT, uint8_t osrsP);
+
+    // Reads the status register. Returns false on I2C error.
+    bool isMeasuring(bool &measuring);
+
+    // Burst-reads the six data registers in one transaction.
+    bool readRaw(int32_t &adcT, int32_t &adcP);
+
+    // Integer compensation. tFine carries the temperature term into the
+    // pressure formula, exactly as in the datasheet reference code.
+    int32_t compensateTemperatureCentiC(int32_t adcT, int32_t &tFine) const;
+    uint32_t compensatePressurePa(int32_t adcP, int32_t tFine) const;
+
+    const Calibration &calibration() const { return calib_; }
+    void setCalibration(const Calibration &c) { calib_ = c; }
+    uint8_t address() const { return addr_; }
+
+private:
+    bool writeReg(uint8_t reg, uint8_t value);
+    bool readRegs(uint8_t reg, uint8_t *buf, size_t len);
+
+    TwoWire *wire_ = nullptr;
+    uint8_t addr_ = 0x76;
+    Calibration calib_{};
+};
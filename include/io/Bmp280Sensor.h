@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "io/Bmp280.h"
+#include "io/Sensor.h"
+
+// Bmp280Sensor: BMP280 in forced mode as a sampler Sensor. Several can share
+// one I2C bus at different addresses (0x76 / 0x77).
+class Bmp280Sensor : public Sensor {
+public:
+    explicit Bmp280Sensor(uint8_t address, TwoWire &wire = Wire);
+
+    const char *type() const override { return "bmp280"; }
+    bool begin() override;
+    bool trigger(const SamplingProfile &profile, bool withPressure) override;
+    uint32_t conversionMs(const SamplingProfile &profile, bool withPressure) const override;
+    bool ready() override;
+    bool collect(Reading &out) override;
+
+    uint8_t address() const { return address_; }
+
+private:
+    Bmp280 chip_;
+    TwoWire &wire_;
+    uint8_t address_;
+    bool convertingPressure_ = false;
+    uint32_t lastPressurePa_ = 0; // carried over between pressure conversions
+};
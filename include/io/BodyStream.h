@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Exposes exactly Content-Length bytes of the socket, so a JSON parser can
+// read the body in place and the connection is left at the next response
+class BodyStream : public Stream
+{
+public:
+    BodyStream(Stream &in, size_t length) : in_(in), remaining_(length) {}
+
+    int available() override
+    {
+        const int n = in_.available();
+        return (n < 0 || static_cast<size_t>(n) < remaining_) ? n : static_cast<int>(remaining_);
+    }
+    int peek() override { return remaining_ ? in_.peek() : -1; }
+    int read() override
+    {
+        if (remaining_ == 0)
+            return -1;
+        int c = in_.read();
+        if (c >= 0)
+            --remaining_;
+        return c;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+    // Skip whatever the parser did not consume (filtered-out tail)
+    void drain(uint32_t timeoutMs)
+    {
+        const uint32_t start = millis();
+        while (remaining_ > 0 && (millis() - start) < timeoutMs)
+        {
+            if (read() < 0)
+                vTaskDelay(1);
+        }
+    }
+
+    bool complete() const { return remaining_ == 0; }
+
+private:
+    Stream &in_;
+    size_t remaining_;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#include "io/Sensor.h"
+
+// Ds18b20Sensor: one DS18B20 on a 1-Wire bus as a sampler Sensor. Talks the
+// scratchpad protocol directly (no DallasTemperature), addresses the device
+// by ROM so several can share a bus, and never waits inside trigger().
+// Needs external power; parasite-powered devices are not supported.
+class Ds18b20Sensor : public Sensor {
+public:
+    // rom == nullptr: use the first DS18B20 found on the bus in begin().
+    // resolutionBits: 9..12, trading conversion time (94..750 ms) for
+    // resolution (0.5..0.0625 °C).
+    explicit Ds18b20Sensor(OneWire &bus, const uint8_t *rom = nullptr, uint8_t resolutionBits = 12);
+
+    const char *type() const override { return "ds18b20"; }
+    bool begin() override;
+    bool trigger(const SamplingProfile &profile, bool withPressure) override;
+    uint32_t conversionMs(const SamplingProfile &profile, bool withPressure) const override;
+    bool ready() override;
+    bool collect(Reading &out) override;
+
+    const uint8_t *rom() const { return rom_; }
+
+private:
+    bool select();
+
+    OneWire &bus_;
+    uint8_t rom_[8] = {};
+    bool haveRom_ = false;
+    uint8_t resolutionBits_;
+    uint32_t triggerMs_ = 0;
+};
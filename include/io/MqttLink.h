@@ -0,0 +1,148 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "io/ShellyHandler.h"
+
+// Optional MQTT connection (PubSubClient) shared by two jobs:
+//
+//  - Relay RPC for attached Shelly outputs. Switch.Set and
+//    Switch.GetStatus are published to <prefix>/rpc with src=<clientId>
+//    and the reply is read from <clientId>/rpc. Relay state arrives as
+//    pushes on <prefix>/events/rpc (NotifyStatus) and
+//    <prefix>/status/switch:<id> (the Shelly's generic status updates).
+//  - The heater's own telemetry, published retained under
+//    <topicRoot>/<subtopic>, plus <topicRoot>/availability (online, or
+//    offline through the last will).
+//
+// One persistent TCP connection replaces the per-request HTTP connects. A
+// task owns the socket: it keeps it serviced, reconnects with backoff and
+// publishes telemetry every TELEMETRY_INTERVAL_MS or when asked. While it
+// is up the attached ShellyHandlers send their RPCs through it and treat
+// it as a live push channel; when it drops they fall back to HTTP.
+class MqttLink
+{
+public:
+    // Fills the JSON payload of one telemetry topic
+    using TelemetryFn = std::function<void(JsonDocument &doc)>;
+
+    MqttLink(const char *host, uint16_t port, const char *clientId, const char *topicRoot);
+
+    void setCredentials(const char *user, const char *password);
+
+    // Route shelly's RPCs and status pushes through this connection.
+    // topicPrefix is the Shelly's MQTT prefix (its device id by default).
+    // Call from setup(), before start().
+    bool attachShelly(ShellyHandler &shelly, const char *topicPrefix);
+
+    // Publish fn's payload retained at <topicRoot>/<subtopic>. Call from
+    // setup(), before start().
+    bool addTelemetry(const char *subtopic, TelemetryFn fn);
+
+    // Create and start the connection task
+    void start(uint32_t stackSize = 4096, UBaseType_t priority = 1);
+
+    // Publish telemetry soon instead of at the next interval (rate limited
+    // to TELEMETRY_MIN_GAP_MS). Safe from any task.
+    void requestTelemetry() { telemetryRequested_ = true; }
+
+    bool connected() const { return connected_; }
+
+    // Diagnostics
+    uint32_t connectCount() const { return connects_; }
+    uint32_t rpcCount() const { return rpcs_; }
+    uint32_t rpcTimeouts() const { return rpcTimeouts_; }
+    uint32_t publishCount() const { return publishes_; }
+
+    static constexpr size_t MAX_SHELLYS = 4;
+    static constexpr size_t MAX_TELEMETRY = 4;
+    static constexpr uint32_t RPC_TIMEOUT_MS = 2000;
+    static constexpr uint32_t TELEMETRY_INTERVAL_MS = 30000;
+    static constexpr uint32_t TELEMETRY_MIN_GAP_MS = 2000;
+    static constexpr uint32_t RECONNECT_MIN_MS = 2000;
+    static constexpr uint32_t RECONNECT_MAX_MS = 60000;
+    // Large enough for NotifyStatus and Switch.GetStatus frames
+    static constexpr uint16_t BUFFER_SIZE = 2048;
+
+private:
+    // One attached Shelly output; the transport ShellyHandler calls into
+    class ShellyRoute : public ShellyRpcTransport
+    {
+    public:
+        bool connected() const override { return link && link->connected(); }
+        bool call(const char *method, const String &params, JsonDocument *result) override
+        {
+            return link->rpc(prefix, method, params, result);
+        }
+
+        MqttLink *link = nullptr;
+        ShellyHandler *shelly = nullptr;
+        String prefix;
+    };
+
+    struct Telemetry
+    {
+        String topic;
+        TelemetryFn fn;
+    };
+
+    static void taskEntry(void *pvParameters);
+    void run();
+
+    bool connect();
+    void publishTelemetry();
+    bool rpc(const String &prefix, const char *method, const String &params, JsonDocument *result);
+    void onMessage(char *topic, uint8_t *payload, unsigned int len);
+    void onShellyEvent(ShellyRoute &route, const uint8_t *payload, unsigned int len);
+    void onShellyStatus(ShellyRoute &route, const uint8_t *payload, unsigned int len);
+    void onRpcReply(const uint8_t *payload, unsigned int len);
+
+    String host_;
+    uint16_t port_;
+    String clientId_;
+    String topicRoot_;
+    String availabilityTopic_;
+    String replyTopic_; // <clientId>/rpc
+    String user_;
+    String password_;
+
+    WiFiClient net_;
+    PubSubClient client_;
+    // Guards client_; the message callback runs with it held (inside loop())
+    SemaphoreHandle_t mutex_ = nullptr;
+
+    ShellyRoute routes_[MAX_SHELLYS];
+    size_t routeCount_ = 0;
+    Telemetry telemetry_[MAX_TELEMETRY];
+    size_t telemetryCount_ = 0;
+
+    // One RPC in flight at a time: rpcMutex_ serializes callers, rpcDone_
+    // is given by the reply. pendingId_/pendingResult_/pendingOk_ are
+    // written under mutex_.
+    SemaphoreHandle_t rpcMutex_ = nullptr;
+    SemaphoreHandle_t rpcDone_ = nullptr;
+    uint32_t nextRpcId_ = 1;
+    uint32_t pendingId_ = 0; // 0 = none
+    JsonDocument *pendingResult_ = nullptr;
+    bool pendingOk_ = false;
+
+    volatile bool connected_ = false;
+    volatile bool telemetryRequested_ = false;
+    uint32_t lastTelemetryMs_ = 0;
+    uint32_t nextAttemptMs_ = 0;
+    uint32_t backoffMs_ = RECONNECT_MIN_MS;
+
+    uint32_t connects_ = 0;
+    uint32_t rpcs_ = 0;
+    uint32_t rpcTimeouts_ = 0;
+    uint32_t publishes_ = 0;
+
+    TaskHandle_t handle_ = nullptr;
+};
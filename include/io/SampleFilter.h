@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+// SampleFilter: outlier-rejecting smoothing stage between raw sensor reads
+// and consumers. Works on integer centi-degrees so the sampler path stays
+// free of soft-float.
+//
+// Every sample first passes an innovation gate: if it is further than
+// gateCentiC from the current estimate it is rejected and the estimate is
+// kept. After MAX_CONSECUTIVE_REJECTS rejections in a row the filter
+// re-seeds from the new level, so a genuine step is followed after a few
+// seconds instead of being locked out forever.
+class SampleFilter
+{
+public:
+    enum class Mode : uint8_t
+    {
+        None = 0,   // pass-through (gate still applies)
+        Median = 1, // median of the last medianN accepted samples
+        Ema = 2,    // exponential moving average, alpha = emaAlphaPct / 100
+        Kalman = 3  // 1-D random-walk Kalman filter
+    };
+
+    struct Settings
+    {
+        Mode mode = Mode::Kalman;
+        uint8_t medianN = 5;        // 1..MAX_MEDIAN_N, odd values work best
+        uint8_t emaAlphaPct = 20;   // 1..100
+        uint16_t gateCentiC = 150;  // 0 disables the gate
+        uint16_t kalmanQ = 4;       // process noise, centi-°C^2 per sample
+        uint16_t kalmanR = 100;     // measurement noise, centi-°C^2
+    };
+
+    struct Stats
+    {
+        Mode mode;
+        int32_t estimateCentiC;
+        uint32_t varianceCenti2; // Kalman P, or EMA of squared innovation
+        uint32_t accepted;
+        uint32_t rejected;
+        uint32_t reseeds;
+    };
+
+    static constexpr uint8_t MAX_MEDIAN_N = 9;
+    static constexpr uint8_t MAX_CONSECUTIVE_REJECTS = 5;
+
+    SampleFilter();
+
+    void configure(const Settings &settings);
+    const Settings &settings() const { return settings_; }
+
+    // Feeds one raw sample. Returns false if it was rejected by the gate;
+    // filteredCentiC receives the current estimate either way.
+    bool process(int32_t rawCentiC, int32_t &filteredCentiC);
+
+    Stats stats() const;
+    void reset();
+
+private:
+    void seed(int32_t rawCentiC);
+    int32_t median() const;
+
+    Settings settings_;
+
+    bool seeded_ = false;
+    int32_t estimate_ = 0;     // centi-°C
+    int32_t emaQ8_ = 0;        // EMA state, centi-°C * 256
+    uint32_t variance_ = 0;    // centi-°C^2
+    uint8_t consecutiveRejects_ = 0;
+
+    int32_t window_[MAX_MEDIAN_N] = {};
+    uint8_t windowHead_ = 0;
+    uint8_t windowCount_ = 0;
+
+    uint32_t accepted_ = 0;
+    uint32_t rejected_ = 0;
+    uint32_t reseeds_ = 0;
+};
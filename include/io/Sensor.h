@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+// BMP280 oversampling codes (osrs_t / osrs_p fields of ctrl_meas)
+enum class Oversampling : uint8_t { Skip = 0, X1 = 1, X2 = 2, X4 = 3, X8 = 4, X16 = 5 };
+
+// How the sampler converts. Control loops only need temperature, so most
+// conversions skip pressure entirely and finish in a few milliseconds.
+// Sensors without these knobs ignore the profile.
+struct SamplingProfile {
+    Oversampling temperature; // every conversion
+    Oversampling pressure;    // pressure conversions only
+    uint16_t pressureEveryN;  // 0 = only when requestPressure() asks
+};
+
+// Sensor: one temperature source driven by the sampler task.
+//
+// Every cycle the sampler calls trigger() on all sensors back to back,
+// sleeps for the longest conversionMs(), then polls ready() and collect()
+// on each in one pass. Implementations must not block in trigger() and
+// are only ever called from the sampler task.
+class Sensor {
+public:
+    struct Reading {
+        int32_t centiC;
+        uint32_t pressurePa; // 0 if the sensor has no barometer
+    };
+
+    virtual ~Sensor() = default;
+
+    // Short type tag for the API ("bmp280", "ds18b20")
+    virtual const char *type() const = 0;
+
+    // Probes and configures the device. Returns false if it is not there.
+    virtual bool begin() = 0;
+
+    // Starts a conversion and returns right away. withPressure is a hint
+    // for sensors that can also measure pressure.
+    virtual bool trigger(const SamplingProfile &profile, bool withPressure) = 0;
+
+    // Worst-case time from trigger() until collect() can succeed
+    virtual uint32_t conversionMs(const SamplingProfile &profile, bool withPressure) const = 0;
+
+    // True once the conversion started by trigger() has finished
+    virtual bool ready() = 0;
+
+    // Reads the finished conversion. Returns false on bus or CRC errors.
+    virtual bool collect(Reading &out) = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "io/ShellyHandler.h"
+
+// Receives relay state pushed by the Shellys and hands it to the
+// ShellyHandler of the output it belongs to:
+//
+//  - GET ShellyHandler::EVENT_PATH?id=<switch>&output=true|false, the
+//    target of the switch.on/switch.off webhooks ShellyHandler registers
+//  - WS /shelly/ws, for each Shelly's outbound WebSocket (Ws.SetConfig with
+//    server "ws://<this device>/shelly/ws"); NotifyStatus and
+//    NotifyFullStatus frames carrying switch:<id>.output are applied to
+//    every registered output of the sending device
+//
+// Only requests coming from a registered Shelly IP are accepted.
+class ShellyEvents
+{
+public:
+  ShellyEvents(AsyncWebServer &server, ShellyHandler &shelly);
+
+  // Route pushes for another output too. Call from setup, before begin()
+  bool addDevice(ShellyHandler &shelly);
+
+  // Call once from setup to register the webhook route and /shelly/ws
+  void begin();
+
+  static constexpr size_t MAX_DEVICES = 4;
+
+private:
+  void handleWebhook(AsyncWebServerRequest *request);
+  void onEvent(AsyncWebSocket *server,
+               AsyncWebSocketClient *client,
+               AwsEventType type,
+               void *arg,
+               uint8_t *data,
+               size_t len);
+  void handleNotification(const String &ip, const uint8_t *data, size_t len);
+  bool knownIp(const String &ip) const;
+  // Marks every output on the device at ip as push-connected (or not)
+  void setConnected(const String &ip, uint32_t clientId, bool connected);
+
+  struct Device
+  {
+    ShellyHandler *shelly = nullptr;
+    uint32_t clientId = 0; // its device's outbound WS client, 0 = none
+  };
+
+  AsyncWebSocket ws_;
+  AsyncWebServer &server_;
+
+  Device devices_[MAX_DEVICES];
+  size_t deviceCount_ = 0;
+};
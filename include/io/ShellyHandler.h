@@ -1,11 +1,185 @@
 #pragma once
 
 #include <Arduino.h>
+#include <functional>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "io/ShellyStatus.h"
+
+// Talks to one Shelly relay output over its HTTP RPC API: switch switchId
+// of the device at ipAddress. Each output (a separate device or a channel
+// of a multi-channel Shelly) gets its own handler, worker task and
+// connection, so several outputs are polled and switched concurrently.
+//
+// All requests share one keep-alive TCP connection, so the periodic status
+// polls and watchdog pings skip the handshake. The connection is guarded
+// by a mutex because HeaterTask, WatchDog and the web handlers all call in.
+// A failed request on a reused socket (the Shelly may have closed it while
+// idle) is retried once on a fresh connection: GETs always, since they only
+// read or set absolute state, POSTs (Webhook.Create/Delete, Shelly.Reboot)
+// only if they failed before the request went out.
+//
+// The relay state is cached. getStatus() answers from the cache while it is
+// younger than the requested age, and concurrent callers that find it stale
+// share one in-flight Switch.GetStatus instead of each sending their own.
+// A successful Switch.Set updates the cache directly.
+//
+// Control tasks should not block on the network. Once start() has been
+// called, a worker task owns all relay traffic: requestSwitch() only records
+// the wanted state and returns, and the worker sends it and keeps the cached
+// state refreshed in the background. Only the newest switch request is kept
+// (last writer wins); the one it replaces completes as Superseded.
+// Writes that would not change anything (relay already confirmed in, or
+// already being switched to, that state) are dropped as Suppressed, and a
+// command is held for SWITCH_DEBOUNCE_MS before sending so a quick
+// on/off/on collapses into at most one Switch.Set.
+//
+// The Shelly can also push its state: switch.on/switch.off webhooks (which
+// the worker registers itself once enableWebhooks() is set) and its
+// outbound WebSocket. ShellyEvents receives both and calls pushStatus().
+// While a push channel is live the background poll drops to a slow
+// reconciliation.
+//
+// A circuit breaker keeps an offline Shelly cheap: after
+// BREAKER_FAILURE_THRESHOLD consecutive transport failures it opens and
+// every request fails immediately with BREAKER_OPEN. After a cooldown
+// (doubling up to BREAKER_MAX_COOLDOWN_MS) one probe request is let
+// through (half-open); success closes the breaker, failure re-opens it.
+// Request timeouts follow a smoothed round-trip time (srtt + 4 * rttvar,
+// as TCP does) instead of a fixed multi-second value. Each transport
+// failure doubles the timeout up to MAX_TIMEOUT_MS (RFC 6298 5.5), since a
+// timed-out request yields no RTT sample; the next success resets it.
+//
+// Every ON command carries a toggle_after lease, so the Shelly turns the
+// relay off by itself unless the lease is renewed. The worker renews it
+// (in place of that cycle's status read) while the relay is on and a
+// control loop has called holdOn() within the last lease period. The
+// control loops stretch the lease to LEASE_CADENCE_FACTOR of their own
+// periods (fitLeaseToCadence()), so a slow cadence never lets it lapse
+// between two ticks. A hung or rebooting ESP therefore leaves the heater
+// on for at most two lease periods.
+//
+// With an RPC transport attached (MqttLink), Switch.Set and
+// Switch.GetStatus go over it while it is connected and HTTP is only the
+// fallback; a connected transport also counts as a live push channel.
+
+// Alternative path for the relay RPCs, e.g. the Shelly's MQTT RPC topic
+class ShellyRpcTransport
+{
+public:
+    virtual ~ShellyRpcTransport() = default;
+    virtual bool connected() const = 0;
+    // Sends one RPC and waits for the reply. Returns true if the device
+    // answered without an error; result (optional) receives its "result".
+    virtual bool call(const char *method, const String &params, JsonDocument *result) = 0;
+};
 
 class ShellyHandler
 {
 public:
-    ShellyHandler(String ipAddress);
+    enum class Result : uint8_t
+    {
+        Ok = 0,
+        Failed = 1,
+        Superseded = 2, // replaced by a newer request before it was sent
+        Suppressed = 3  // relay already in / heading to that state; nothing sent
+    };
+
+    // Runs on the worker task, or on the caller's task for Superseded and
+    // Suppressed
+    using Completion = std::function<void(Result result)>;
+
+    ShellyHandler(String ipAddress, uint8_t switchId = 0);
+
+    // Create and start the worker task
+    void start(uint32_t stackSize = 4096, UBaseType_t priority = 1);
+
+    // Queue a relay command and return immediately. Returns false only if
+    // the worker is not running and the synchronous fallback failed.
+    bool requestSwitch(bool on, Completion done = nullptr);
+
+    // Ask the worker for a status read now instead of at the next interval
+    void requestRefresh();
+
+    // Heating is still wanted. Control loops call this every tick while the
+    // relay should stay on; without it the ON lease is not renewed.
+    void holdOn()
+    {
+        holdAtMs_ = millis();
+        holdValid_ = true;
+    }
+
+    // toggle_after lease on ON commands, in seconds; 0 disables it
+    void setOnLeaseS(uint32_t seconds) { onLeaseS_ = seconds; }
+    uint32_t onLeaseS() const { return onLeaseS_; }
+    // Lease of DEFAULT_ON_LEASE_S, or LEASE_CADENCE_FACTOR control loop
+    // periods if that is longer. Control loops call this every tick, so a
+    // changed cadence applies from the next renewal.
+    void fitLeaseToCadence(float periodS);
+    uint32_t leaseRenewals() const { return leaseRenewals_; }
+
+    // True while a queued or in-flight switch command has not completed;
+    // the cached state may not reflect it yet
+    bool switchPending() const;
+
+    // Relay state pushed by the Shelly itself (webhook, outbound WS, MQTT)
+    void pushStatus(bool isOn);
+    void pushStatus(const ShellyStatus &status);
+
+    // Route relay RPCs through transport while it is connected
+    void setRpcTransport(ShellyRpcTransport *transport) { transport_ = transport; }
+
+    // Fills status from a Switch.GetStatus result object; false if it has
+    // no output field
+    static bool parseStatus(JsonVariantConst src, ShellyStatus &status);
+
+    // Have the worker point the Shelly's switch.on/off webhooks for this
+    // output at EVENT_PATH on this device (re-registered if our IP changes)
+    void enableWebhooks(bool enabled) { webhooksWanted_ = enabled; }
+    // Set by ShellyEvents while the Shelly's outbound WebSocket is connected
+    void setPushConnected(bool connected) { pushConnected_ = connected; }
+
+    bool pushActive() const
+    {
+        return pushConnected_ || webhooksRegistered_ || (transport_ && transport_->connected());
+    }
+    uint32_t pushCount() const { return pushes_; }
+    // Current background poll period; longer while pushes are live
+    uint32_t refreshIntervalMs() const
+    {
+        return pushActive() ? RECONCILE_INTERVAL_MS : REFRESH_INTERVAL_MS;
+    }
+
+    const String &ip() const { return ip_; }
+    uint8_t switchId() const { return switchId_; }
+
+    enum class BreakerState : uint8_t
+    {
+        Closed = 0,
+        Open = 1,
+        HalfOpen = 2
+    };
+
+    struct BreakerStats
+    {
+        BreakerState state;
+        uint8_t consecutiveFailures;
+        uint32_t trips;         // Closed/HalfOpen -> Open transitions
+        uint32_t fastFails;     // requests refused while open
+        uint32_t retryInMs;     // until the next probe, 0 unless open
+        uint32_t srttMs;        // smoothed round-trip time
+        uint32_t rttVarMs;
+        uint32_t timeoutMs;     // currently applied request timeout
+        uint8_t timeoutBackoff; // doublings applied after failures
+    };
+
+    BreakerStats breakerStats() const;
+    static const char *breakerStateName(BreakerState state);
 
     // Returns true on success (HTTP 2xx), false on failure
     bool switchOn();
@@ -15,13 +189,159 @@ public:
     // Query current status from Shelly.
     // Returns true if the HTTP request + parsing succeeded, and
     // writes the result into isOn (true = ON, false = OFF).
-    bool getStatus(bool &isOn, bool verbose = true);
+    // A cached state no older than maxAgeMs is returned without a request.
+    bool getStatus(bool &isOn, bool verbose = true, uint32_t maxAgeMs = STATUS_TTL_MS);
+    bool getStatus(ShellyStatus &status, bool verbose = true, uint32_t maxAgeMs = STATUS_TTL_MS);
+
+    // Last known relay state from memory only; never blocks on the network.
+    // Returns false if the state has never been read. ageMs is how long ago
+    // it was confirmed.
+    bool cachedStatus(bool &isOn, uint32_t &ageMs) const;
+    bool cachedStatus(ShellyStatus &status, uint32_t &ageMs) const;
     
     bool reboot();
     bool ping();
+
+    // Connection reuse counters, for diagnostics
+    uint32_t requestCount() const { return requests_; }
+    uint32_t connectCount() const { return connects_; }
+    uint32_t statusCacheHits() const { return cacheHits_; }
+    // Switch.Set accounting: sent vs. dropped as no-op vs. replaced
+    uint32_t switchSent() const { return switchSent_; }
+    uint32_t switchSuppressed() const { return switchSuppressed_; }
+    uint32_t switchSuperseded() const { return switchSuperseded_; }
+
+    static constexpr uint32_t STATUS_TTL_MS = 2000;
+    // ping() is answered without a request if the Shelly replied this recently
+    static constexpr uint32_t PING_FRESH_MS = 5000;
+    // Background status read cadence of the worker
+    static constexpr uint32_t REFRESH_INTERVAL_MS = 5000;
+    // Reconciliation cadence while pushes keep the state current
+    static constexpr uint32_t RECONCILE_INTERVAL_MS = 60000;
+    // Default ON lease; renewed once half of it has passed
+    static constexpr uint32_t DEFAULT_ON_LEASE_S = 300;
+    // Control loop periods one lease has to cover
+    static constexpr uint32_t LEASE_CADENCE_FACTOR = 3;
+    // Hold time for a queued switch command so flip-flops can cancel out
+    static constexpr uint32_t SWITCH_DEBOUNCE_MS = 250;
+
+    static constexpr const char *EVENT_PATH = "/api/shelly/event";
+
+    static constexpr uint8_t BREAKER_FAILURE_THRESHOLD = 3;
+    static constexpr uint32_t BREAKER_MIN_COOLDOWN_MS = 5000;
+    static constexpr uint32_t BREAKER_MAX_COOLDOWN_MS = 60000;
+
 private:
+    static void taskEntry(void *pvParameters);
+    void run();
+
     bool sendSwitchRequest(bool on);
+    uint32_t leaseRenewInMs() const;
+    void renewLease();
+    bool fetchStatus(ShellyStatus &status, bool verbose);
+    bool registerWebhooks(const String &selfIp);
+
+    // Where a response body goes: copied into text, or parsed into json
+    // straight off the socket (through filter, if given)
+    struct BodySink
+    {
+        String *text = nullptr;
+        JsonDocument *json = nullptr;
+        const JsonDocument *filter = nullptr;
+    };
 
-    String baseUrl_; // e.g. "http://192.168.33.1/rpc/Switch.Set?id=0&on="
+    // One request over the shared connection. Returns the HTTP status (or a
+    // negative HTTPClient error, or PARSE_ERROR). The body is always drained
+    // so the socket stays usable for the next call.
+    int request(const String &uri, const char *postBody = nullptr, String *payload = nullptr);
+    int requestJson(const String &uri, JsonDocument &doc, const JsonDocument *filter = nullptr);
+    int requestSink(const String &uri, const char *postBody, const BodySink &sink);
+    int requestOnce(const String &uri, const char *postBody, const BodySink &sink);
+    static bool safeToRetry(const char *postBody, int code);
+    void closeConnection();
+    bool confirmedState(bool on) const;
+    bool breakerAllows(uint32_t nowMs);
+    void breakerRecord(bool reachable, uint32_t nowMs);
+    void observeRtt(uint32_t rttMs);
+    void backOffTimeout();
+    uint32_t currentTimeoutMs() const;
+    static String errorString(int code);
+    void storeStatus(const ShellyStatus &status);
+    void storeOutput(bool isOn);
+    bool freshStatus(ShellyStatus &status, uint32_t maxAgeMs) const;
+
+    static constexpr int PARSE_ERROR = -100;
+    static constexpr int BREAKER_OPEN = -101;
+
+    String baseUri_; // e.g. "/rpc/Switch.Set?id=0&on="
     String ip_;
+    uint8_t switchId_ = 0;
+
+    static constexpr uint16_t PORT = 80;
+    // Adaptive timeout bounds; the upper one is also the initial value
+    static constexpr uint32_t MIN_TIMEOUT_MS = 500;
+    static constexpr uint32_t MAX_TIMEOUT_MS = 3000;
+
+    WiFiClient client_;
+    HTTPClient http_;
+    SemaphoreHandle_t mutex_ = nullptr;
+
+    // Held by the one caller refreshing the relay state; the others wait on
+    // it and then read the result from the cache
+    SemaphoreHandle_t statusMutex_ = nullptr;
+    mutable portMUX_TYPE cacheMux_ = portMUX_INITIALIZER_UNLOCKED;
+    bool cacheValid_ = false;
+    ShellyStatus cached_;
+    uint32_t cachedAtMs_ = 0;
+    uint32_t lastContactMs_ = 0;
+
+    uint32_t requests_ = 0;
+    uint32_t connects_ = 0;
+    uint32_t cacheHits_ = 0;
+
+    // Breaker and RTT state; written under mutex_, snapshotted under breakerMux_
+    mutable portMUX_TYPE breakerMux_ = portMUX_INITIALIZER_UNLOCKED;
+    BreakerState breaker_ = BreakerState::Closed;
+    uint8_t consecutiveFailures_ = 0;
+    uint32_t openedAtMs_ = 0;
+    uint32_t cooldownMs_ = BREAKER_MIN_COOLDOWN_MS;
+    uint32_t trips_ = 0;
+    uint32_t fastFails_ = 0;
+    uint32_t srttMs_ = 0; // 0 = no sample yet
+    uint32_t rttVarMs_ = 0;
+    uint8_t timeoutBackoff_ = 0;
+
+    // Single-slot command queue; cmdMutex_ guards pending_ and inFlight_
+    struct PendingSwitch
+    {
+        bool valid = false;
+        bool on = false;
+        uint32_t queuedAtMs = 0;
+        Completion done;
+    };
+    SemaphoreHandle_t cmdMutex_ = nullptr;
+    PendingSwitch pending_;
+    bool inFlight_ = false;
+    bool inFlightOn_ = false;
+    uint32_t switchSent_ = 0;
+    uint32_t switchSuppressed_ = 0;
+    uint32_t switchSuperseded_ = 0;
+    bool refreshRequested_ = false;
+    TaskHandle_t handle_ = nullptr;
+
+    volatile bool webhooksWanted_ = false;
+    volatile bool webhooksRegistered_ = false;
+    volatile bool pushConnected_ = false;
+    ShellyRpcTransport *transport_ = nullptr;
+
+    // ON lease; leaseActive_/leaseSentAtMs_ belong to the worker
+    volatile uint32_t onLeaseS_ = DEFAULT_ON_LEASE_S;
+    volatile uint32_t holdAtMs_ = 0;
+    volatile bool holdValid_ = false;
+    bool leaseActive_ = false;
+    uint32_t leaseSentAtMs_ = 0;
+    uint32_t leaseSentS_ = 0; // length the Shelly is counting down
+    uint32_t leaseRenewals_ = 0;
+    String webhookIp_; // our IP the webhooks currently point at
+    uint32_t pushes_ = 0;
 };
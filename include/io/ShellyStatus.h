@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Switch.GetStatus fields the firmware uses. Metering fields are NAN when
+// the device does not report them (e.g. a Plus 1 without power metering).
+struct ShellyStatus
+{
+    bool output = false;
+    float apowerW = NAN;      // active power
+    float voltageV = NAN;
+    float currentA = NAN;
+    float temperatureC = NAN; // device temperature (temperature.tC)
+    float energyWh = NAN;     // lifetime counter (aenergy.total)
+};
+
+// Parse filter keeping exactly the ShellyStatus fields; everything else in
+// a Switch.GetStatus reply is skipped while parsing and never allocated
+const JsonDocument &shellyStatusFilter();
+
+// Fills status from a Switch.GetStatus result object; false if it has no
+// output field
+bool parseShellyStatus(JsonVariantConst src, ShellyStatus &status);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+// SlopeEstimator: least-squares slope of temperature over a sliding window
+// of the last WINDOW samples.
+//
+// Only running sums (n, Σt, Σy, Σt², Σty) are kept, all in exact int64
+// arithmetic. A sample entering or leaving the window costs O(1), and the
+// result never drifts from rounding. Time is counted in 100 ms units from a
+// movable origin. When the newest sample gets far from the origin, the
+// origin is moved up to the oldest sample and the sums are shifted
+// algebraically, so the products stay small without touching the buffer.
+class SlopeEstimator
+{
+public:
+    static constexpr size_t WINDOW = 180;           // ~3 min at the 1 s sampler cadence
+    static constexpr size_t MIN_SAMPLES = 30;       // below this the slope is not reported
+    static constexpr uint32_t MAX_GAP_MS = 30000;   // longer gaps restart the window
+
+    SlopeEstimator();
+
+    // Adds one sample; drops the oldest once the window is full
+    void add(int32_t centiC, uint32_t timestampMs);
+
+    // Slope in milli-°C per minute. Returns false if the window does not
+    // hold enough samples (or spans no time) yet.
+    bool slopeMilliCPerMin(int32_t &out) const;
+
+    size_t count() const { return count_; }
+    void reset();
+
+private:
+    struct Point
+    {
+        uint32_t ms;
+        int16_t centiC;
+    };
+
+    int64_t ticksOf(uint32_t ms) const { return static_cast<int64_t>((ms - originMs_) / 100U); }
+    void rebase();
+
+    Point points_[WINDOW];
+    size_t head_ = 0; // next write position
+    size_t count_ = 0;
+
+    uint32_t originMs_ = 0;
+    uint32_t lastMs_ = 0;
+
+    int64_t sumT_ = 0;
+    int64_t sumY_ = 0;
+    int64_t sumTT_ = 0;
+    int64_t sumTY_ = 0;
+};
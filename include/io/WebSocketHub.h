@@ -6,7 +6,7 @@
 #include "heating/HeaterTask.h"
 #include "heating/ReadyByTask.h"
 #include "core/Config.h"
-#include "heating/KFactorCalibrator.h"
+#include "heating/KFactorCalibrationManager.h"
 
 class WebSocketHub
 {
@@ -23,11 +23,15 @@ public:
 
   // Broadcast helpers
   void broadcastTimeSync();
-  void broadcastLogLine(const String &line);
+  void broadcastLogLine(uint32_t seq, const String &line);
   void broadcastTempUpdate();
   void broadcastReadyByUpdate();
    void broadcastCalibrationUpdate();
 
+  // Message bodies, shared with the retained MQTT telemetry
+  void buildTempUpdate(JsonDocument &doc);
+  void buildReadyByUpdate(JsonDocument &doc);
+
 private:
   AsyncWebSocket ws_;
   AsyncWebServer &server_;
@@ -2,19 +2,114 @@
 #define MEASUREMENTS_H
 
 #include <Arduino.h>
+#include <functional>
+
+#include "io/SampleFilter.h"
+#include "io/Sensor.h"
+
+// Upper bound on registered sensors; per-sensor readings travel inside
+// every Measurements snapshot, so keep it small.
+static constexpr size_t MAX_SENSORS = 4;
+
+// Last reading of one registered sensor
+struct SensorReading {
+    int32_t centiC;        // filtered
+    int32_t rawCentiC;     // unfiltered
+    uint32_t pressurePa;   // 0 if the sensor has no barometer
+    uint32_t timestampMs;  // millis() of the last good collect, 0 = never
+    bool valid;            // last collect succeeded and is recent
+    bool fresh;            // collected in the cycle that published this snapshot
+};
 
 struct Measurements {
-    float temperature;
-    float pressure;
-    float altitude;
+    float temperature;         // °C, derived from temperatureCentiC
+    float pressure;            // hPa, carried over from the last pressure conversion
+    int32_t temperatureCentiC; // aggregate of the filtered sensor values, used by control loops
+    int32_t rawCentiC;         // same aggregate over unfiltered values
+    float slopeCPerMin;        // regression slope over the last few minutes, NAN until warm
+    uint32_t pressurePa;       // 0 until the first pressure conversion
+    uint32_t seq;              // publish counter, 0 until the first valid sample
+    uint32_t timestampMs;      // millis() when the sample was collected
+    uint8_t sensorCount;
+    SensorReading sensors[MAX_SENSORS]; // in registration order
+};
+
+// How the per-sensor values are reduced to the control temperature
+enum class AggregateMode : uint8_t {
+    Named = 0,        // one sensor picked by index
+    Min = 1,          // coldest valid sensor with a non-zero weight
+    WeightedMean = 2  // mean over valid sensors by registration weight
 };
 
-// Initializes BMP280 and returns true if successful
+// Starts I2C, finds the primary BMP280 and registers it as sensor 0
+// ("cabin"). Returns true if successful.
 // Defaults use config-defined I2C pins/address
 bool initBMP280(uint8_t address, uint8_t sda, uint8_t scl);
 
-// Takes and returns one measurement set
-Measurements takeMeasurement(bool verbose = true);
+// Registers another sensor (begin() is called here). weight is used by
+// AggregateMode::WeightedMean; 0 keeps the sensor out of the mean and out
+// of Min, so e.g. an outdoor probe is reported but never controls the
+// heater (only Named can still select it explicitly).
+// The sensor must outlive the sampler. Call from setup(), after
+// initBMP280() and before startMeasurementTask().
+bool addSensor(const char* name, Sensor* sensor, uint8_t weight = 1);
+
+size_t sensorCount();
+const char* sensorName(size_t index);
+const char* sensorType(size_t index);
+
+// Selects the control temperature. namedIndex is only used by Named; an
+// invalid or stale named sensor falls back to the weighted mean.
+void setAggregate(AggregateMode mode, uint8_t namedIndex);
+
+// Starts the sampler task. It is the only code that talks to the sensors
+// after init and publishes one sample every intervalMs.
+void startMeasurementTask(uint32_t intervalMs = 1000,
+                          uint32_t stackSize = 3072,
+                          UBaseType_t priority = 2);
+
+// Called from the sampler task after every published sample. Keep it short;
+// it runs on the sampler's stack. Set from setup(), before startMeasurementTask().
+using MeasurementCallback = std::function<void(const Measurements&)>;
+void setMeasurementCallback(MeasurementCallback cb);
+
+// Replaces the sampler profile. Call from setup(), before startMeasurementTask()
+void setSamplingProfile(const SamplingProfile& profile);
+
+// Filter stage between each sensor and consumers. Settings apply to all
+// sensors and can be changed at runtime; filters re-seed from the next sample.
+void setFilterSettings(const SampleFilter::Settings& settings);
+SampleFilter::Stats filterStats(size_t sensorIndex = 0);
+
+// Latest published sample. Never touches I2C and never blocks, so it is safe
+// from any task including async web handlers.
+Measurements latestMeasurement();
+
+// Temperature from the latest published sample (NAN before the first one)
+float latestTemperature();
+
+// Makes the next conversion include pressure. Call from readers that actually
+// report pressure (e.g. /api/status); the value lands in a later snapshot.
+void requestPressure();
+
+// Barometric altitude in metres for a pressure in hPa. Uses pow(), so only
+// compute it where it is displayed.
+float pressureAltitude(float pressure_hPa, float seaLevel_hPa = 1013.25f);
+
+// Asks the sampler to start a conversion right away instead of waiting for
+// its next period. Returns the sequence number published so far; pass it to
+// waitForMeasurement() after doing other work (e.g. a Shelly round-trip) so
+// the conversion and the network I/O overlap.
+uint32_t requestMeasurement();
+
+// Longest a requested sample can take: the slowest registered sensor's
+// conversion (with pressure) plus the collect timeout. Fixed once the
+// sensors are registered.
+uint32_t measurementWaitMs();
+
+// Waits up to timeoutMs for a sample newer than afterSeq. out always receives
+// the latest snapshot; returns false if nothing newer arrived in time.
+bool waitForMeasurement(uint32_t afterSeq, uint32_t timeoutMs, Measurements& out);
 
 // Returns last valid measurement and its age; returns false if none yet
 bool getLastMeasurement(Measurements& out, uint32_t& age_ms);
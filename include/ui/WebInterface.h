@@ -10,7 +10,11 @@
 #include "io/LedManager.h"
 #include "heating/HeaterTask.h"
 #include "heating/ReadyByTask.h"
-#include "heating/KFactorCalibrator.h"
+#include "heating/KFactorCalibrationManager.h"
+#include "core/TemperatureHistory.h"
+#include "core/SampleRecorder.h"
+#include "heating/EnergyMeter.h"
+#include "heating/ActuatorTask.h"
 
 // forward declare helper if you keep it free, or move into class
 class WebInterface
@@ -25,7 +29,11 @@ public:
                LedManager &led,
                HeaterTask &heaterTask,
                ReadyByTask &readyByTask,
-               KFactorCalibrationManager &calibration);
+               KFactorCalibrationManager &calibration,
+               TemperatureHistory &history,
+               SampleRecorder &recorder,
+               EnergyMeter &energy,
+               ActuatorTask &actuators);
 
   // Call once from setup() after WiFi + FS are ready
   void begin();
@@ -45,6 +53,10 @@ private:
   HeaterTask &heaterTask_;
   ReadyByTask &readyByTask_;
   KFactorCalibrationManager &calibration_;
+  TemperatureHistory &history_;
+  SampleRecorder &recorder_;
+  EnergyMeter &energy_;
+  ActuatorTask &actuators_;
 
   bool showDebug_ = false; // example tunable
 
@@ -64,6 +76,13 @@ private:
   void handleLogsClear(AsyncWebServerRequest *request);
   void handleApiStatus(AsyncWebServerRequest *request);
   void handleApiLogs(AsyncWebServerRequest *request);
+  void handleApiHistory(AsyncWebServerRequest *request);
+  void handleApiRecording(AsyncWebServerRequest *request);
+  void handleRecordingSettings(AsyncWebServerRequest *request);
+  void handleRecordingDownload(AsyncWebServerRequest *request);
+  void handleApiEnergy(AsyncWebServerRequest *request);
+  void handleApiActuators(AsyncWebServerRequest *request);
+  void handleActuatorSettings(AsyncWebServerRequest *request);
   void handleReadyByStatus(AsyncWebServerRequest *request);
   void handleReadyBySchedule(AsyncWebServerRequest *request);
   void handleCalibrationStatus(AsyncWebServerRequest *request);
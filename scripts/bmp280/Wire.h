@@ -0,0 +1,19 @@
+#pragma once
+
+// Host stand-in for <Wire.h>: lets src/io/Bmp280.cpp build on a PC so its
+// compensation code can be checked. No bus behind it; every transfer fails.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class TwoWire
+{
+public:
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { return 1; }
+  uint8_t endTransmission(bool = true) { return 2; } // NACK
+  size_t requestFrom(uint8_t, size_t) { return 0; }
+  int read() { return -1; }
+};
+
+inline TwoWire Wire;
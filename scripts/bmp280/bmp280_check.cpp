@@ -0,0 +1,298 @@
+// Host check of the BMP280 integer compensation in src/io/Bmp280.cpp.
+//
+// For every raw ADC pair the driver's results must be bit-identical to
+// the datasheet's 32/64-bit reference code (section 8.2) and within a
+// small tolerance of its double-precision formulas (section 8.1). Then
+// both paths are timed. Build with scripts/build_bmp280_check.sh.
+//
+//   bmp280_check [--iterations N] [file.csv ...]
+//
+// Without files the built-in table is used: the datasheet's worked
+// example plus a sweep over -40..85 °C and 300..1100 hPa on the same
+// trim values. Files hold "calib,t1,t2,t3,p1,...,p9" lines (the sensor's
+// trim registers, applying to the samples after them) and "adcT,adcP"
+// lines; '#' starts a comment. Exit status is 1 on any mismatch.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "io/Bmp280.h"
+
+namespace
+{
+// Datasheet section 3.12 example trim values
+constexpr Bmp280::Calibration DATASHEET_CALIB = {
+    27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000};
+
+// Tolerances against the double formulas; the integer code truncates
+// at several steps, so it can be off by a few LSBs but never more
+constexpr double MAX_T_ERR_C = 0.01;
+constexpr double MAX_P_ERR_PA = 1.0;
+
+struct Sample
+{
+  Bmp280::Calibration calib;
+  int32_t adcT;
+  int32_t adcP;
+};
+
+// ---- Datasheet reference code, kept as close to the original as possible
+
+int32_t refTemperature(const Bmp280::Calibration &c, int32_t adc_T, int32_t &t_fine)
+{
+  int32_t var1, var2, T;
+  var1 = ((((adc_T >> 3) - ((int32_t)c.t1 << 1))) * ((int32_t)c.t2)) >> 11;
+  var2 = (((((adc_T >> 4) - ((int32_t)c.t1)) * ((adc_T >> 4) - ((int32_t)c.t1))) >> 12) *
+          ((int32_t)c.t3)) >> 14;
+  t_fine = var1 + var2;
+  T = (t_fine * 5 + 128) >> 8;
+  return T;
+}
+
+// Q24.8 Pa
+uint32_t refPressureQ8(const Bmp280::Calibration &c, int32_t adc_P, int32_t t_fine)
+{
+  int64_t var1, var2, p;
+  var1 = ((int64_t)t_fine) - 128000;
+  var2 = var1 * var1 * (int64_t)c.p6;
+  var2 = var2 + ((var1 * (int64_t)c.p5) << 17);
+  var2 = var2 + (((int64_t)c.p4) << 35);
+  var1 = ((var1 * var1 * (int64_t)c.p3) >> 8) + ((var1 * (int64_t)c.p2) << 12);
+  var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)c.p1) >> 33;
+  if (var1 == 0)
+    return 0;
+  p = 1048576 - adc_P;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = (((int64_t)c.p9) * (p >> 13) * (p >> 13)) >> 25;
+  var2 = (((int64_t)c.p8) * p) >> 19;
+  p = ((p + var1 + var2) >> 8) + (((int64_t)c.p7) << 4);
+  return (uint32_t)p;
+}
+
+double refTemperatureDouble(const Bmp280::Calibration &c, int32_t adc_T, double &t_fine)
+{
+  double var1, var2;
+  var1 = (((double)adc_T) / 16384.0 - ((double)c.t1) / 1024.0) * ((double)c.t2);
+  var2 = ((((double)adc_T) / 131072.0 - ((double)c.t1) / 8192.0) *
+          (((double)adc_T) / 131072.0 - ((double)c.t1) / 8192.0)) *
+         ((double)c.t3);
+  t_fine = var1 + var2;
+  return (var1 + var2) / 5120.0;
+}
+
+double refPressureDouble(const Bmp280::Calibration &c, int32_t adc_P, double t_fine)
+{
+  double var1, var2, p;
+  var1 = (t_fine / 2.0) - 64000.0;
+  var2 = var1 * var1 * ((double)c.p6) / 32768.0;
+  var2 = var2 + var1 * ((double)c.p5) * 2.0;
+  var2 = (var2 / 4.0) + (((double)c.p4) * 65536.0);
+  var1 = (((double)c.p3) * var1 * var1 / 524288.0 + ((double)c.p2) * var1) / 524288.0;
+  var1 = (1.0 + var1 / 32768.0) * ((double)c.p1);
+  if (var1 == 0.0)
+    return 0;
+  p = 1048576.0 - (double)adc_P;
+  p = (p - (var2 / 4096.0)) * 6250.0 / var1;
+  var1 = ((double)c.p9) * p * p / 2147483648.0;
+  var2 = p * ((double)c.p8) / 32768.0;
+  p = p + (var1 + var2 + ((double)c.p7)) / 16.0;
+  return p;
+}
+
+// ---- Inputs
+
+void builtinTable(std::vector<Sample> &out)
+{
+  // Worked example: 25.08 °C, 100653.27 Pa
+  out.push_back(Sample{DATASHEET_CALIB, 519888, 415148});
+
+  // Sweep the raw ranges and keep what lands in the sensor's rated range
+  Bmp280 chip;
+  chip.setCalibration(DATASHEET_CALIB);
+  for (int32_t adcT = 300000; adcT <= 700000; adcT += 997)
+  {
+    int32_t tFine = 0;
+    const int32_t t = chip.compensateTemperatureCentiC(adcT, tFine);
+    if (t < -4000 || t > 8500)
+      continue;
+    for (int32_t adcP = 150000; adcP <= 650000; adcP += 4999)
+    {
+      const uint32_t p = chip.compensatePressurePa(adcP, tFine);
+      if (p >= 30000 && p <= 110000)
+        out.push_back(Sample{DATASHEET_CALIB, adcT, adcP});
+    }
+  }
+}
+
+bool loadCsv(const char *path, std::vector<Sample> &out)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+  Bmp280::Calibration calib = DATASHEET_CALIB;
+  std::string line;
+  unsigned lineNo = 0;
+  while (std::getline(in, line))
+  {
+    ++lineNo;
+    const size_t hash = line.find('#');
+    if (hash != std::string::npos)
+      line.resize(hash);
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    long v[12];
+    if (line.compare(0, 6, "calib,") == 0)
+    {
+      if (sscanf(line.c_str() + 6, "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld",
+                 &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9],
+                 &v[10], &v[11]) != 12)
+      {
+        fprintf(stderr, "%s:%u: expected 12 trim values\n", path, lineNo);
+        return false;
+      }
+      calib = Bmp280::Calibration{
+          static_cast<uint16_t>(v[0]), static_cast<int16_t>(v[1]), static_cast<int16_t>(v[2]),
+          static_cast<uint16_t>(v[3]), static_cast<int16_t>(v[4]), static_cast<int16_t>(v[5]),
+          static_cast<int16_t>(v[6]), static_cast<int16_t>(v[7]), static_cast<int16_t>(v[8]),
+          static_cast<int16_t>(v[9]), static_cast<int16_t>(v[10]), static_cast<int16_t>(v[11])};
+      continue;
+    }
+    if (sscanf(line.c_str(), "%ld,%ld", &v[0], &v[1]) != 2)
+    {
+      fprintf(stderr, "%s:%u: expected adcT,adcP\n", path, lineNo);
+      return false;
+    }
+    out.push_back(Sample{calib, static_cast<int32_t>(v[0]), static_cast<int32_t>(v[1])});
+  }
+  return true;
+}
+
+// ---- Checks
+
+struct Result
+{
+  size_t samples = 0;
+  size_t mismatches = 0;
+  size_t outOfTolerance = 0;
+  double maxTErrC = 0;
+  double maxPErrPa = 0;
+};
+
+Result check(const std::vector<Sample> &samples)
+{
+  Result r;
+  Bmp280 chip;
+  for (const Sample &s : samples)
+  {
+    chip.setCalibration(s.calib);
+    ++r.samples;
+
+    int32_t tFine = 0;
+    const int32_t t = chip.compensateTemperatureCentiC(s.adcT, tFine);
+    const uint32_t p = chip.compensatePressurePa(s.adcP, tFine);
+
+    int32_t refFine = 0;
+    const int32_t refT = refTemperature(s.calib, s.adcT, refFine);
+    const uint32_t refP = (refPressureQ8(s.calib, s.adcP, refFine) + 128) >> 8;
+    if (t != refT || tFine != refFine || p != refP)
+    {
+      if (r.mismatches++ < 10)
+        printf("MISMATCH adcT=%ld adcP=%ld: driver %ld/%lu Pa, reference %ld/%lu Pa\n",
+               static_cast<long>(s.adcT), static_cast<long>(s.adcP), static_cast<long>(t),
+               static_cast<unsigned long>(p), static_cast<long>(refT), static_cast<unsigned long>(refP));
+    }
+
+    double dFine = 0;
+    const double dT = refTemperatureDouble(s.calib, s.adcT, dFine);
+    const double dP = refPressureDouble(s.calib, s.adcP, dFine);
+    const double tErr = fabs(t / 100.0 - dT);
+    const double pErr = fabs(static_cast<double>(p) - dP);
+    if (tErr > r.maxTErrC)
+      r.maxTErrC = tErr;
+    if (pErr > r.maxPErrPa)
+      r.maxPErrPa = pErr;
+    if (tErr > MAX_T_ERR_C || pErr > MAX_P_ERR_PA)
+    {
+      if (r.outOfTolerance++ < 10)
+        printf("TOLERANCE adcT=%ld adcP=%ld: %.2f °C %lu Pa vs double %.4f °C %.2f Pa\n",
+               static_cast<long>(s.adcT), static_cast<long>(s.adcP), t / 100.0,
+               static_cast<unsigned long>(p), dT, dP);
+    }
+  }
+  return r;
+}
+
+template <typename Fn>
+double nsPerSample(const std::vector<Sample> &samples, unsigned iterations, Fn fn)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i)
+    for (const Sample &s : samples)
+      fn(s);
+  const auto end = std::chrono::steady_clock::now();
+  const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  return ns / (static_cast<double>(iterations) * samples.size());
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned iterations = 200;
+  std::vector<Sample> samples;
+  bool fromFiles = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+      iterations = static_cast<unsigned>(atoi(argv[++i]));
+    else if (argv[i][0] == '-')
+    {
+      fprintf(stderr, "usage: bmp280_check [--iterations N] [file.csv ...]\n");
+      return 2;
+    }
+    else
+    {
+      fromFiles = true;
+      if (!loadCsv(argv[i], samples))
+        return 2;
+    }
+  }
+  if (!fromFiles)
+    builtinTable(samples);
+  if (samples.empty())
+  {
+    fprintf(stderr, "no samples\n");
+    return 2;
+  }
+
+  const Result r = check(samples);
+  printf("samples=%zu mismatches=%zu out_of_tolerance=%zu max_err=%.4f °C %.3f Pa\n",
+         r.samples, r.mismatches, r.outOfTolerance, r.maxTErrC, r.maxPErrPa);
+
+  // The sink keeps the compiler from dropping the loops
+  volatile int64_t sink = 0;
+  Bmp280 chip;
+  chip.setCalibration(samples.front().calib);
+  const double intNs = nsPerSample(samples, iterations, [&](const Sample &s) {
+    int32_t tFine = 0;
+    sink = sink + chip.compensateTemperatureCentiC(s.adcT, tFine);
+    sink = sink + chip.compensatePressurePa(s.adcP, tFine);
+  });
+  const Bmp280::Calibration calib = samples.front().calib;
+  const double dblNs = nsPerSample(samples, iterations, [&](const Sample &s) {
+    double tFine = 0;
+    sink = sink + static_cast<int64_t>(refTemperatureDouble(calib, s.adcT, tFine) * 100.0);
+    sink = sink + static_cast<int64_t>(refPressureDouble(calib, s.adcP, tFine));
+  });
+  // Host numbers only show the relative cost; on the FPU-less ESP32-C3
+  // every double operation is a soft-float library call
+  printf("host timing per T+P pair: integer %.1f ns, double %.1f ns\n", intNs, dblNs);
+
+  return (r.mismatches == 0 && r.outOfTolerance == 0) ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Build and run the host-side check of the BMP280 integer compensation
+# (scripts/bmp280/bmp280_check.cpp) against the datasheet reference code.
+# Extra arguments are passed to the check (e.g. a CSV of captured raw values).
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+OUT="$ROOT/scripts/bmp280/bmp280_check"
+CXX="${CXX:-c++}"
+
+"$CXX" -std=c++17 -O2 -Wall \
+  -I"$ROOT/scripts/bmp280" -I"$ROOT/scripts/replay" -I"$ROOT/include" \
+  "$ROOT/scripts/bmp280/bmp280_check.cpp" \
+  "$ROOT/src/io/Bmp280.cpp" \
+  -o "$OUT"
+
+echo "Built $OUT"
+"$OUT" "$@"
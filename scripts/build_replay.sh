@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Build the host-side recording replay tool into scripts/replay/replay
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+OUT="$ROOT/scripts/replay/replay"
+CXX="${CXX:-c++}"
+
+"$CXX" -std=c++17 -O2 -Wall \
+  -I"$ROOT/scripts/replay" -I"$ROOT/include" \
+  "$ROOT/scripts/replay/replay.cpp" \
+  "$ROOT/src/heating/Thermostat.cpp" \
+  "$ROOT/src/heating/HeatingCalculator.cpp" \
+  "$ROOT/src/heating/KFactorCalibrator.cpp" \
+  -o "$OUT"
+
+echo "Built $OUT"
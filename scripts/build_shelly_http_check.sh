@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Build the host check of ShellyHandler (scripts/shelly_http), start
+# scripts/fake_shelly_http.py on a local port and run the check against it.
+# ArduinoJson comes from the PlatformIO library folder (run `pio run` once)
+# unless ARDUINOJSON_DIR points at its src/ directory. Extra arguments are
+# passed to the check (e.g. --drop 0.5 --verbose).
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+OUT="$ROOT/scripts/shelly_http/shelly_http_check"
+CXX="${CXX:-c++}"
+ARDUINOJSON_DIR="${ARDUINOJSON_DIR:-$ROOT/.pio/libdeps/seeed_xiao_esp32c3/ArduinoJson/src}"
+export SHELLY_MOCK_PORT="${SHELLY_MOCK_PORT:-18080}"
+
+if [ ! -f "$ARDUINOJSON_DIR/ArduinoJson.h" ]; then
+  echo "ArduinoJson not found in $ARDUINOJSON_DIR (run 'pio run' or set ARDUINOJSON_DIR)" >&2
+  exit 1
+fi
+
+"$CXX" -std=c++17 -O2 -Wall -pthread \
+  -DARDUINOJSON_ENABLE_ARDUINO_STREAM=1 \
+  -DARDUINOJSON_ENABLE_ARDUINO_STRING=1 \
+  -DARDUINOJSON_ENABLE_ARDUINO_PRINT=0 \
+  -I"$ROOT/scripts/shelly_http" -I"$ARDUINOJSON_DIR" -I"$ROOT/include" \
+  "$ROOT/scripts/shelly_http/shelly_http_check.cpp" \
+  "$ROOT/src/io/ShellyHandler.cpp" \
+  "$ROOT/src/io/ShellyStatus.cpp" \
+  -o "$OUT"
+echo "Built $OUT"
+
+LOG="$ROOT/scripts/shelly_http/fake_shelly.log"
+python3 "$ROOT/scripts/fake_shelly_http.py" --port "$SHELLY_MOCK_PORT" --seed 1 2>"$LOG" &
+MOCK=$!
+trap 'kill $MOCK 2>/dev/null || true' EXIT
+for _ in $(seq 50); do
+  curl -s -o /dev/null "http://127.0.0.1:$SHELLY_MOCK_PORT/mock/stats" && break
+  sleep 0.1
+done
+
+"$OUT" "$@"
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Build and run the host check of the Switch.GetStatus parse
+# (scripts/shelly_parse/shelly_parse.cpp). ArduinoJson comes from the
+# PlatformIO library folder (run `pio run` once) unless ARDUINOJSON_DIR
+# points at its src/ directory. Extra arguments are passed to the check
+# (e.g. captured Switch.GetStatus replies).
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+OUT="$ROOT/scripts/shelly_parse/shelly_parse"
+CXX="${CXX:-c++}"
+ARDUINOJSON_DIR="${ARDUINOJSON_DIR:-$ROOT/.pio/libdeps/seeed_xiao_esp32c3/ArduinoJson/src}"
+
+if [ ! -f "$ARDUINOJSON_DIR/ArduinoJson.h" ]; then
+  echo "ArduinoJson not found in $ARDUINOJSON_DIR (run 'pio run' or set ARDUINOJSON_DIR)" >&2
+  exit 1
+fi
+
+"$CXX" -std=c++17 -O2 -Wall \
+  -DARDUINOJSON_ENABLE_ARDUINO_STREAM=1 \
+  -DARDUINOJSON_ENABLE_ARDUINO_STRING=0 \
+  -DARDUINOJSON_ENABLE_ARDUINO_PRINT=0 \
+  -I"$ROOT/scripts/shelly_parse" -I"$ARDUINOJSON_DIR" -I"$ROOT/include" \
+  "$ROOT/scripts/shelly_parse/shelly_parse.cpp" \
+  "$ROOT/src/io/ShellyStatus.cpp" \
+  -o "$OUT"
+
+echo "Built $OUT"
+"$OUT" --dir "$ROOT/scripts/shelly_parse/payloads" "$@"
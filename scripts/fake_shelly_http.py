@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Stand-in for a Shelly Gen2 switch's HTTP RPC API, with injected latency
+and dropped requests, for exercising ShellyHandler without the real relay.
+
+    scripts/fake_shelly_http.py [--port 8080] [--id 0] [--delay-ms 0]
+                                [--jitter-ms 0] [--drop 0.0]
+
+Point SHELLY_IP at this PC (the firmware always uses port 80, so run it
+with --port 80 there) or run scripts/build_shelly_http_check.sh, whose host
+harness connects to this port directly.
+
+Answers Switch.Set, Switch.GetStatus, Sys.GetStatus, Shelly.Reboot and
+Webhook.List/Create/Delete over GET and POST with keep-alive replies.
+Every RPC is first delayed by --delay-ms plus up to --jitter-ms, then
+dropped with probability --drop: the connection is closed after the
+request was read and nothing is answered, as when the Shelly reboots or
+WiFi drops mid-request. A delay beyond the client's timeout exercises its
+timeout path.
+
+Settings can be changed while running (the /mock/ paths are never delayed
+or dropped):
+
+    /mock/config?delay_ms=4000&jitter_ms=0&drop=0.2
+    /mock/config?drop_next=1&match=Switch.Set   drop the next N matching RPCs
+    /mock/stats                                  counters as key=value text
+"""
+
+import argparse
+import json
+import random
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+class Shelly:
+    def __init__(self, switch_id, delay_ms, jitter_ms, drop):
+        self.lock = threading.Lock()
+        self.id = switch_id
+        self.output = False
+        self.delay_ms = delay_ms
+        self.jitter_ms = jitter_ms
+        self.drop = drop
+        self.drop_next = 0
+        self.match = ""
+        self.hooks = []
+        self.counts = {}
+
+    def count(self, key):
+        self.counts[key] = self.counts.get(key, 0) + 1
+
+    def status(self):
+        power = 1000.0 if self.output else 0.0
+        return {
+            "id": self.id, "source": "http", "output": self.output,
+            "apower": power, "voltage": 230.0, "current": round(power / 230.0, 3),
+            "temperature": {"tC": 35.0, "tF": 95.0},
+            "aenergy": {"total": 0.0, "by_minute": [0.0, 0.0, 0.0], "minute_ts": int(time.time())},
+        }
+
+    def call(self, method, params):
+        """Returns (http status, result object)."""
+        if method == "Switch.Set":
+            was_on = self.output
+            self.output = str(params.get("on", "false")).lower() == "true"
+            return 200, {"was_on": was_on}
+        if method == "Switch.GetStatus":
+            return 200, self.status()
+        if method == "Sys.GetStatus":
+            return 200, {"mac": "FAKE00000000", "uptime": int(time.monotonic()), "restart_required": False}
+        if method == "Shelly.Reboot":
+            return 200, None
+        if method == "Webhook.List":
+            return 200, {"hooks": self.hooks, "rev": len(self.hooks)}
+        if method == "Webhook.Create":
+            hook = dict(params, id=len(self.hooks) + 1)
+            self.hooks.append(hook)
+            return 200, {"id": hook["id"], "rev": len(self.hooks)}
+        if method == "Webhook.Delete":
+            self.hooks = [h for h in self.hooks if h.get("id") != params.get("id")]
+            return 200, {"rev": len(self.hooks)}
+        return 404, {"code": 404, "message": "No handler for " + method}
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive, as the Shelly does
+    shelly = None
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_GET(self):
+        self.handle_rpc(None)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        self.handle_rpc(self.rfile.read(length) if length else b"")
+
+    def handle_rpc(self, body):
+        url = urlparse(self.path)
+        if url.path.startswith("/mock/"):
+            self.handle_mock(url)
+            return
+        if not url.path.startswith("/rpc/"):
+            self.reply(404, {"code": 404, "message": "Not found"})
+            return
+
+        method = url.path[len("/rpc/"):]
+        params = {k: v[0] for k, v in parse_qs(url.query).items()}
+        if body:
+            try:
+                params.update(json.loads(body))
+            except ValueError:
+                self.reply(400, {"code": -103, "message": "Invalid JSON"})
+                return
+
+        s = self.shelly
+        with s.lock:
+            s.count("rpc")
+            s.count(method)
+            delay = (s.delay_ms + random.uniform(0, s.jitter_ms)) / 1000.0
+            drop = False
+            if s.drop_next > 0 and s.match in method:
+                s.drop_next -= 1
+                drop = True
+            elif random.random() < s.drop:
+                drop = True
+        if delay > 0:
+            time.sleep(delay)
+        if drop:
+            with s.lock:
+                s.count("dropped")
+            log(f"{method} {params} -> dropped")
+            self.close_connection = True
+            return
+
+        with s.lock:
+            code, result = s.call(method, params)
+            output = s.output
+        log(f"{method} {params} -> {code} output={str(output).lower()}")
+        self.reply(code, result)
+
+    def handle_mock(self, url):
+        s = self.shelly
+        q = {k: v[0] for k, v in parse_qs(url.query).items()}
+        with s.lock:
+            if url.path == "/mock/config":
+                s.delay_ms = float(q.get("delay_ms", s.delay_ms))
+                s.jitter_ms = float(q.get("jitter_ms", s.jitter_ms))
+                s.drop = float(q.get("drop", s.drop))
+                s.drop_next = int(q.get("drop_next", s.drop_next))
+                s.match = q.get("match", s.match)
+                if "output" in q:
+                    s.output = q["output"].lower() == "true"
+            stats = dict(s.counts, output=int(s.output), delay_ms=s.delay_ms,
+                         jitter_ms=s.jitter_ms, drop=s.drop, drop_next=s.drop_next)
+        text = "".join(f"{k}={v}\n" for k, v in sorted(stats.items()))
+        self.send_raw(200, "text/plain", text.encode())
+
+    def reply(self, code, result):
+        self.send_raw(code, "application/json", json.dumps(result, separators=(",", ":")).encode())
+
+    def send_raw(self, code, content_type, data):
+        try:
+            self.send_response(code)
+            self.send_header("Content-Type", content_type)
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+        except (BrokenPipeError, ConnectionResetError):
+            # The client gave up waiting (timeout) and closed the socket
+            self.close_connection = True
+
+
+def log(msg):
+    print(f"[fake-shelly] {msg}", file=sys.stderr, flush=True)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--bind", default="127.0.0.1")
+    ap.add_argument("--id", type=int, default=0, help="switch id")
+    ap.add_argument("--delay-ms", type=float, default=0.0)
+    ap.add_argument("--jitter-ms", type=float, default=0.0)
+    ap.add_argument("--drop", type=float, default=0.0, help="probability of dropping a request")
+    ap.add_argument("--seed", type=int, help="random seed, for repeatable drops")
+    args = ap.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+    Handler.shelly = Shelly(args.id, args.delay_ms, args.jitter_ms, args.drop)
+    server = ThreadingHTTPServer((args.bind, args.port), Handler)
+    server.daemon_threads = True
+    log(f"switch:{args.id} on {args.bind}:{args.port} delay={args.delay_ms}ms "
+        f"jitter={args.jitter_ms}ms drop={args.drop}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
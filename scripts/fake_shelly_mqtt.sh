@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Minimal stand-in for a Shelly Gen2 switch on a local mosquitto broker, for
+# exercising the firmware's MQTT transport without the real relay.
+#
+#   mosquitto -v                                   # broker on this PC
+#   scripts/fake_shelly_mqtt.sh [host] [prefix] [switch-id]
+#   mosquitto_sub -h localhost -t 'car-heater/#' -v   # heater telemetry
+#
+# Point MQTT_BROKER_HOST at this PC and SHELLY_MQTT_PREFIX at the prefix.
+# Answers Switch.Set / Switch.GetStatus on <prefix>/rpc (reply to
+# <src>/rpc) and pushes NotifyStatus and status/switch:<id> on every change.
+# Needs mosquitto-clients and jq.
+HOST="${1:-localhost}"
+PREFIX="${2:-shelly-fake}"
+ID="${3:-0}"
+OUTPUT=false
+
+status_json() {
+  local power=0
+  [ "$OUTPUT" = true ] && power=1000
+  printf '{"id":%s,"source":"mqtt","output":%s,"apower":%s,"voltage":230.0,"current":%s,"temperature":{"tC":35.0},"aenergy":{"total":0}}' \
+    "$ID" "$OUTPUT" "$power" "$(awk "BEGIN{print $power/230}")"
+}
+
+push_status() {
+  mosquitto_pub -h "$HOST" -t "$PREFIX/status/switch:$ID" -m "$(status_json)"
+  mosquitto_pub -h "$HOST" -t "$PREFIX/events/rpc" \
+    -m "{\"src\":\"$PREFIX\",\"dst\":\"$PREFIX/events\",\"method\":\"NotifyStatus\",\"params\":{\"switch:$ID\":{\"id\":$ID,\"output\":$OUTPUT}}}"
+}
+
+echo "Fake Shelly '$PREFIX' switch:$ID on $HOST (output=$OUTPUT)"
+mosquitto_sub -h "$HOST" -t "$PREFIX/rpc" | while read -r frame; do
+  rpc_id=$(jq -r '.id' <<<"$frame")
+  src=$(jq -r '.src' <<<"$frame")
+  method=$(jq -r '.method' <<<"$frame")
+  case "$method" in
+    Switch.Set)
+      was_on=$OUTPUT
+      OUTPUT=$(jq -r '.params.on' <<<"$frame")
+      result="{\"was_on\":$was_on}"
+      ;;
+    Switch.GetStatus)
+      result=$(status_json)
+      ;;
+    *)
+      mosquitto_pub -h "$HOST" -t "$src/rpc" \
+        -m "{\"id\":$rpc_id,\"src\":\"$PREFIX\",\"dst\":\"$src\",\"error\":{\"code\":404,\"message\":\"No handler for $method\"}}"
+      continue
+      ;;
+  esac
+  echo "$method -> output=$OUTPUT"
+  mosquitto_pub -h "$HOST" -t "$src/rpc" -m "{\"id\":$rpc_id,\"src\":\"$PREFIX\",\"dst\":\"$src\",\"result\":$result}"
+  if [ "$method" = Switch.Set ]; then push_status; fi
+done
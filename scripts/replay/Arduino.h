@@ -0,0 +1,34 @@
+#pragma once
+
+// Minimal host stand-in for <Arduino.h>, just enough for the pure
+// controller sources (Thermostat, HeatingCalculator, KFactorCalibrator)
+// to build on a PC for replay. Not a general Arduino emulation.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+struct HostSerial
+{
+  bool quiet = false;
+
+  int printf(const char *fmt, ...)
+  {
+    if (quiet)
+      return 0;
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+  }
+  void println(const char *s)
+  {
+    if (!quiet)
+      puts(s);
+  }
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,290 @@
+// Host-side replay of SampleRecorder files (see include/core/RecordingFormat.h).
+//
+// Feeds recorded samples through the firmware's Thermostat and compares its
+// decisions with the relay transitions that actually happened. Heating
+// runs (relay on -> off) are checked against HeatingCalculator and give a
+// kFactor via KFactorCalibrator. Build with scripts/build_replay.sh.
+//
+//   replay [--target C] [--hyst C] [--k K] [--sensor N] [--speed X] [--csv] files...
+//
+// Files are read in the order given (pass rec.old.bin before rec.bin).
+// --speed X sleeps recorded time / X between records; 0 (default) runs
+// as fast as possible.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "core/RecordingFormat.h"
+#include "heating/HeatingCalculator.h"
+#include "heating/KFactorCalibrator.h"
+#include "heating/Thermostat.h"
+
+namespace
+{
+struct Options
+{
+  float targetC = 10.0f;
+  float hystC = 3.0f;
+  float kFactor = 20.99f;
+  int sensor = recording::SENSOR_AGGREGATE;
+  double speed = 0.0;
+  bool csv = false;
+  std::vector<const char *> files;
+};
+
+struct Event
+{
+  uint64_t ms; // monotonic across files and reboots
+  recording::Record rec;
+};
+
+struct Totals
+{
+  uint32_t blocks = 0;
+  uint32_t badBlocks = 0;
+  uint32_t sessions = 0;
+};
+
+void usage()
+{
+  fprintf(stderr,
+          "usage: replay [--target C] [--hyst C] [--k K] [--sensor N|agg] "
+          "[--speed X] [--csv] files...\n");
+  exit(2);
+}
+
+Options parseArgs(int argc, char **argv)
+{
+  Options o;
+  for (int i = 1; i < argc; ++i)
+  {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc)
+        usage();
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--target"))
+      o.targetC = static_cast<float>(atof(next()));
+    else if (!strcmp(argv[i], "--hyst"))
+      o.hystC = static_cast<float>(atof(next()));
+    else if (!strcmp(argv[i], "--k"))
+      o.kFactor = static_cast<float>(atof(next()));
+    else if (!strcmp(argv[i], "--speed"))
+      o.speed = atof(next());
+    else if (!strcmp(argv[i], "--sensor"))
+    {
+      const char *v = next();
+      o.sensor = strcmp(v, "agg") ? atoi(v) : recording::SENSOR_AGGREGATE;
+    }
+    else if (!strcmp(argv[i], "--csv"))
+      o.csv = true;
+    else if (argv[i][0] == '-')
+      usage();
+    else
+      o.files.push_back(argv[i]);
+  }
+  if (o.files.empty())
+    usage();
+  return o;
+}
+
+// Appends all events of one file. Blocks failing their CRC are skipped by
+// scanning forward for the next block magic. Progress goes to info.
+bool loadFile(const char *path, std::vector<Event> &events, uint64_t &clockMs,
+              uint32_t &lastMs, Totals &totals, FILE *info)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (data.size() < sizeof(recording::FileHeader))
+  {
+    fprintf(stderr, "%s: too short\n", path);
+    return false;
+  }
+
+  recording::FileHeader fh;
+  memcpy(&fh, data.data(), sizeof(fh));
+  if (fh.magic != recording::FILE_MAGIC || fh.version != recording::FILE_VERSION ||
+      fh.recordSize != sizeof(recording::Record))
+  {
+    fprintf(stderr, "%s: not a recording (or unsupported version)\n", path);
+    return false;
+  }
+  fprintf(info, "%s: started at epoch %llu\n", path, static_cast<unsigned long long>(fh.startEpochUtc));
+
+  size_t pos = sizeof(fh);
+  recording::Record recs[recording::RECORDS_PER_BLOCK];
+  while (pos + sizeof(recording::BlockHeader) <= data.size())
+  {
+    recording::BlockHeader bh;
+    memcpy(&bh, &data[pos], sizeof(bh));
+    const size_t bytes = sizeof(bh) + sizeof(recording::Record) * bh.count;
+    bool ok = bh.magic == recording::BLOCK_MAGIC && bh.count > 0 &&
+              bh.count <= recording::RECORDS_PER_BLOCK && pos + bytes <= data.size();
+    if (ok)
+    {
+      memcpy(recs, &data[pos + sizeof(bh)], sizeof(recording::Record) * bh.count);
+      ok = recording::blockCrc(bh, recs) == bh.crc32;
+    }
+    if (!ok)
+    {
+      ++totals.badBlocks;
+      ++pos;
+      while (pos + 2 <= data.size() &&
+             !(data[pos] == (recording::BLOCK_MAGIC & 0xFF) && data[pos + 1] == (recording::BLOCK_MAGIC >> 8)))
+        ++pos;
+      continue;
+    }
+
+    ++totals.blocks;
+    // millis() going backwards means the device rebooted in between
+    if (totals.blocks == 1 || bh.firstMs < lastMs)
+    {
+      ++totals.sessions;
+      clockMs += (totals.blocks == 1) ? 0 : 1000;
+    }
+    else
+    {
+      clockMs += bh.firstMs - lastMs;
+    }
+    lastMs = bh.firstMs;
+
+    for (uint16_t i = 0; i < bh.count; ++i)
+    {
+      clockMs += recs[i].dtMs;
+      lastMs += recs[i].dtMs;
+      events.push_back(Event{clockMs, recs[i]});
+    }
+    pos += bytes;
+  }
+  return true;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const Options opt = parseArgs(argc, argv);
+
+  std::vector<Event> events;
+  uint64_t clockMs = 0;
+  uint32_t lastMs = 0;
+  Totals totals;
+  // With --csv only the CSV goes to stdout
+  FILE *info = opt.csv ? stderr : stdout;
+  for (const char *f : opt.files)
+    loadFile(f, events, clockMs, lastMs, totals, info);
+  fprintf(info, "blocks=%u bad=%u sessions=%u events=%zu\n",
+          totals.blocks, totals.badBlocks, totals.sessions, events.size());
+  if (events.empty())
+    return 1;
+
+  Serial.quiet = opt.csv;
+  Thermostat thermostat(opt.targetC, opt.hystC);
+  HeatingCalculator calculator;
+  KFactorCalibrator calibrator;
+
+  bool haveSim = false;
+  bool simOn = false;
+  uint32_t simSwitches = 0;
+  uint32_t realSwitches = 0;
+  uint64_t simOnMs = 0;
+  uint64_t realOnMs = 0;
+  bool realOn = false;
+  uint64_t prevMs = events.front().ms;
+
+  // Current heating run (recorded relay on)
+  bool inRun = false;
+  uint64_t runStartMs = 0;
+  int32_t runStartC = 0;
+  int32_t lastC = 0;
+  bool haveC = false;
+  uint32_t runs = 0;
+  double kSum = 0.0;
+
+  if (opt.csv)
+    printf("t_s,raw_c,temp_c,real_on,sim_on\n");
+  else
+    printf("\n%8s %8s %8s %9s %9s %7s\n", "start_s", "from_c", "to_c", "took_s", "model_s", "k");
+
+  const auto wallStart = std::chrono::steady_clock::now();
+  for (const Event &e : events)
+  {
+    if (opt.speed > 0.0)
+    {
+      const auto due = wallStart + std::chrono::microseconds(
+                                       static_cast<int64_t>((e.ms - events.front().ms) * 1000.0 / opt.speed));
+      std::this_thread::sleep_until(due);
+    }
+
+    const uint64_t dt = e.ms - prevMs;
+    prevMs = e.ms;
+    if (haveSim && simOn)
+      simOnMs += dt;
+    if (realOn)
+      realOnMs += dt;
+
+    const auto type = static_cast<recording::RecordType>(e.rec.type);
+    if (type == recording::RecordType::RelayOn || type == recording::RecordType::RelayOff)
+    {
+      const bool on = type == recording::RecordType::RelayOn;
+      if (on != realOn)
+        ++realSwitches;
+      realOn = on;
+
+      if (on && haveC)
+      {
+        inRun = true;
+        runStartMs = e.ms;
+        runStartC = lastC;
+      }
+      else if (!on && inRun)
+      {
+        inRun = false;
+        const float fromC = runStartC / 100.0f;
+        const float toC = lastC / 100.0f;
+        const float tookS = (e.ms - runStartMs) / 1000.0f;
+        if (toC - fromC >= 1.0f)
+        {
+          const float modelS = calculator.estimateWarmupSeconds(opt.kFactor, fromC, toC);
+          const float k = calibrator.deriveKFactor(fromC, toC, tookS);
+          ++runs;
+          kSum += k;
+          if (!opt.csv)
+            printf("%8.0f %8.2f %8.2f %9.0f %9.0f %7.2f\n",
+                   runStartMs / 1000.0, fromC, toC, tookS, modelS, k);
+        }
+      }
+      continue;
+    }
+
+    if (static_cast<int>(e.rec.sensor) != opt.sensor)
+      continue;
+
+    lastC = e.rec.centiC;
+    haveC = true;
+    const bool on = thermostat.updateCentiC(e.rec.centiC);
+    if (haveSim && on != simOn)
+      ++simSwitches;
+    simOn = on;
+    haveSim = true;
+
+    if (opt.csv)
+      printf("%.1f,%.2f,%.2f,%d,%d\n", e.ms / 1000.0, e.rec.rawCentiC / 100.0,
+             e.rec.centiC / 100.0, realOn ? 1 : 0, simOn ? 1 : 0);
+  }
+
+  const double spanS = (events.back().ms - events.front().ms) / 1000.0;
+  const double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  fprintf(info,
+          "\nspan=%.0fs replayed in %.3fs\n"
+          "recorded: switches=%u duty=%.1f%%\n"
+          "simulated (target %.1f, hyst %.1f): switches=%u duty=%.1f%%\n"
+          "heating runs >=1C: %u, mean k=%.2f (model k=%.2f)\n",
+          spanS, wallS,
+          realSwitches, spanS > 0 ? 100.0 * realOnMs / 1000.0 / spanS : 0.0,
+          opt.targetC, opt.hystC, simSwitches, spanS > 0 ? 100.0 * simOnMs / 1000.0 / spanS : 0.0,
+          runs, runs ? kSum / runs : 0.0, opt.kFactor);
+  return 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+// Minimal host stand-in for <Arduino.h>, just enough for ShellyHandler to
+// build on a PC and talk HTTP to scripts/fake_shelly_http.py. Not a
+// general Arduino emulation: String covers the operations the handler
+// uses, and Stream::readBytes waits like Arduino's timed read.
+
+#include <chrono>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+inline uint32_t millis()
+{
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+class String
+{
+public:
+  String() = default;
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                                    !std::is_same<T, bool>::value,
+                                                int>::type = 0>
+  explicit String(T v) : s_(std::to_string(v))
+  {
+  }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(s_.size()); }
+  bool isEmpty() const { return s_.empty(); }
+  bool concat(const char *s)
+  {
+    s_ += s;
+    return true;
+  }
+  bool concat(char c)
+  {
+    s_ += c;
+    return true;
+  }
+  bool reserve(unsigned int size)
+  {
+    s_.reserve(size);
+    return true;
+  }
+
+  String &operator+=(const String &rhs)
+  {
+    s_ += rhs.s_;
+    return *this;
+  }
+  String &operator+=(const char *rhs)
+  {
+    s_ += rhs;
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s_ += c;
+    return *this;
+  }
+  template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                                    !std::is_same<T, bool>::value,
+                                                int>::type = 0>
+  String &operator+=(T v)
+  {
+    s_ += std::to_string(v);
+    return *this;
+  }
+
+  bool operator==(const String &rhs) const { return s_ == rhs.s_; }
+  bool operator==(const char *rhs) const { return s_ == (rhs ? rhs : ""); }
+  bool operator!=(const String &rhs) const { return s_ != rhs.s_; }
+  bool operator!=(const char *rhs) const { return !(*this == rhs); }
+
+private:
+  std::string s_;
+};
+
+// Result type of a String concatenation, as in the Arduino core (ArduinoJson
+// checks for it)
+class StringSumHelper : public String
+{
+public:
+  using String::String;
+  StringSumHelper(const String &s) : String(s) {}
+};
+
+template <typename T>
+inline StringSumHelper operator+(const String &lhs, const T &rhs)
+{
+  StringSumHelper sum(lhs);
+  sum += rhs;
+  return sum;
+}
+
+struct HostSerial
+{
+  bool quiet = false;
+
+  int printf(const char *fmt, ...)
+  {
+    if (quiet)
+      return 0;
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+  }
+  void print(const char *s)
+  {
+    if (!quiet)
+      fputs(s, stdout);
+  }
+  void print(const String &s) { print(s.c_str()); }
+  void println(const char *s = "")
+  {
+    if (!quiet)
+      puts(s);
+  }
+  void println(const String &s) { println(s.c_str()); }
+  void println(int v)
+  {
+    if (!quiet)
+      ::printf("%d\n", v);
+  }
+};
+
+inline HostSerial Serial;
+
+class Stream
+{
+public:
+  virtual ~Stream() = default;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t write(uint8_t) = 0;
+
+  void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+
+  // Like Arduino's Stream: each byte may take up to the timeout to arrive
+  size_t readBytes(char *buffer, size_t length)
+  {
+    size_t n = 0;
+    while (n < length)
+    {
+      const int c = timedRead();
+      if (c < 0)
+        break;
+      buffer[n++] = static_cast<char>(c);
+    }
+    return n;
+  }
+
+protected:
+  int timedRead()
+  {
+    const uint32_t start = millis();
+    do
+    {
+      const int c = read();
+      if (c >= 0)
+        return c;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (millis() - start < timeoutMs_);
+    return -1;
+  }
+
+  unsigned long timeoutMs_ = 1000;
+};
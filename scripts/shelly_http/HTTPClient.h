@@ -0,0 +1,195 @@
+#pragma once
+
+// Host stand-in for the ESP32 core's HTTPClient, covering what
+// ShellyHandler uses: keep-alive reuse, connect and read timeouts, GET/POST
+// with a Content-Length reply, and the same negative error codes. The
+// request goes to 127.0.0.1 on SHELLY_MOCK_PORT (default 8080) whatever
+// host and port the firmware asks for, so the mock needs no privileges.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient
+{
+public:
+  void setReuse(bool reuse) { reuse_ = reuse; }
+  void setConnectTimeout(int32_t ms) { connectTimeoutMs_ = ms; }
+  void setTimeout(uint16_t ms) { timeoutMs_ = ms; }
+
+  bool begin(WiFiClient &client, const String &, uint16_t, const String &uri)
+  {
+    client_ = &client;
+    uri_ = uri.c_str();
+    headers_.clear();
+    size_ = -1;
+    canReuse_ = reuse_;
+    return true;
+  }
+
+  void addHeader(const String &name, const String &value)
+  {
+    headers_ += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+  }
+
+  int GET() { return sendRequest("GET", nullptr); }
+  int POST(const char *payload) { return sendRequest("POST", payload); }
+  int POST(const String &payload) { return sendRequest("POST", payload.c_str()); }
+
+  int getSize() const { return size_; }
+
+  String getString()
+  {
+    std::string body;
+    if (client_ == nullptr)
+      return String();
+    client_->setTimeout(timeoutMs_);
+    if (size_ >= 0)
+    {
+      body.resize(static_cast<size_t>(size_));
+      body.resize(client_->readBytes(&body[0], body.size()));
+    }
+    else
+    {
+      // No length: the body runs until the server closes
+      char c;
+      while (client_->connected() && client_->readBytes(&c, 1) == 1)
+        body += c;
+      canReuse_ = false;
+    }
+    return String(body);
+  }
+
+  void end()
+  {
+    if (client_ == nullptr || !client_->connected())
+      return;
+    while (client_->available() > 0)
+      client_->read();
+    if (!(reuse_ && canReuse_))
+      client_->stop();
+  }
+
+  static String errorToString(int error)
+  {
+    switch (error)
+    {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+      return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+      return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+      return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:
+      return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:
+      return "connection lost";
+    case HTTPC_ERROR_NO_STREAM:
+      return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+      return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM:
+      return "too less ram";
+    case HTTPC_ERROR_ENCODING:
+      return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE:
+      return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT:
+      return "read Timeout";
+    default:
+      return String();
+    }
+  }
+
+private:
+  int sendRequest(const char *method, const char *payload)
+  {
+    if (client_ == nullptr)
+      return HTTPC_ERROR_NOT_CONNECTED;
+    if (!client_->connected())
+    {
+      const char *port = getenv("SHELLY_MOCK_PORT");
+      if (!client_->connect("127.0.0.1", static_cast<uint16_t>(port ? atoi(port) : 8080), connectTimeoutMs_))
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    while (client_->available() > 0)
+      client_->read();
+
+    std::string head = std::string(method) + " " + uri_ + " HTTP/1.1\r\nHost: shelly\r\n" +
+                       "User-Agent: ESP32HTTPClient\r\nConnection: " + (reuse_ ? "keep-alive" : "close") + "\r\n" +
+                       headers_;
+    const size_t payloadLen = payload ? strlen(payload) : 0;
+    if (payload)
+      head += "Content-Length: " + std::to_string(payloadLen) + "\r\n";
+    head += "\r\n";
+    if (client_->write(reinterpret_cast<const uint8_t *>(head.data()), head.size()) != head.size())
+      return HTTPC_ERROR_SEND_HEADER_FAILED;
+    if (payloadLen > 0 &&
+        client_->write(reinterpret_cast<const uint8_t *>(payload), payloadLen) != payloadLen)
+      return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    return readHeaders();
+  }
+
+  // Status line and headers, each line within the read timeout of the
+  // previous data, as the ESP32 client does
+  int readHeaders()
+  {
+    int code = 0;
+    std::string line;
+    uint32_t lastDataMs = millis();
+    while (client_->connected())
+    {
+      const int c = client_->read();
+      if (c < 0)
+      {
+        if (millis() - lastDataMs > timeoutMs_)
+          return HTTPC_ERROR_READ_TIMEOUT;
+        delay(1);
+        continue;
+      }
+      lastDataMs = millis();
+      if (c != '\n')
+      {
+        if (c != '\r')
+          line += static_cast<char>(c);
+        continue;
+      }
+      if (line.empty())
+        return code > 0 ? code : HTTPC_ERROR_NO_HTTP_SERVER;
+      if (code == 0)
+      {
+        if (line.compare(0, 5, "HTTP/") != 0 || line.size() < 12)
+          return HTTPC_ERROR_NO_HTTP_SERVER;
+        code = atoi(line.c_str() + 9);
+      }
+      else if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0)
+        size_ = atoi(line.c_str() + 15);
+      else if (strncasecmp(line.c_str(), "Connection:", 11) == 0 && strstr(line.c_str(), "close"))
+        canReuse_ = false;
+      line.clear();
+    }
+    return HTTPC_ERROR_CONNECTION_LOST;
+  }
+
+  WiFiClient *client_ = nullptr;
+  std::string uri_;
+  std::string headers_;
+  bool reuse_ = true;
+  bool canReuse_ = true;
+  int32_t connectTimeoutMs_ = 5000;
+  uint16_t timeoutMs_ = 5000;
+  int size_ = -1;
+};
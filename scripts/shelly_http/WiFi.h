@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+struct IPAddress
+{
+  String toString() const { return "127.0.0.1"; }
+};
+
+// The host is always "connected"; the mock runs on loopback
+struct HostWiFi
+{
+  int status() const { return WL_CONNECTED; }
+  IPAddress localIP() const { return IPAddress(); }
+};
+
+inline HostWiFi WiFi;
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Non-blocking TCP client over a POSIX socket with the ESP32 WiFiClient's
+// semantics: read() returns -1 when nothing has arrived, and connected()
+// stays true while unread data is buffered even if the peer has closed.
+class WiFiClient : public Stream
+{
+public:
+  ~WiFiClient() override { stop(); }
+
+  int connect(const char *host, uint16_t port, int32_t timeoutMs)
+  {
+    stop();
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &res) != 0 || res == nullptr)
+      return 0;
+    fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd_ < 0)
+    {
+      freeaddrinfo(res);
+      return 0;
+    }
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    int rc = ::connect(fd_, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc < 0 && errno == EINPROGRESS)
+    {
+      pollfd p{fd_, POLLOUT, 0};
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+        rc = 0;
+    }
+    if (rc < 0)
+    {
+      stop();
+      return 0;
+    }
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return 1;
+  }
+
+  uint8_t connected()
+  {
+    if (fd_ < 0)
+      return 0;
+    if (available() > 0)
+      return 1;
+    char c;
+    const ssize_t n = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+      stop();
+      return 0;
+    }
+    return 1;
+  }
+
+  void stop()
+  {
+    if (fd_ >= 0)
+      close(fd_);
+    fd_ = -1;
+  }
+
+  int available() override
+  {
+    if (fd_ < 0)
+      return 0;
+    int n = 0;
+    return ioctl(fd_, FIONREAD, &n) == 0 ? n : 0;
+  }
+
+  int read() override
+  {
+    unsigned char c;
+    return (fd_ >= 0 && recv(fd_, &c, 1, MSG_DONTWAIT) == 1) ? c : -1;
+  }
+
+  int peek() override
+  {
+    unsigned char c;
+    return (fd_ >= 0 && recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1) ? c : -1;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t *data, size_t len)
+  {
+    size_t sent = 0;
+    while (fd_ >= 0 && sent < len)
+    {
+      const ssize_t n = send(fd_, data + sent, len - sent, MSG_NOSIGNAL);
+      if (n > 0)
+        sent += static_cast<size_t>(n);
+      else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      {
+        pollfd p{fd_, POLLOUT, 0};
+        poll(&p, 1, 100);
+      }
+      else
+        break;
+    }
+    return sent;
+  }
+
+private:
+  int fd_ = -1;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS pieces ShellyHandler uses: tasks are
+// std::threads, one tick is one millisecond, semaphores and critical
+// sections are std mutexes. Not a scheduler emulation.
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+using TickType_t = uint32_t;
+using BaseType_t = int;
+using UBaseType_t = unsigned int;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY UINT32_MAX
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+struct portMUX_TYPE
+{
+  std::recursive_mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->m.lock()
+#define portEXIT_CRITICAL(mux) (mux)->m.unlock()
+
+namespace hostrtos
+{
+// Counting semaphore; a mutex is one that starts given
+struct Semaphore
+{
+  std::mutex m;
+  std::condition_variable cv;
+  unsigned count;
+  unsigned max;
+
+  Semaphore(unsigned initial, unsigned maxCount) : count(initial), max(maxCount) {}
+
+  bool take(TickType_t ticks)
+  {
+    std::unique_lock<std::mutex> lock(m);
+    auto ready = [this] { return count > 0; };
+    if (ticks == portMAX_DELAY)
+      cv.wait(lock, ready);
+    else if (!cv.wait_for(lock, std::chrono::milliseconds(ticks), ready))
+      return false;
+    --count;
+    return true;
+  }
+
+  bool give()
+  {
+    std::lock_guard<std::mutex> lock(m);
+    if (count >= max)
+      return false;
+    ++count;
+    cv.notify_one();
+    return true;
+  }
+};
+
+struct Task
+{
+  Semaphore notify{0, UINT32_MAX};
+};
+
+inline thread_local Task *current = nullptr;
+
+inline Task *self()
+{
+  // Threads not created by xTaskCreate (main) get a task on first use
+  if (current == nullptr)
+    current = new Task();
+  return current;
+}
+} // namespace hostrtos
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+inline TickType_t xTaskGetTickCount()
+{
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return static_cast<TickType_t>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+using SemaphoreHandle_t = hostrtos::Semaphore *;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new hostrtos::Semaphore(1, 1); }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new hostrtos::Semaphore(0, 1); }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) { return sem->take(ticks) ? pdTRUE : pdFALSE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { return sem->give() ? pdTRUE : pdFALSE; }
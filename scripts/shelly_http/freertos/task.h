@@ -0,0 +1,38 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+using TaskHandle_t = hostrtos::Task *;
+using TaskFunction_t = void (*)(void *);
+
+// Stack size and priority mean nothing on the host; the thread is detached
+// like a task that never returns
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *, uint32_t, void *param, UBaseType_t,
+                              TaskHandle_t *handle)
+{
+  auto *task = new hostrtos::Task();
+  if (handle)
+    *handle = task;
+  std::thread([fn, param, task] {
+    hostrtos::current = task;
+    fn(param);
+  }).detach();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+  hostrtos::Semaphore &n = hostrtos::self()->notify;
+  if (!n.take(ticks))
+    return 0;
+  uint32_t value = 1;
+  if (clearOnExit)
+  {
+    std::lock_guard<std::mutex> lock(n.m);
+    value += n.count;
+    n.count = 0;
+  }
+  return value;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) { task->notify.give(); }
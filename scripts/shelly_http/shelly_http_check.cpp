@@ -0,0 +1,316 @@
+// Host check of ShellyHandler's command queue and HTTP failure handling
+// against scripts/fake_shelly_http.py. The firmware's src/io/ShellyHandler.cpp
+// is built unchanged on shims for FreeRTOS (threads), WiFiClient (POSIX
+// sockets) and HTTPClient; the mock is steered between scenarios through
+// its /mock/config path. Build and run with scripts/build_shelly_http_check.sh.
+//
+//   shelly_http_check [--rounds N] [--drop P] [--verbose]
+//
+// Scenarios:
+//   last writer wins  on/off/on queued within the debounce: the first
+//                     completes Superseded, one Switch.Set reaches the mock
+//   single retry      the mock drops the next Switch.Set on the kept-alive
+//                     socket; the handler retries once on a new connection
+//   no POST retry     the mock drops Shelly.Reboot after reading it; the
+//                     POST is not sent a second time
+//   timeout           replies delayed past the adaptive timeout: Failed,
+//                     the timeout doubles, and it recovers once replies
+//                     are prompt again
+//   drop rate         N alternating commands with random drops and jitter;
+//                     every completion must arrive
+// requestSwitch() must return at once in all of them. Exit status is 1 on
+// any failed check.
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include "io/ShellyHandler.h"
+
+namespace
+{
+using Result = ShellyHandler::Result;
+
+size_t g_failures = 0;
+uint32_t g_maxCallUs = 0;
+
+void check(bool ok, const char *what)
+{
+  printf("  %-4s %s\n", ok ? "ok" : "FAIL", what);
+  if (!ok)
+    ++g_failures;
+}
+
+// Mock control channel, on its own connection
+std::map<std::string, double> mock(const std::string &query)
+{
+  WiFiClient client;
+  HTTPClient http;
+  http.setReuse(false);
+  http.setTimeout(2000);
+  std::map<std::string, double> out;
+  if (!http.begin(client, "127.0.0.1", 80, String(query.c_str())) || http.GET() != 200)
+  {
+    fprintf(stderr, "mock not reachable (%s)\n", query.c_str());
+    exit(2);
+  }
+  const std::string text = http.getString().c_str();
+  http.end();
+  size_t pos = 0;
+  while (pos < text.size())
+  {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos)
+      eol = text.size();
+    const std::string line = text.substr(pos, eol - pos);
+    const size_t eq = line.find('=');
+    if (eq != std::string::npos)
+      out[line.substr(0, eq)] = atof(line.c_str() + eq + 1);
+    pos = eol + 1;
+  }
+  return out;
+}
+
+double delta(std::map<std::string, double> &after, std::map<std::string, double> &before, const char *key)
+{
+  return after[key] - before[key];
+}
+
+// One completion slot per queued command. Outcomes outlive the scenario
+// (static or leaked): a completion that missed its wait may still arrive.
+struct Outcome
+{
+  std::atomic<int> result{-1};
+  uint32_t queuedAtMs = 0;
+  uint32_t doneAfterMs = 0;
+  ShellyHandler::BreakerStats stats{};
+};
+
+void send(ShellyHandler &sh, bool on, Outcome &out)
+{
+  out.queuedAtMs = millis();
+  const auto start = std::chrono::steady_clock::now();
+  sh.requestSwitch(on, [&sh, &out](Result r) {
+    out.doneAfterMs = millis() - out.queuedAtMs;
+    out.stats = sh.breakerStats();
+    out.result = static_cast<int>(r);
+  });
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  if (us > g_maxCallUs)
+    g_maxCallUs = static_cast<uint32_t>(us);
+}
+
+bool wait(const Outcome &out, uint32_t timeoutMs)
+{
+  const uint32_t start = millis();
+  while (out.result < 0 && millis() - start < timeoutMs)
+    delay(5);
+  return out.result >= 0;
+}
+
+template <typename Pred>
+bool waitUntil(Pred pred, uint32_t timeoutMs)
+{
+  const uint32_t start = millis();
+  while (!pred() && millis() - start < timeoutMs)
+    delay(10);
+  return pred();
+}
+
+const char *resultName(int r)
+{
+  switch (r)
+  {
+  case static_cast<int>(Result::Ok):
+    return "Ok";
+  case static_cast<int>(Result::Failed):
+    return "Failed";
+  case static_cast<int>(Result::Superseded):
+    return "Superseded";
+  case static_cast<int>(Result::Suppressed):
+    return "Suppressed";
+  default:
+    return "none";
+  }
+}
+
+void lastWriterWins(ShellyHandler &sh)
+{
+  printf("last writer wins\n");
+  auto before = mock("/mock/config?delay_ms=0&jitter_ms=0&drop=0&drop_next=0");
+  static Outcome a, b, c;
+  send(sh, true, a);
+  send(sh, false, b);
+  send(sh, true, c);
+  const bool done = wait(c, 5000) && wait(a, 100) && wait(b, 100);
+  auto after = mock("/mock/stats");
+  printf("  first %s, second %s, third %s after %lu ms; Switch.Set at the mock: %.0f\n", resultName(a.result),
+         resultName(b.result), resultName(c.result), static_cast<unsigned long>(c.doneAfterMs),
+         delta(after, before, "Switch.Set"));
+  check(done, "all three completions arrived");
+  check(a.result == static_cast<int>(Result::Superseded), "first command completed Superseded");
+  check(c.result == static_cast<int>(Result::Ok), "last command completed Ok");
+  check(delta(after, before, "Switch.Set") == 1, "exactly one Switch.Set sent");
+  check(after["output"] == 1, "relay ends in the last requested state");
+}
+
+void singleRetry(ShellyHandler &sh)
+{
+  printf("single retry\n");
+  auto before = mock("/mock/config?drop_next=1&match=Switch.Set");
+  const uint32_t requests = sh.requestCount();
+  const uint32_t connects = sh.connectCount();
+  static Outcome d;
+  send(sh, false, d);
+  const bool done = wait(d, 5000);
+  auto after = mock("/mock/stats");
+  printf("  result %s after %lu ms; handler requests +%lu, connects +%lu; mock Switch.Set +%.0f, dropped +%.0f\n",
+         resultName(d.result), static_cast<unsigned long>(d.doneAfterMs),
+         static_cast<unsigned long>(sh.requestCount() - requests),
+         static_cast<unsigned long>(sh.connectCount() - connects), delta(after, before, "Switch.Set"),
+         delta(after, before, "dropped"));
+  check(done && d.result == static_cast<int>(Result::Ok), "command completed Ok despite the drop");
+  check(delta(after, before, "dropped") == 1 && delta(after, before, "Switch.Set") == 2,
+        "dropped Switch.Set was sent again once");
+  check(sh.connectCount() - connects == 1, "retry went over one new connection");
+  check(d.stats.consecutiveFailures == 0, "breaker saw no failure");
+}
+
+void noPostRetry(ShellyHandler &sh)
+{
+  printf("no POST retry\n");
+  sh.ping(); // make sure the next request goes over a kept-alive socket
+  auto before = mock("/mock/config?drop_next=1&match=Shelly.Reboot");
+  const bool ok = sh.reboot();
+  auto after = mock("/mock/stats");
+  printf("  reboot() %s; mock Shelly.Reboot +%.0f, dropped +%.0f\n", ok ? "true" : "false",
+         delta(after, before, "Shelly.Reboot"), delta(after, before, "dropped"));
+  check(!ok, "reboot() reported the failure");
+  check(delta(after, before, "Shelly.Reboot") == 1, "dropped Shelly.Reboot was not sent again");
+
+  // The failure backed the timeout off; let it settle for the next scenario
+  waitUntil(
+      [&sh] {
+        sh.ping();
+        return sh.breakerStats().timeoutBackoff == 0;
+      },
+      5000);
+}
+
+void timeoutPath(ShellyHandler &sh)
+{
+  printf("timeout\n");
+  const ShellyHandler::BreakerStats start = sh.breakerStats();
+  auto before = mock("/mock/config?delay_ms=4000");
+  static Outcome e;
+  send(sh, true, e);
+  const bool done = wait(e, 15000);
+  printf("  result %s after %lu ms; timeout %lu -> %lu ms, backoff %u, consecutive failures %u\n",
+         resultName(e.result), static_cast<unsigned long>(e.doneAfterMs), static_cast<unsigned long>(start.timeoutMs),
+         static_cast<unsigned long>(e.stats.timeoutMs), e.stats.timeoutBackoff, e.stats.consecutiveFailures);
+  check(done && e.result == static_cast<int>(Result::Failed), "command completed Failed");
+  check(e.doneAfterMs < 2 * start.timeoutMs + ShellyHandler::SWITCH_DEBOUNCE_MS + 500,
+        "gave up after the request and its one retry timed out");
+  check(e.stats.timeoutBackoff == 1 && e.stats.timeoutMs == 2 * start.timeoutMs, "timeout doubled");
+
+  mock("/mock/config?delay_ms=0");
+  sh.requestRefresh();
+  const bool recovered = waitUntil(
+      [&sh] {
+        const ShellyHandler::BreakerStats st = sh.breakerStats();
+        return st.timeoutBackoff == 0 && st.consecutiveFailures == 0;
+      },
+      15000);
+  const ShellyHandler::BreakerStats end = sh.breakerStats();
+  auto after = mock("/mock/stats");
+  printf("  recovered: timeout %lu ms, backoff %u, breaker %s, trips %lu; mock RPCs during the outage +%.0f\n",
+         static_cast<unsigned long>(end.timeoutMs), end.timeoutBackoff, ShellyHandler::breakerStateName(end.state),
+         static_cast<unsigned long>(end.trips), delta(after, before, "rpc"));
+  check(recovered, "timeout back to the RTT estimate once replies are prompt");
+}
+
+void dropRate(ShellyHandler &sh, unsigned rounds, double drop)
+{
+  printf("drop rate %.2f, %u commands\n", drop, rounds);
+  auto before = mock("/mock/config?delay_ms=20&jitter_ms=30&drop=" + std::to_string(drop));
+  const uint32_t requests = sh.requestCount();
+  const ShellyHandler::BreakerStats start = sh.breakerStats();
+  std::map<int, unsigned> tally;
+  unsigned missing = 0;
+  uint32_t maxDoneMs = 0;
+  Outcome *outcomes = new Outcome[rounds];
+  for (unsigned i = 0; i < rounds; ++i)
+  {
+    Outcome &o = outcomes[i];
+    send(sh, (i % 2) == 0, o);
+    if (!wait(o, 15000))
+    {
+      ++missing;
+      continue;
+    }
+    ++tally[o.result];
+    if (o.doneAfterMs > maxDoneMs)
+      maxDoneMs = o.doneAfterMs;
+    delay(50);
+  }
+  auto after = mock("/mock/config?delay_ms=0&jitter_ms=0&drop=0");
+  const ShellyHandler::BreakerStats end = sh.breakerStats();
+  printf("  Ok %u, Failed %u, Suppressed %u, Superseded %u; slowest completion %lu ms\n",
+         tally[static_cast<int>(Result::Ok)], tally[static_cast<int>(Result::Failed)],
+         tally[static_cast<int>(Result::Suppressed)], tally[static_cast<int>(Result::Superseded)],
+         static_cast<unsigned long>(maxDoneMs));
+  printf("  mock RPCs +%.0f, dropped +%.0f; handler requests +%lu; breaker trips +%lu, fast fails +%lu\n",
+         delta(after, before, "rpc"), delta(after, before, "dropped"),
+         static_cast<unsigned long>(sh.requestCount() - requests), static_cast<unsigned long>(end.trips - start.trips),
+         static_cast<unsigned long>(end.fastFails - start.fastFails));
+  check(missing == 0, "every command completed");
+  check(tally[static_cast<int>(Result::Superseded)] == 0, "nothing superseded when commands are spaced out");
+  check(tally[static_cast<int>(Result::Ok)] > 0, "commands get through");
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned rounds = 30;
+  double drop = 0.3;
+  bool verbose = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+      rounds = static_cast<unsigned>(atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--drop") && i + 1 < argc)
+      drop = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--verbose"))
+      verbose = true;
+    else
+    {
+      fprintf(stderr, "usage: shelly_http_check [--rounds N] [--drop P] [--verbose]\n");
+      return 2;
+    }
+  }
+  Serial.quiet = !verbose;
+
+  mock("/mock/config?delay_ms=0&jitter_ms=0&drop=0&drop_next=0&output=false");
+  ShellyHandler sh("127.0.0.1", 0);
+  sh.start();
+  if (!waitUntil([&sh] { return sh.requestCount() > 0 && !sh.switchPending() && sh.breakerStats().srttMs > 0; },
+                 5000))
+  {
+    fprintf(stderr, "handler made no request to the mock\n");
+    return 2;
+  }
+
+  lastWriterWins(sh);
+  singleRetry(sh);
+  noPostRetry(sh);
+  timeoutPath(sh);
+  dropRate(sh, rounds, drop);
+
+  printf("slowest requestSwitch() call: %lu us\n", static_cast<unsigned long>(g_maxCallUs));
+  check(g_maxCallUs < 10000, "requestSwitch() never waited on the network");
+  printf("failures=%zu\n", g_failures);
+  fflush(stdout);
+  // The worker thread never returns; skip static destructors under it
+  _exit(g_failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Minimal host stand-in for <Arduino.h>, just enough for BodyStream and the
+// Switch.GetStatus parser to build on a PC against ArduinoJson's Stream
+// reader. Not a general Arduino emulation.
+
+#include <chrono>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+inline uint32_t millis()
+{
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+inline void vTaskDelay(uint32_t) {}
+
+class Stream
+{
+public:
+  virtual ~Stream() = default;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t write(uint8_t) = 0;
+
+  void setTimeout(unsigned long) {}
+
+  // No timeout on the host: a negative read means the data ended
+  size_t readBytes(char *buffer, size_t length)
+  {
+    size_t n = 0;
+    while (n < length)
+    {
+      const int c = read();
+      if (c < 0)
+        break;
+      buffer[n++] = static_cast<char>(c);
+    }
+    return n;
+  }
+};
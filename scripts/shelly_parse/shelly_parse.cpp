@@ -0,0 +1,209 @@
+// Host check of the Switch.GetStatus parse in
+// src/io/ShellyStatus.cpp, the way ShellyHandler::fetchStatus() runs it.
+//
+// Each payload is served from an in-memory socket followed by the bytes
+// of a next response, read through BodyStream with the streaming filter,
+// and the ShellyStatus fields are compared with the expected values. An
+// unfiltered parse of the same bytes must also stop at the end of the
+// body. Build with scripts/build_shelly_parse.sh.
+//
+//   shelly_parse [--dir DIR] [file.json ...]
+//
+// DIR holds the built-in payloads (scripts/shelly_parse/payloads), which
+// follow the Switch.GetStatus examples of the Shelly Gen2 API docs. Extra
+// files (e.g. saved with curl http://<shelly>/rpc/Switch.GetStatus?id=0)
+// only have to parse and carry an output field. Exit status is 1 on any
+// failed check.
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "io/BodyStream.h"
+#include "io/ShellyStatus.h"
+
+namespace
+{
+// Start of the next response on a kept-alive connection; must still be
+// unread once the body is parsed and drained
+const char NEXT_RESPONSE[] = "HTTP/1.1 200 OK\r\n";
+
+struct Case
+{
+  const char *file;
+  ShellyStatus expected;
+};
+
+ShellyStatus status(bool output, float apower, float voltage, float current, float tempC, float energy)
+{
+  ShellyStatus s;
+  s.output = output;
+  s.apowerW = apower;
+  s.voltageV = voltage;
+  s.currentA = current;
+  s.temperatureC = tempC;
+  s.energyWh = energy;
+  return s;
+}
+
+const Case CASES[] = {
+    {"plus1pm_on.json", status(true, 1012.4f, 229.8f, 4.412f, 52.3f, 48213.117f)},
+    {"plus1pm_off.json", status(false, 0.0f, 231.2f, 0.0f, 47.9f, 48230.004f)},
+    {"plus1_no_metering.json", status(true, NAN, NAN, NAN, 41.2f, NAN)},
+    {"pro4pm_ch2.json", status(false, 0.0f, 233.4f, 0.0f, 38.6f, 125.882f)},
+};
+
+// Socket stand-in: the whole buffer is available at once
+class MemoryStream : public Stream
+{
+public:
+  explicit MemoryStream(const std::string &data) : data_(data) {}
+
+  int available() override { return static_cast<int>(data_.size() - pos_); }
+  int peek() override { return pos_ < data_.size() ? static_cast<unsigned char>(data_[pos_]) : -1; }
+  int read() override { return pos_ < data_.size() ? static_cast<unsigned char>(data_[pos_++]) : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+  std::string rest() const { return data_.substr(pos_); }
+
+private:
+  const std::string &data_;
+  size_t pos_ = 0;
+};
+
+struct Payload
+{
+  std::string name;
+  std::string body;
+  std::string wire; // body + NEXT_RESPONSE
+  const ShellyStatus *expected;
+};
+
+struct Parse
+{
+  DeserializationError error;
+  bool stoppedAtBody = false;
+};
+
+// One parse as fetchStatus() does it; status is only filled when given
+Parse parse(const Payload &p, bool filtered, ShellyStatus *status)
+{
+  Parse r;
+  JsonDocument doc;
+  MemoryStream socket(p.wire);
+  BodyStream body(socket, p.body.size());
+  r.error = filtered ? deserializeJson(doc, body, DeserializationOption::Filter(shellyStatusFilter()))
+                     : deserializeJson(doc, body);
+  body.drain(100);
+  r.stoppedAtBody = body.complete() && socket.rest() == NEXT_RESPONSE;
+  if (!r.error && status && !parseShellyStatus(doc.as<JsonVariantConst>(), *status))
+    r.error = DeserializationError::InvalidInput;
+  return r;
+}
+
+bool readFile(const std::string &path, std::string &out)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  out = ss.str();
+  return true;
+}
+
+bool sameField(float got, float want)
+{
+  if (isnan(want))
+    return isnan(got);
+  return fabsf(got - want) <= 0.001f;
+}
+
+bool sameStatus(const ShellyStatus &got, const ShellyStatus &want)
+{
+  return got.output == want.output && sameField(got.apowerW, want.apowerW) &&
+         sameField(got.voltageV, want.voltageV) && sameField(got.currentA, want.currentA) &&
+         sameField(got.temperatureC, want.temperatureC) && sameField(got.energyWh, want.energyWh);
+}
+
+void printStatus(const char *label, const ShellyStatus &s)
+{
+  printf("  %s output=%d apower=%.3f voltage=%.3f current=%.3f tC=%.3f energy=%.3f\n", label,
+         s.output ? 1 : 0, s.apowerW, s.voltageV, s.currentA, s.temperatureC, s.energyWh);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  std::string dir;
+  std::vector<std::string> extra;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--dir") && i + 1 < argc)
+      dir = argv[++i];
+    else if (argv[i][0] == '-')
+    {
+      fprintf(stderr, "usage: shelly_parse [--dir DIR] [file.json ...]\n");
+      return 2;
+    }
+    else
+      extra.push_back(argv[i]);
+  }
+
+  std::vector<Payload> payloads;
+  if (!dir.empty())
+  {
+    for (const Case &c : CASES)
+    {
+      Payload p{c.file, "", "", &c.expected};
+      if (!readFile(dir + "/" + c.file, p.body))
+        return 2;
+      payloads.push_back(p);
+    }
+  }
+  for (const std::string &path : extra)
+  {
+    Payload p{path, "", "", nullptr};
+    if (!readFile(path, p.body))
+      return 2;
+    payloads.push_back(p);
+  }
+  if (payloads.empty())
+  {
+    fprintf(stderr, "no payloads\n");
+    return 2;
+  }
+
+  size_t failures = 0;
+  for (Payload &p : payloads)
+  {
+    p.wire = p.body + NEXT_RESPONSE;
+
+    ShellyStatus got;
+    const Parse filtered = parse(p, true, &got);
+    const Parse full = parse(p, false, nullptr);
+    bool ok = !filtered.error && !full.error && filtered.stoppedAtBody && full.stoppedAtBody;
+    if (ok && p.expected)
+      ok = sameStatus(got, *p.expected);
+
+    printf("%-4s %s (%zu bytes)\n", ok ? "OK" : "FAIL", p.name.c_str(), p.body.size());
+    if (ok)
+      continue;
+
+    ++failures;
+    printf("  filtered: %s%s, unfiltered: %s%s\n", filtered.error.c_str(),
+           filtered.stoppedAtBody ? "" : " (read past the body)", full.error.c_str(),
+           full.stoppedAtBody ? "" : " (read past the body)");
+    printStatus("got ", got);
+    if (p.expected)
+      printStatus("want", *p.expected);
+  }
+
+  printf("payloads=%zu failures=%zu\n", payloads.size(), failures);
+  return failures == 0 ? 0 : 1;
+}
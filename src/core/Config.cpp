@@ -16,7 +16,12 @@ const Config::FloatFieldDesc Config::FLOAT_FIELDS[] = {
     { "rb_tt",          22.0f,      &Config::readyByTargetTemp_ },
     { "ac_smin",        2.f * 60,   &Config::autoCalibStartMinF_ }, // 02:00
     { "ac_emin",        5.f * 60,   &Config::autoCalibEndMinF_ },   // 05:00
-    { "ac_cap",         20.0f,      &Config::autoCalibTargetCap_ }
+    { "ac_cap",         20.0f,      &Config::autoCalibTargetCap_ },
+    { "flt_mode",       3.0f,       &Config::filterModeF_ },        // Kalman
+    { "flt_gate",       1.5f,       &Config::filterGateC_ },
+    { "agg_mode",       0.0f,       &Config::aggregateModeF_ },     // named sensor
+    { "agg_sensor",     0.0f,       &Config::aggregateSensorF_ },
+    { "heater_w",       1000.0f,    &Config::heaterPowerW_ }
 };
 
 // Define boolean fields
@@ -24,7 +29,8 @@ const Config::BoolFieldDesc Config::BOOL_FIELDS[] = {
     { "dz_enabled",           true,  &Config::deadzoneEnabled_ },
     { "ht_en",                true,  &Config::heaterTaskEnabled_ },
     { "rb_en",                false, &Config::readyByActive_ },
-    { "ac_en",                false, &Config::autoCalibrationEnabled_ }
+    { "ac_en",                false, &Config::autoCalibrationEnabled_ },
+    { "rec_en",               false, &Config::recordingEnabled_ }
 };
 
 // Define uint64 fields
@@ -286,6 +292,67 @@ void Config::setAutoCalibTargetCapC(float v) {
     dirty_ = true;
 }
 
+uint8_t Config::filterMode() const {
+    float v = filterModeF_;
+    if (v < 0.f) v = 0.f;
+    if (v > 3.f) v = 3.f;
+    return static_cast<uint8_t>(v + 0.5f);
+}
+
+void Config::setFilterMode(uint8_t mode) {
+    if (mode > 3) mode = 3;
+    float v = static_cast<float>(mode);
+    if (v == filterModeF_) return;
+    filterModeF_ = v;
+    dirty_ = true;
+}
+
+void Config::setHeaterPowerW(float v) {
+    if (v < 100.0f) v = 100.0f;
+    if (v > 3000.0f) v = 3000.0f;
+    if (v == heaterPowerW_) return;
+    heaterPowerW_ = v;
+    dirty_ = true;
+}
+
+void Config::setFilterGateC(float v) {
+    if (v < 0.0f) v = 0.0f;
+    if (v > 20.0f) v = 20.0f;
+    if (v == filterGateC_) return;
+    filterGateC_ = v;
+    dirty_ = true;
+}
+
+uint8_t Config::aggregateMode() const {
+    float v = aggregateModeF_;
+    if (v < 0.f) v = 0.f;
+    if (v > 2.f) v = 2.f;
+    return static_cast<uint8_t>(v + 0.5f);
+}
+
+uint8_t Config::aggregateSensor() const {
+    float v = aggregateSensorF_;
+    if (v < 0.f) v = 0.f;
+    if (v > 15.f) v = 15.f;
+    return static_cast<uint8_t>(v + 0.5f);
+}
+
+void Config::setAggregateMode(uint8_t mode) {
+    if (mode > 2) mode = 2;
+    float v = static_cast<float>(mode);
+    if (v == aggregateModeF_) return;
+    aggregateModeF_ = v;
+    dirty_ = true;
+}
+
+void Config::setAggregateSensor(uint8_t index) {
+    if (index > 15) index = 15;
+    float v = static_cast<float>(index);
+    if (v == aggregateSensorF_) return;
+    aggregateSensorF_ = v;
+    dirty_ = true;
+}
+
 void Config::setDeadzoneEnabled(bool v) {
     if (v == deadzoneEnabled_) return;
     deadzoneEnabled_ = v;
@@ -310,6 +377,12 @@ void Config::setAutoCalibrationEnabled(bool v) {
     dirty_ = true;
 }
 
+void Config::setRecordingEnabled(bool v) {
+    if (v == recordingEnabled_) return;
+    recordingEnabled_ = v;
+    dirty_ = true;
+}
+
 void Config::setReadyByTargetEpochUtc(uint64_t v) {
     if (v == readyByTargetEpochUtc_) return;
     readyByTargetEpochUtc_ = v;
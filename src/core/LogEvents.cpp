@@ -0,0 +1,223 @@
+#include "core/LogEvents.h"
+
+#include <stdarg.h>
+
+#include "core/TimeKeeper.h"
+
+namespace
+{
+// "{}" takes the next arg in its default form, "{.N}" a float with N
+// decimals. Indexed by LogEvent.
+const char *const FORMATS[] = {
+    "{}",
+    "[{}] {}",
+    "Heater turned ON By HeaterTask | Current: {.1}°C Target: {.1}°C",
+    "Heater turned OFF By HeaterTask | Current: {.1}°C Target: {.1}°C",
+    "Entered deadzone",
+    "Exited deadzone",
+    "{} turned ON By ActuatorTask",
+    "{} turned OFF By ActuatorTask",
+    "{} turned ON By ActuatorTask | {}: {.1}°C",
+    "{} turned OFF By ActuatorTask | {}: {.1}°C",
+    "- WatchDog: Heater task restarted",
+    "- WatchDog: ESP restarted due to heater task failure",
+    "- WatchDog: ESP restarted due to WiFi/Shelly failure",
+    "- WatchDog: WiFi reconnect attempt",
+    "- WatchDog: Shelly reconnect attempt",
+    "- WatchDog: Shelly restarted",
+    "[ReadyByTask] Scheduled: target time={}, targetTemp={.1}°C",
+    "[ReadyByTask] Past target time, exiting. Reached temperature: {.1}/{.1}°C",
+    "[ReadyByTask] Forcing heater ON (ambient={.1}°C, target={.1}°C, warmup={.0}s)",
+    "[ReadyByTask] Target temperature {.1}°C reached {.0} minutes early (ambient={.1}°C)",
+    "[ReadyByTask] Heating slower than predicted ({.2} vs {.2} °C/min); target likely missed by {.0} min",
+    "[LogManager] Warning: {} lines dropped, queue full",
+};
+static_assert(sizeof(FORMATS) / sizeof(FORMATS[0]) == static_cast<size_t>(LogEvent::Count),
+              "one format per LogEvent");
+
+constexpr size_t HEADER_LEN = 6;
+
+void putU32(uint8_t *p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+uint32_t getU32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Bounded appender; keeps out NUL-terminated
+struct Writer
+{
+    char *out;
+    size_t size;
+    size_t pos = 0;
+
+    void write(const char *s, size_t n)
+    {
+        if (pos + 1 >= size)
+            return;
+        if (n > size - 1 - pos)
+            n = size - 1 - pos;
+        memcpy(out + pos, s, n);
+        pos += n;
+        out[pos] = '\0';
+    }
+    void print(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (pos + 1 >= size)
+            return;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(out + pos, size - pos, fmt, ap);
+        va_end(ap);
+        if (n > 0)
+            pos = (pos + n < size) ? pos + n : size - 1;
+    }
+};
+
+// Writes the arg at rec[off] and returns the offset after it (0 if malformed)
+size_t renderArg(const uint8_t *rec, size_t len, size_t off, int decimals, Writer &w)
+{
+    if (off >= len)
+        return 0;
+    const LogArg::Type type = static_cast<LogArg::Type>(rec[off++]);
+    if (type == LogArg::Type::Str)
+    {
+        if (off >= len || off + 1 + rec[off] > len)
+            return 0;
+        w.write(reinterpret_cast<const char *>(rec + off + 1), rec[off]);
+        return off + 1 + rec[off];
+    }
+    if (off + 4 > len)
+        return 0;
+    const uint32_t raw = getU32(rec + off);
+    switch (type)
+    {
+    case LogArg::Type::U32:
+        w.print("%lu", static_cast<unsigned long>(raw));
+        break;
+    case LogArg::Type::I32:
+        w.print("%ld", static_cast<long>(static_cast<int32_t>(raw)));
+        break;
+    case LogArg::Type::F32:
+    {
+        float f;
+        memcpy(&f, &raw, sizeof(f));
+        w.print("%.*f", decimals < 0 ? 2 : decimals, f);
+        break;
+    }
+    case LogArg::Type::Epoch:
+    {
+        const String s = timekeeper::formatEpoch(raw);
+        w.write(s.c_str(), s.length());
+        break;
+    }
+    default:
+        return 0;
+    }
+    return off + 4;
+}
+} // namespace
+
+size_t encodeLogRecord(uint8_t *out, size_t outSize, uint32_t utc, LogEvent event,
+                       std::initializer_list<LogArg> args)
+{
+    if (outSize < HEADER_LEN)
+        return 0;
+    putU32(out, utc);
+    out[4] = static_cast<uint8_t>(event);
+    uint8_t argc = 0;
+    size_t pos = HEADER_LEN;
+    for (const LogArg &a : args)
+    {
+        if (a.type == LogArg::Type::Str)
+        {
+            if (pos + 2 > outSize)
+                break;
+            size_t n = a.len;
+            if (n > 255)
+                n = 255;
+            if (n > outSize - pos - 2)
+                n = outSize - pos - 2;
+            out[pos] = static_cast<uint8_t>(a.type);
+            out[pos + 1] = static_cast<uint8_t>(n);
+            memcpy(out + pos + 2, a.str, n);
+            pos += 2 + n;
+        }
+        else
+        {
+            if (pos + 5 > outSize)
+                break;
+            out[pos] = static_cast<uint8_t>(a.type);
+            putU32(out + pos + 1, a.u);
+            pos += 5;
+        }
+        ++argc;
+    }
+    out[5] = argc;
+    return pos;
+}
+
+uint32_t logRecordUtc(const uint8_t *rec, size_t len)
+{
+    return len >= HEADER_LEN ? getU32(rec) : 0;
+}
+
+size_t renderLogRecord(const uint8_t *rec, size_t len, char *out, size_t outSize)
+{
+    Writer w{out, outSize};
+    if (outSize == 0)
+        return 0;
+    out[0] = '\0';
+    if (len < HEADER_LEN)
+        return 0;
+
+    const uint32_t utc = getU32(rec);
+    if (utc != 0)
+    {
+        const String ts = timekeeper::formatEpoch(utc + static_cast<int32_t>(timekeeper::tzOffsetMinutes()) * 60);
+        w.write(ts.c_str(), ts.length());
+        w.write(" ", 1);
+    }
+
+    const uint8_t event = rec[4];
+    if (event >= static_cast<uint8_t>(LogEvent::Count))
+    {
+        w.print("(unknown event %u)", event);
+        return w.pos;
+    }
+
+    // Walk the format, pulling args in order
+    const char *fmt = FORMATS[event];
+    size_t off = HEADER_LEN;
+    uint8_t argsLeft = rec[5];
+    while (*fmt)
+    {
+        const char *brace = strchr(fmt, '{');
+        if (!brace)
+        {
+            w.write(fmt, strlen(fmt));
+            break;
+        }
+        w.write(fmt, brace - fmt);
+        const char *close = strchr(brace, '}');
+        if (!close)
+            break;
+        int decimals = -1;
+        if (brace[1] == '.')
+            decimals = atoi(brace + 2);
+        if (argsLeft > 0 && off != 0)
+        {
+            off = renderArg(rec, len, off, decimals, w);
+            --argsLeft;
+        }
+        fmt = close + 1;
+    }
+    return w.pos;
+}
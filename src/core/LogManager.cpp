@@ -1,125 +1,520 @@
 // LogManager.cpp
 #include "core/LogManager.h"
+#include <cstddef>
+#include <memory>
+
+#include "core/TimeKeeper.h"
 
 LogManager::LogManager()
-    : head_(0),
-      count_(0)
+    : ready_(false),
+      pages_(),
+      head_(0),
+      storedSeq_(0),
+      unflushed_(0),
+      syncs_(0),
+      dirtySinceMs_(0),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      dropped_(0),
+      droppedReported_(0),
+      requests_(0),
+      handle_(nullptr)
 {
-}
-
-String LogManager::makeKey(uint16_t index) const {
-    char buf[8];
-    // e000 .. e255
-    snprintf(buf, sizeof(buf), "e%03u", static_cast<unsigned>(index));
-    return String(buf);
+    pages_[0].firstSeq = 1;
+    for (uint32_t i = 0; i < QUEUE_SLOTS; ++i) {
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mutex_ = xSemaphoreCreateMutex();
+    requestMutex_ = xSemaphoreCreateMutex();
+    requestDone_ = xSemaphoreCreateBinary();
 }
 
 bool LogManager::begin() {
-    if (!prefs_.begin(NAMESPACE, /*readOnly*/ false)) {
-        Serial.println(F("[LogManager] Failed to open NVS namespace 'logs'"));
+    if (!store_.begin()) {
+        Serial.println(F("[LogManager] Failed to open the log store"));
         return false;
     }
+    storedSeq_ = store_.lastSeq();
+    resetLocked(storedSeq_ + 1);
+    ready_ = true;
 
-    head_  = prefs_.getUShort(KEY_HEAD, 0);
-    count_ = prefs_.getUShort(KEY_COUNT, 0);
-    if (head_ >= MAX_ENTRIES) head_ = 0;
-    if (count_ >  MAX_ENTRIES) count_ = MAX_ENTRIES;
+    // Entries kept in NVS by earlier firmware: move them over once (unless
+    // the store already has history) and free the namespace
+    Preferences prefs;
+    bool migrated = false;
+    if (prefs.begin(NAMESPACE, /*readOnly*/ false)) {
+        bool oldKeys = prefs.isKey(KEY_HEAD);
+        for (uint8_t i = 0; i < OLD_PAGE_COUNT && !oldKeys; ++i) {
+            char key[8];
+            snprintf(key, sizeof(key), "p%u", static_cast<unsigned>(i));
+            oldKeys = prefs.isKey(key);
+            snprintf(key, sizeof(key), "b%u", static_cast<unsigned>(i));
+            oldKeys = oldKeys || prefs.isKey(key);
+        }
+        if (oldKeys && storedSeq_ == 0) {
+            migrateNvs(prefs);
+            migrated = true;
+        } else if (oldKeys) {
+            prefs.clear();
+        }
+        prefs.end();
+    }
+    if (!migrated) {
+        preload();
+    }
 
-    Serial.printf("[LogManager] head=%u, count=%u, capacity=%u\n",
-                  head_, count_, MAX_ENTRIES);
+    uint16_t lines = 0;
+    for (uint8_t i = 0; i < PAGE_COUNT; ++i) {
+        lines += pages_[i].count;
+    }
+    Serial.printf("[LogManager] %u entries in RAM, next seq %lu\n",
+                  lines, static_cast<unsigned long>(storedSeq_ + 1));
     return true;
 }
 
-void LogManager::append(const String& line) {
-    // If begin() failed, prefs_ may not be open – you could guard if needed.
-    uint16_t index = head_;  // slot to write
-    String key = makeKey(index);
+void LogManager::preload() {
+    // Newest stored entries, so the RAM views are not empty after a reboot
+    const uint32_t last = store_.lastSeq();
+    const uint32_t from = last > PRELOAD_ENTRIES ? last - PRELOAD_ENTRIES + 1 : 1;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    store_.read(from, PRELOAD_ENTRIES, [this](uint32_t seq, const uint8_t *rec, size_t len) {
+        appendLocked(rec, len, seq);
+        return true;
+    });
+    if (nextSeqLocked() != storedSeq_ + 1) {
+        resetLocked(storedSeq_ + 1); // store ends past what it returned
+    }
+    xSemaphoreGive(mutex_);
+}
+
+void LogManager::migrateRecord(const uint8_t *rec, size_t len) {
+    // Runs from begin(), before the logger task exists
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    appendLocked(rec, len);
+    unflushed_++;
+    xSemaphoreGive(mutex_);
+    if (unflushed_ >= FLUSH_LINES) {
+        persist(); // before the ring recycles a page
+    }
+}
+
+void LogManager::migrateText(const char *text, size_t len) {
+    // Migrated lines carry their own timestamp text, so utc = 0
+    uint8_t rec[MAX_RECORD_LEN];
+    migrateRecord(rec, encodeLogRecord(rec, sizeof(rec), 0, LogEvent::Text, {LogArg(text, len)}));
+}
+
+void LogManager::migrateNvs(Preferences &prefs) {
+    // Earlier formats, oldest first: one string per line under e000..
+    // with the ring position in head/count, then pages of [len][text][len]
+    // under p0.., then pages of binary records under b0... Entries are
+    // renumbered from 1.
+    uint16_t migrated = 0;
 
-    prefs_.putString(key.c_str(), line);
+    if (prefs.isKey(KEY_HEAD)) {
+        uint16_t head  = prefs.getUShort(KEY_HEAD, 0);
+        uint16_t count = prefs.getUShort(KEY_COUNT, 0);
+        if (head >= OLD_MAX_ENTRIES) head = 0;
+        if (count > OLD_MAX_ENTRIES) count = OLD_MAX_ENTRIES;
 
-    head_ = static_cast<uint16_t>((head_ + 1) % MAX_ENTRIES);
-    if (count_ < MAX_ENTRIES) {
-        count_++;
+        const uint16_t start = (head + OLD_MAX_ENTRIES - count) % OLD_MAX_ENTRIES;
+        for (uint16_t i = 0; i < count; ++i) {
+            char key[8];
+            snprintf(key, sizeof(key), "e%03u", static_cast<unsigned>((start + i) % OLD_MAX_ENTRIES));
+            String line = prefs.getString(key, "");
+            migrateText(line.c_str(), line.length());
+            migrated++;
+        }
     }
 
-    prefs_.putUShort(KEY_HEAD, head_);
-    prefs_.putUShort(KEY_COUNT, count_);
-    // prefs_ stays open; NVS has wear-levelling, but don't go totally crazy
-    if (callback_) {
-        callback_(line);
+    // Page formats: visit each set in firstSeq order. Only the header and
+    // the used part of a page were stored.
+    std::unique_ptr<Page> buf(new Page());
+    const size_t header = offsetof(Page, data);
+    for (const char prefix : {'p', 'b'}) {
+        uint32_t doneSeq = 0;
+        for (;;) {
+            int next = -1;
+            uint32_t nextSeq = 0;
+            for (uint8_t i = 0; i < OLD_PAGE_COUNT; ++i) {
+                char key[8];
+                snprintf(key, sizeof(key), "%c%u", prefix, static_cast<unsigned>(i));
+                const size_t len = prefs.isKey(key) ? prefs.getBytesLength(key) : 0;
+                if (len < header || len > sizeof(Page) || prefs.getBytes(key, buf.get(), header) != header) {
+                    continue;
+                }
+                if (buf->firstSeq > doneSeq && (next < 0 || buf->firstSeq < nextSeq)) {
+                    next = i;
+                    nextSeq = buf->firstSeq;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            doneSeq = nextSeq;
+
+            char key[8];
+            snprintf(key, sizeof(key), "%c%u", prefix, static_cast<unsigned>(next));
+            const size_t len = prefs.getBytesLength(key);
+            if (prefs.getBytes(key, buf.get(), len) != len || buf->used != len - header) {
+                continue;
+            }
+            forEachInPage(*buf, [&](uint32_t, const uint8_t *rec, size_t n) {
+                if (prefix == 'p') {
+                    migrateText(reinterpret_cast<const char *>(rec), n);
+                } else {
+                    migrateRecord(rec, n);
+                }
+                migrated++;
+                return true;
+            });
+        }
     }
-}
 
-void LogManager::dumpToSerial() const {
-    Serial.println(F("[LogManager] Dumping logs (oldest -> newest)"));
+    persist();
+    prefs.clear();
+    Serial.printf("[LogManager] Moved %u entries from NVS to %s\n", migrated, LogStore::DIR);
+}
 
-    if (count_ == 0) {
-        Serial.println(F("[LogManager] (no entries)"));
+void LogManager::start(uint32_t stackSize, UBaseType_t priority) {
+    if (handle_ != nullptr) {
+        Serial.println("[LogManager] Warning: task already running");
         return;
     }
+    xTaskCreate(
+        &LogManager::taskEntry,
+        "Logger",
+        stackSize,
+        this,
+        priority,
+        &handle_);
+}
+
+void LogManager::taskEntry(void *pvParameters) {
+    auto *self = static_cast<LogManager *>(pvParameters);
+    self->run();
+    // never returns
+}
+
+void LogManager::run() {
+    for (;;) {
+        // Sleep until a producer or a request notifies, or the oldest
+        // unsaved entry has waited FLUSH_INTERVAL_MS
+        TickType_t wait = portMAX_DELAY;
+        if (unflushed_ != 0) {
+            const uint32_t age = millis() - dirtySinceMs_;
+            wait = pdMS_TO_TICKS(age >= FLUSH_INTERVAL_MS ? 0 : FLUSH_INTERVAL_MS - age);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        drain();
+
+        const uint8_t reqs = requests_.exchange(0);
+        if (reqs != 0) {
+            handleRequests(reqs);
+            xSemaphoreGive(requestDone_);
+        } else if (unflushed_ != 0 &&
+                   (unflushed_ >= FLUSH_LINES || millis() - dirtySinceMs_ >= FLUSH_INTERVAL_MS)) {
+            persist();
+        }
+    }
+}
+
+void LogManager::handleRequests(uint8_t reqs) {
+    if (reqs & REQ_CLEAR) {
+        // Keep numbering monotonic across a clear
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        const uint32_t nextSeq = nextSeqLocked();
+        resetLocked(nextSeq);
+        unflushed_ = 0;
+        xSemaphoreGive(mutex_);
+        store_.clear(nextSeq);
+        storedSeq_ = nextSeq - 1;
+    }
+    if (reqs & REQ_FLUSH) {
+        persist();
+    }
+}
+
+void LogManager::drain() {
+    uint8_t rec[MAX_RECORD_LEN];
+    for (;;) {
+        Slot &slot = slots_[dequeuePos_ & (QUEUE_SLOTS - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            break; // empty, or the producer is still copying
+        }
+        const size_t len = slot.len;
+        memcpy(rec, slot.rec, len);
+        // Hand the slot back for the producer one lap ahead
+        slot.seq.store(dequeuePos_ + QUEUE_SLOTS, std::memory_order_release);
+        dequeuePos_++;
+
+        store(rec, len);
+    }
+
+    const uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != droppedReported_) {
+        const uint32_t lost = dropped - droppedReported_;
+        droppedReported_ = dropped;
+        Serial.printf("⚠️ [LogManager] %lu lines dropped, queue full\n", static_cast<unsigned long>(lost));
+        const size_t len = encodeLogRecord(rec, sizeof(rec), static_cast<uint32_t>(timekeeper::nowUtc()),
+                                           LogEvent::LogDropped, {lost});
+        store(rec, len);
+    }
+}
+
+void LogManager::store(const uint8_t *rec, size_t len) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (unflushed_ == 0) {
+        dirtySinceMs_ = millis();
+    }
+    const uint32_t seq = appendLocked(rec, len);
+    unflushed_++;
+    xSemaphoreGive(mutex_);
 
-    // Oldest entry is at: (head_ - count_ + MAX_ENTRIES) % MAX_ENTRIES
-    uint16_t start = (head_ + MAX_ENTRIES - count_) % MAX_ENTRIES;
+    if (callback_) {
+        // Formatting happens here, on the logger task, not in the producer
+        char text[MAX_TEXT_LEN];
+        const size_t n = renderLogRecord(rec, len, text, sizeof(text));
+        String line;
+        line.concat(text, n);
+        callback_(seq, line);
+    }
+}
 
-    for (uint16_t i = 0; i < count_; ++i) {
-        uint16_t idx = static_cast<uint16_t>((start + i) % MAX_ENTRIES);
-        String key = makeKey(idx);
-        String line = prefs_.getString(key.c_str(), "");
+uint32_t LogManager::nextSeqLocked() const {
+    return pages_[head_].firstSeq + pages_[head_].count;
+}
 
-        Serial.printf("[%3u] %s\n", static_cast<unsigned>(idx), line.c_str());
+void LogManager::resetLocked(uint32_t nextSeq) {
+    for (uint8_t i = 0; i < PAGE_COUNT; ++i) {
+        pages_[i].firstSeq = 0;
+        pages_[i].used = 0;
+        pages_[i].count = 0;
     }
+    head_ = 0;
+    pages_[0].firstSeq = nextSeq;
 }
 
-String LogManager::toStringNewestFirst(uint16_t maxLines) const {
-    if (count_ == 0) {
-        // empty string → caller can replace with "No log entries" text
-        return String();
+uint32_t LogManager::appendLocked(const uint8_t *record, size_t len, uint32_t seq) {
+    if (len > MAX_RECORD_LEN) {
+        len = MAX_RECORD_LEN;
     }
+    const size_t need = len + 2;
 
-    // How many lines we will actually return
-    uint16_t lines = count_;
-    if (maxLines != 0 && maxLines < lines) {
-        lines = maxLines;
+    Page *p = &pages_[head_];
+    const uint32_t nextSeq = nextSeqLocked();
+    if (seq == 0) {
+        seq = nextSeq;
     }
+    if (p->count != 0 && (seq != nextSeq || p->used + need > sizeof(p->data))) {
+        // Head page full, or the numbering jumps: recycle the oldest one
+        head_ = static_cast<uint8_t>((head_ + 1) % PAGE_COUNT);
+        p = &pages_[head_];
+        p->used = 0;
+        p->count = 0;
+    }
+    if (p->count == 0) {
+        p->firstSeq = seq;
+    }
+
+    uint8_t *rec = p->data + p->used;
+    rec[0] = static_cast<uint8_t>(len);
+    memcpy(rec + 1, record, len);
+    rec[len + 1] = static_cast<uint8_t>(len);
+    p->used = static_cast<uint16_t>(p->used + need);
+    p->count++;
+    return seq;
+}
 
-    // Rough reserve to avoid many reallocations (tune if you like)
-    String out;
-    out.reserve(lines * 64);
+void LogManager::event(LogEvent id, std::initializer_list<LogArg> args) {
+    // Claim a position with CAS; a full queue drops the entry rather than
+    // making the producer wait
+    uint32_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots_[pos & (QUEUE_SLOTS - 1)];
+        const int32_t diff = static_cast<int32_t>(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
 
-    // head_ points to the *next* write position.
-    // Newest entry is at (head_ - 1 + MAX_ENTRIES) % MAX_ENTRIES.
-    int32_t idx = static_cast<int32_t>(head_) - 1;
-    if (idx < 0) idx += MAX_ENTRIES;
+    // Encode straight into the slot; no text is formatted here
+    const size_t len = encodeLogRecord(slot->rec, sizeof(slot->rec),
+                                       static_cast<uint32_t>(timekeeper::nowUtc()), id, args);
+    slot->len = static_cast<uint8_t>(len);
+    slot->seq.store(pos + 1, std::memory_order_release);
 
-    for (uint16_t i = 0; i < lines; ++i) {
-        String key = makeKey(static_cast<uint16_t>(idx));
-        String line = prefs_.getString(key.c_str(), "");
+    if (handle_ != nullptr) {
+        xTaskNotifyGive(handle_);
+    }
+}
 
-        out += line;
-        if (i + 1 < lines) {
-            out += '\n';
+void LogManager::request(Request req) {
+    if (!ready_) {
+        return;
+    }
+    xSemaphoreTake(requestMutex_, portMAX_DELAY);
+    if (handle_ != nullptr) {
+        // Let the logger task drain the queue first; it is the only consumer
+        xSemaphoreTake(requestDone_, 0);
+        requests_.fetch_or(req);
+        xTaskNotifyGive(handle_);
+        if (xSemaphoreTake(requestDone_, pdMS_TO_TICKS(REQUEST_WAIT_MS)) != pdTRUE) {
+            Serial.println("⚠️ [LogManager] Request timed out");
         }
+    } else {
+        handleRequests(req);
+    }
+    xSemaphoreGive(requestMutex_);
+}
 
-        // Move backwards through the ring buffer
-        idx -= 1;
-        if (idx < 0) idx += MAX_ENTRIES;
+void LogManager::flush() {
+    request(REQ_FLUSH);
+}
+
+void LogManager::persist() {
+    // Logger task only (or begin()), the sole writer of the pages, so they
+    // are read here without holding up readers for the flash writes
+    const uint32_t from = storedSeq_ + 1;
+    uint16_t left = 0;
+    bool failed = false;
+    for (uint8_t n = 1; n <= PAGE_COUNT; ++n) {
+        const Page &p = pages_[(head_ + n) % PAGE_COUNT];
+        if (p.count == 0 || p.firstSeq + p.count <= from) {
+            continue;
+        }
+        forEachInPage(p, [&](uint32_t seq, const uint8_t *rec, size_t len) {
+            if (seq < from) {
+                return true;
+            }
+            if (!failed && store_.append(seq, logRecordUtc(rec, len), rec, len)) {
+                storedSeq_ = seq;
+            } else {
+                failed = true;
+                left++;
+            }
+            return true;
+        });
     }
+    store_.sync();
+    syncs_++;
 
-    return out;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    unflushed_ = left;
+    if (failed) {
+        // Retry after another FLUSH_INTERVAL_MS
+        Serial.printf("⚠️ [LogManager] Failed to store %u entries\n", left);
+        dirtySinceMs_ = millis();
+    }
+    xSemaphoreGive(mutex_);
 }
 
-void LogManager::clear() {
-    // Remove all potential entry keys
-    for (uint16_t i = 0; i < MAX_ENTRIES; ++i) {
-        String key = makeKey(i);
-        prefs_.remove(key.c_str());
+template <typename Fn>
+bool LogManager::forEachInPage(const Page &p, Fn fn) {
+    uint16_t off = 0;
+    for (uint16_t r = 0; r < p.count && off < p.used; ++r) {
+        const uint8_t len = p.data[off];
+        if (!fn(p.firstSeq + r, p.data + off + 1, len)) {
+            return false;
+        }
+        off = static_cast<uint16_t>(off + len + 2);
     }
+    return true;
+}
+
+void LogManager::dumpToSerial() const {
+    Serial.println(F("[LogManager] Dumping logs (oldest -> newest)"));
 
-    head_  = 0;
-    count_ = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint16_t n = 0;
+    char text[MAX_TEXT_LEN];
+    // The page after head_ is the oldest
+    for (uint8_t i = 1; i <= PAGE_COUNT; ++i) {
+        forEachInPage(pages_[(head_ + i) % PAGE_COUNT], [&](uint32_t seq, const uint8_t *rec, size_t len) {
+            renderLogRecord(rec, len, text, sizeof(text));
+            Serial.printf("[%5lu] %s\n", static_cast<unsigned long>(seq), text);
+            n++;
+            return true;
+        });
+    }
+    xSemaphoreGive(mutex_);
 
-    prefs_.putUShort(KEY_HEAD, 0);
-    prefs_.putUShort(KEY_COUNT, 0);
+    if (n == 0) {
+        Serial.println(F("[LogManager] (no entries)"));
+    }
+}
 
+uint32_t LogManager::firstSeq() const {
+    uint32_t seq = store_.firstSeq();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    // RAM may reach further back when the store was cleared or missed writes
+    for (uint8_t i = 1; i <= PAGE_COUNT; ++i) {
+        const Page &p = pages_[(head_ + i) % PAGE_COUNT];
+        if (p.count != 0) {
+            if (seq == 0 || p.firstSeq < seq) {
+                seq = p.firstSeq;
+            }
+            break;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return seq;
+}
+
+uint32_t LogManager::lastSeq() const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const uint32_t seq = nextSeqLocked() - 1;
+    xSemaphoreGive(mutex_);
+    return seq;
+}
+
+size_t LogManager::read(LogStore::Cursor &cursor, size_t maxCount, const LogStore::RecordFn &fn) const {
+    size_t visited = 0;
+    bool stopped = false;
+    // Entries up to storedSeq_ are on flash; skip the store once past them
+    // so a reader catching up does not rescan the tail segment
+    if (cursor.seq <= storedSeq_) {
+        visited = store_.read(cursor, maxCount, [&](uint32_t seq, const uint8_t *rec, size_t len) {
+            stopped = !fn(seq, rec, len);
+            return !stopped;
+        });
+    }
+    if (stopped || visited >= maxCount) {
+        return visited;
+    }
+
+    // The rest from RAM, oldest page (the one after head_) first
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (uint8_t i = 1; i <= PAGE_COUNT && !stopped && visited < maxCount; ++i) {
+        const Page &p = pages_[(head_ + i) % PAGE_COUNT];
+        if (p.count == 0 || p.firstSeq + p.count <= cursor.seq) {
+            continue;
+        }
+        forEachInPage(p, [&](uint32_t seq, const uint8_t *rec, size_t len) {
+            if (seq < cursor.seq) {
+                return true;
+            }
+            ++visited;
+            cursor.seq = seq + 1;
+            cursor.segId = UINT32_MAX; // the file offset no longer matches seq
+            stopped = !fn(seq, rec, len);
+            return !stopped && visited < maxCount;
+        });
+    }
+    xSemaphoreGive(mutex_);
+    return visited;
+}
+
+void LogManager::clear() {
+    request(REQ_CLEAR);
     Serial.println(F("[LogManager] Logs cleared"));
 }
@@ -0,0 +1,411 @@
+// LogStore.cpp
+#include "core/LogStore.h"
+
+#include <LittleFS.h>
+
+#include "core/LogEvents.h"
+
+namespace {
+// Sequential reads through a small buffer; the records are tiny and one
+// LittleFS read per byte would dominate a segment scan
+class ChunkReader {
+public:
+    explicit ChunkReader(File &f) : f_(f) {}
+
+    bool read(uint8_t *dst, size_t n) {
+        while (n > 0) {
+            if (pos_ == end_) {
+                end_ = f_.read(buf_, sizeof(buf_));
+                pos_ = 0;
+                if (end_ == 0) {
+                    return false;
+                }
+            }
+            size_t take = end_ - pos_;
+            if (take > n) take = n;
+            memcpy(dst, buf_ + pos_, take);
+            pos_ += take;
+            dst += take;
+            n -= take;
+        }
+        return true;
+    }
+
+private:
+    File &f_;
+    uint8_t buf_[512];
+    size_t pos_ = 0;
+    size_t end_ = 0;
+};
+} // namespace
+
+LogStore::LogStore()
+    : segs_(),
+      count_(0),
+      nextId_(0),
+      maxUtc_(0),
+      ready_(false)
+{
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+void LogStore::segmentPath(uint32_t id, char *buf, size_t size) {
+    snprintf(buf, size, "%s/%08lx.seg", DIR, static_cast<unsigned long>(id));
+}
+
+bool LogStore::begin() {
+    if (!LittleFS.exists(DIR) && !LittleFS.mkdir(DIR)) {
+        Serial.println(F("⚠️ [LogStore] Cannot create /logs"));
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    count_ = 0;
+    File dir = LittleFS.open(DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        char *end = nullptr;
+        const uint32_t id = strtoul(f.name(), &end, 16);
+        SegmentHeader h;
+        const bool ok = end && strcmp(end, ".seg") == 0 &&
+                        f.read(reinterpret_cast<uint8_t *>(&h), sizeof(h)) == sizeof(h) &&
+                        h.magic == MAGIC;
+        const uint32_t bytes = f.size();
+        f.close();
+        if (!ok) {
+            continue;
+        }
+
+        // Keep the index sorted by id; past MAX_SEGMENTS the oldest goes
+        if (count_ == MAX_SEGMENTS) {
+            if (id < segs_[0].id) {
+                char path[32];
+                segmentPath(id, path, sizeof(path));
+                LittleFS.remove(path);
+                continue;
+            }
+            dropOldestLocked();
+        }
+        uint8_t i = count_++;
+        while (i > 0 && segs_[i - 1].id > id) {
+            segs_[i] = segs_[i - 1];
+            --i;
+        }
+        segs_[i] = Segment{id, h.firstSeq, h.firstUtc, bytes, 0};
+    }
+    dir.close();
+    nextId_ = count_ ? segs_[count_ - 1].id + 1 : 0;
+
+    // Only the tail is scanned: it sets lastSeq; the others are bounded
+    // by their successor
+    for (uint8_t i = 0; i + 1 < count_; ++i) {
+        segs_[i].count = segs_[i + 1].firstSeq - segs_[i].firstSeq;
+    }
+    if (count_ > 0) {
+        Segment &tail = segs_[count_ - 1];
+        maxUtc_ = tail.firstUtc;
+        const uint32_t validBytes = scanLocked(tail);
+        if (validBytes != tail.bytes) {
+            // Torn write at power loss: leave it, continue in a new segment
+            Serial.printf("⚠️ [LogStore] Segment %08lx ends in a partial record\n",
+                          static_cast<unsigned long>(tail.id));
+            tail.bytes = SEGMENT_BYTES;
+        }
+    }
+    ready_ = true;
+    xSemaphoreGive(mutex_);
+
+    Stats s = stats();
+    Serial.printf("[LogStore] %u segments, %lu bytes, seq %lu..%lu\n",
+                  s.segments, static_cast<unsigned long>(s.bytes),
+                  static_cast<unsigned long>(s.firstSeq), static_cast<unsigned long>(s.lastSeq));
+    return true;
+}
+
+// Counts the segment's valid records; returns the byte offset after the
+// last one. Called with mutex_ held.
+uint32_t LogStore::scanLocked(Segment &seg) {
+    char path[32];
+    segmentPath(seg.id, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (!f || !f.seek(sizeof(SegmentHeader))) {
+        return 0;
+    }
+    ChunkReader in(f);
+    uint32_t off = sizeof(SegmentHeader);
+    uint32_t n = 0;
+    uint8_t rec[256];
+    uint8_t len;
+    while (in.read(&len, 1) && in.read(rec, len + 1u) && rec[len] == len) {
+        const uint32_t utc = logRecordUtc(rec, len);
+        if (utc > maxUtc_) {
+            maxUtc_ = utc;
+        }
+        off += len + 2u;
+        ++n;
+    }
+    f.close();
+    seg.count = n;
+    return off;
+}
+
+// Called with mutex_ held
+bool LogStore::startSegmentLocked(uint32_t firstSeq) {
+    if (count_ == MAX_SEGMENTS) {
+        dropOldestLocked();
+    }
+    const uint32_t id = nextId_++;
+    char path[32];
+    segmentPath(id, path, sizeof(path));
+    File f = LittleFS.open(path, "w");
+    SegmentHeader h{MAGIC, firstSeq, maxUtc_};
+    const bool ok = f && f.write(reinterpret_cast<const uint8_t *>(&h), sizeof(h)) == sizeof(h);
+    f.close();
+    if (!ok) {
+        Serial.printf("⚠️ [LogStore] Cannot create %s\n", path);
+        return false;
+    }
+    segs_[count_++] = Segment{id, firstSeq, maxUtc_, sizeof(h), 0};
+    return true;
+}
+
+// Called with mutex_ held
+void LogStore::dropOldestLocked() {
+    if (count_ == 0) {
+        return;
+    }
+    char path[32];
+    segmentPath(segs_[0].id, path, sizeof(path));
+    LittleFS.remove(path);
+    for (uint8_t i = 1; i < count_; ++i) {
+        segs_[i - 1] = segs_[i];
+    }
+    --count_;
+}
+
+bool LogStore::append(uint32_t seq, uint32_t utc, const uint8_t *rec, size_t len) {
+    if (!ready_ || len > 255) {
+        return false;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool ok = true;
+    Segment *tail = count_ ? &segs_[count_ - 1] : nullptr;
+    if (!tail || seq != tail->firstSeq + tail->count ||
+        tail->bytes + len + 2 > SEGMENT_BYTES) {
+        if (tail_) {
+            tail_.close();
+        }
+        // An empty tail (left by clear()) is replaced, not kept
+        if (tail && tail->count == 0) {
+            char path[32];
+            segmentPath(tail->id, path, sizeof(path));
+            LittleFS.remove(path);
+            --count_;
+        }
+        ok = startSegmentLocked(seq);
+        tail = ok ? &segs_[count_ - 1] : nullptr;
+    }
+    if (ok && !tail_) {
+        char path[32];
+        segmentPath(tail->id, path, sizeof(path));
+        tail_ = LittleFS.open(path, "a");
+        ok = static_cast<bool>(tail_);
+    }
+    if (ok) {
+        const uint8_t n = static_cast<uint8_t>(len);
+        ok = tail_.write(&n, 1) == 1 &&
+             tail_.write(rec, len) == len &&
+             tail_.write(&n, 1) == 1;
+    }
+    if (ok) {
+        tail->bytes += len + 2;
+        tail->count++;
+        if (utc > maxUtc_) {
+            maxUtc_ = utc;
+        }
+    } else if (tail) {
+        // Don't append after a possibly partial record
+        if (tail_) {
+            tail_.close();
+        }
+        tail->bytes = SEGMENT_BYTES;
+    }
+    xSemaphoreGive(mutex_);
+    return ok;
+}
+
+void LogStore::sync() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (tail_) {
+        tail_.close(); // commits the appended data
+    }
+    xSemaphoreGive(mutex_);
+}
+
+void LogStore::clear(uint32_t nextSeq) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (tail_) {
+        tail_.close();
+    }
+    while (count_ > 0) {
+        dropOldestLocked();
+    }
+    startSegmentLocked(nextSeq);
+    xSemaphoreGive(mutex_);
+}
+
+uint32_t LogStore::firstSeq() const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint32_t seq = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        if (segs_[i].count > 0) {
+            seq = segs_[i].firstSeq;
+            break;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return seq;
+}
+
+uint32_t LogStore::lastSeq() const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    // After clear() the empty tail still carries the numbering on
+    const uint32_t seq = count_ ? segs_[count_ - 1].firstSeq + segs_[count_ - 1].count - 1 : 0;
+    xSemaphoreGive(mutex_);
+    return seq;
+}
+
+// Index of the last segment with firstSeq <= seq, -1 if seq precedes all.
+// Called with mutex_ held.
+int LogStore::findSegmentLocked(uint32_t seq) const {
+    int lo = 0;
+    int hi = static_cast<int>(count_) - 1;
+    int found = -1;
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        if (segs_[mid].firstSeq <= seq) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+uint32_t LogStore::seekSeq(uint32_t seq) const {
+    uint32_t found = 0;
+    read(seq, 1, [&found](uint32_t s, const uint8_t *, size_t) {
+        found = s;
+        return false;
+    });
+    return found;
+}
+
+uint32_t LogStore::seekTime(uint32_t utc) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    // firstUtc never decreases along the index; start in the last segment
+    // that began at or before utc
+    int lo = 0;
+    int hi = static_cast<int>(count_) - 1;
+    int start = 0;
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        if (segs_[mid].firstUtc <= utc) {
+            start = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    uint32_t found = 0;
+    bool stopped = false;
+    RecordFn match = [&](uint32_t seq, const uint8_t *rec, size_t len) {
+        if (logRecordUtc(rec, len) < utc) {
+            return true;
+        }
+        found = seq;
+        return false;
+    };
+    Cursor cursor;
+    for (int i = start; i < count_ && !stopped; ++i) {
+        readSegmentLocked(segs_[i], cursor, SIZE_MAX, match, stopped);
+    }
+    xSemaphoreGive(mutex_);
+    return found;
+}
+
+// Called with mutex_ held
+size_t LogStore::readSegmentLocked(const Segment &seg, Cursor &cursor, size_t maxCount,
+                                   const RecordFn &fn, bool &stopped) const {
+    // Resume where the cursor left this segment, else scan from its start
+    const bool resume = cursor.segId == seg.id && cursor.offset >= sizeof(SegmentHeader) &&
+                        cursor.offset <= seg.bytes;
+    uint32_t off = resume ? cursor.offset : sizeof(SegmentHeader);
+    uint32_t seq = resume ? cursor.seq : seg.firstSeq;
+
+    char path[32];
+    segmentPath(seg.id, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (!f || !f.seek(off)) {
+        return 0;
+    }
+    ChunkReader in(f);
+    size_t visited = 0;
+    uint8_t rec[256];
+    uint8_t len;
+    while (visited < maxCount && in.read(&len, 1) && in.read(rec, len + 1u) && rec[len] == len) {
+        off += len + 2u;
+        if (seq >= cursor.seq) {
+            ++visited;
+            cursor.seq = seq + 1;
+            cursor.segId = seg.id;
+            cursor.offset = off;
+            if (!fn(seq, rec, len)) {
+                stopped = true;
+                break;
+            }
+        }
+        ++seq;
+    }
+    f.close();
+    return visited;
+}
+
+size_t LogStore::read(uint32_t fromSeq, size_t maxCount, const RecordFn &fn) const {
+    Cursor cursor;
+    cursor.seq = fromSeq;
+    return read(cursor, maxCount, fn);
+}
+
+size_t LogStore::read(Cursor &cursor, size_t maxCount, const RecordFn &fn) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (tail_) {
+        // Make appended-but-unsynced records visible to the reader
+        tail_.close();
+    }
+    int i = findSegmentLocked(cursor.seq);
+    if (i < 0) {
+        i = 0;
+    }
+    size_t visited = 0;
+    bool stopped = false;
+    for (; i < count_ && visited < maxCount && !stopped; ++i) {
+        visited += readSegmentLocked(segs_[i], cursor, maxCount - visited, fn, stopped);
+    }
+    xSemaphoreGive(mutex_);
+    return visited;
+}
+
+LogStore::Stats LogStore::stats() const {
+    Stats s{};
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    s.segments = count_;
+    for (uint8_t i = 0; i < count_; ++i) {
+        s.bytes += segs_[i].bytes;
+    }
+    xSemaphoreGive(mutex_);
+    s.firstSeq = firstSeq();
+    s.lastSeq = lastSeq();
+    return s;
+}
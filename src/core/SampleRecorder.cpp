@@ -0,0 +1,289 @@
+#include "core/SampleRecorder.h"
+
+#include <LittleFS.h>
+
+#include "core/TimeKeeper.h"
+
+namespace
+{
+int16_t clampCenti(int32_t v)
+{
+  if (v < INT16_MIN)
+    return INT16_MIN;
+  if (v > INT16_MAX)
+    return INT16_MAX;
+  return static_cast<int16_t>(v);
+}
+} // namespace
+
+SampleRecorder::SampleRecorder()
+{
+}
+
+void SampleRecorder::start(uint32_t stackSize, UBaseType_t priority)
+{
+  if (task_ != nullptr)
+  {
+    Serial.println("[Recorder] Warning: task already running");
+    return;
+  }
+  fileMutex_ = xSemaphoreCreateMutex();
+  requestMutex_ = xSemaphoreCreateMutex();
+  flushDone_ = xSemaphoreCreateBinary();
+  if (LittleFS.exists(PATH))
+  {
+    File f = LittleFS.open(PATH, "r");
+    fileBytes_ = f ? f.size() : 0;
+    f.close();
+  }
+  xTaskCreate(&SampleRecorder::taskEntry, "Recorder", stackSize, this, priority, &task_);
+  Serial.println("[Recorder] Task started");
+}
+
+void SampleRecorder::setEnabled(bool enabled)
+{
+  if (enabled == enabled_)
+    return;
+  if (!enabled)
+    flush();
+  enabled_ = enabled;
+  Serial.printf("[Recorder] Recording %s\n", enabled ? "enabled" : "disabled");
+}
+
+void SampleRecorder::addSample(const Measurements &m)
+{
+  if (!enabled_)
+    return;
+
+  portENTER_CRITICAL(&mux_);
+  // Per-sensor records only add information with more than one sensor
+  if (m.sensorCount > 1)
+  {
+    for (uint8_t i = 0; i < m.sensorCount; ++i)
+    {
+      const SensorReading &r = m.sensors[i];
+      // Only sensors collected this cycle; the others repeat an old value
+      if (r.valid && r.fresh)
+        appendLocked(recording::RecordType::Sample, i, r.rawCentiC, r.centiC, m.timestampMs);
+    }
+  }
+  appendLocked(recording::RecordType::Sample, recording::SENSOR_AGGREGATE,
+               m.rawCentiC, m.temperatureCentiC, m.timestampMs);
+  portEXIT_CRITICAL(&mux_);
+}
+
+void SampleRecorder::addRelay(bool on, uint32_t timestampMs)
+{
+  if (!enabled_)
+    return;
+
+  portENTER_CRITICAL(&mux_);
+  appendLocked(on ? recording::RecordType::RelayOn : recording::RecordType::RelayOff,
+               0, 0, 0, timestampMs);
+  portEXIT_CRITICAL(&mux_);
+}
+
+void SampleRecorder::appendLocked(recording::RecordType type, uint8_t sensor,
+                                  int32_t rawCentiC, int32_t centiC, uint32_t timestampMs)
+{
+  recording::BlockHeader &h = active_.header;
+
+  // Delta must fit the record; otherwise start a fresh block
+  if (h.count > 0 && (timestampMs - lastMs_) > UINT16_MAX)
+    sealLocked();
+
+  if (h.count == 0)
+  {
+    h.magic = recording::BLOCK_MAGIC;
+    h.firstMs = timestampMs;
+    lastMs_ = timestampMs;
+  }
+
+  recording::Record &r = active_.records[h.count++];
+  r.dtMs = static_cast<uint16_t>(timestampMs - lastMs_);
+  r.type = static_cast<uint8_t>(type);
+  r.sensor = sensor;
+  r.rawCentiC = clampCenti(rawCentiC);
+  r.centiC = clampCenti(centiC);
+  lastMs_ = timestampMs;
+
+  if (h.count == recording::RECORDS_PER_BLOCK)
+    sealLocked();
+}
+
+// Moves the active block to the writer. Called with mux_ held.
+void SampleRecorder::sealLocked()
+{
+  if (active_.header.count == 0)
+    return;
+  if (sealedFull_)
+  {
+    // Writer has not caught up; losing one block beats blocking the sampler
+    ++blocksDropped_;
+  }
+  else
+  {
+    sealed_ = active_;
+    sealedFull_ = true;
+    if (task_ != nullptr)
+      xTaskNotifyGive(task_);
+  }
+  active_.header.count = 0;
+}
+
+void SampleRecorder::flush()
+{
+  if (fileMutex_ == nullptr)
+    return;
+
+  xSemaphoreTake(requestMutex_, portMAX_DELAY);
+  // Drop a done signal left by a request that timed out
+  xSemaphoreTake(flushDone_, 0);
+  flushRequested_ = true;
+  xTaskNotifyGive(task_);
+  if (xSemaphoreTake(flushDone_, pdMS_TO_TICKS(FLUSH_WAIT_MS)) != pdTRUE)
+    Serial.println("⚠️ [Recorder] Flush timed out");
+  xSemaphoreGive(requestMutex_);
+}
+
+// Sealed block, then the partial one. Writer task only; block is its
+// scratch copy, so the task stack holds a single Block.
+void SampleRecorder::writePending(Block &block)
+{
+  bool have = false;
+  xSemaphoreTake(fileMutex_, portMAX_DELAY);
+
+  // Sealed block first so the file stays in time order
+  portENTER_CRITICAL(&mux_);
+  if (sealedFull_)
+  {
+    block = sealed_;
+    sealedFull_ = false;
+    have = true;
+  }
+  portEXIT_CRITICAL(&mux_);
+  if (have)
+    writeBlock(block);
+
+  portENTER_CRITICAL(&mux_);
+  have = active_.header.count > 0;
+  if (have)
+  {
+    block = active_;
+    active_.header.count = 0;
+  }
+  portEXIT_CRITICAL(&mux_);
+  if (have)
+    writeBlock(block);
+
+  xSemaphoreGive(fileMutex_);
+}
+
+void SampleRecorder::taskEntry(void *pvParameters)
+{
+  static_cast<SampleRecorder *>(pvParameters)->run();
+}
+
+void SampleRecorder::run()
+{
+  Block block;
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (flushRequested_.exchange(false))
+    {
+      writePending(block);
+      xSemaphoreGive(flushDone_);
+      continue;
+    }
+
+    xSemaphoreTake(fileMutex_, portMAX_DELAY);
+    bool have = false;
+    portENTER_CRITICAL(&mux_);
+    if (sealedFull_)
+    {
+      block = sealed_;
+      sealedFull_ = false;
+      have = true;
+    }
+    portEXIT_CRITICAL(&mux_);
+    if (have)
+      writeBlock(block);
+    xSemaphoreGive(fileMutex_);
+  }
+}
+
+// Rotates at the size cap and writes a file header when starting a new
+// file. Called with fileMutex_ held.
+bool SampleRecorder::ensureFile(size_t nextBytes)
+{
+  if (fileBytes_ > 0 && fileBytes_ + nextBytes > MAX_FILE_BYTES)
+  {
+    LittleFS.remove(OLD_PATH);
+    LittleFS.rename(PATH, OLD_PATH);
+    fileBytes_ = 0;
+  }
+  if (fileBytes_ > 0)
+    return true;
+
+  File f = LittleFS.open(PATH, "w");
+  if (!f)
+    return false;
+  recording::FileHeader fh{};
+  fh.magic = recording::FILE_MAGIC;
+  fh.version = recording::FILE_VERSION;
+  fh.recordSize = sizeof(recording::Record);
+  fh.recordsPerBlock = recording::RECORDS_PER_BLOCK;
+  fh.startEpochUtc = timekeeper::isValid() ? timekeeper::nowUtc() : 0;
+  fh.startMs = millis();
+  size_t n = f.write(reinterpret_cast<const uint8_t *>(&fh), sizeof(fh));
+  f.close();
+  if (n != sizeof(fh))
+    return false;
+  fileBytes_ = sizeof(fh);
+  return true;
+}
+
+// Called with fileMutex_ held.
+bool SampleRecorder::writeBlock(Block &block)
+{
+  const size_t bytes = sizeof(recording::BlockHeader) +
+                       sizeof(recording::Record) * block.header.count;
+  block.header.crc32 = recording::blockCrc(block.header, block.records);
+
+  bool ok = ensureFile(bytes);
+  if (ok)
+  {
+    File f = LittleFS.open(PATH, "a");
+    ok = f && f.write(reinterpret_cast<const uint8_t *>(&block), bytes) == bytes;
+    f.close();
+  }
+  portENTER_CRITICAL(&mux_);
+  if (ok)
+  {
+    fileBytes_ += bytes;
+    ++blocksWritten_;
+  }
+  else
+  {
+    ++blocksDropped_;
+  }
+  portEXIT_CRITICAL(&mux_);
+  if (!ok)
+    Serial.println("[Recorder] Failed to write block");
+  return ok;
+}
+
+SampleRecorder::Stats SampleRecorder::stats() const
+{
+  Stats s{};
+  s.enabled = enabled_;
+  portENTER_CRITICAL(&mux_);
+  s.fileBytes = fileBytes_;
+  s.blocksWritten = blocksWritten_;
+  s.blocksDropped = blocksDropped_;
+  s.pending = active_.header.count;
+  portEXIT_CRITICAL(&mux_);
+  return s;
+}
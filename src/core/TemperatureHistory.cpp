@@ -0,0 +1,161 @@
+#include "core/TemperatureHistory.h"
+
+namespace
+{
+int16_t clampCenti(int32_t v)
+{
+  if (v < INT16_MIN)
+    return INT16_MIN;
+  if (v > INT16_MAX)
+    return INT16_MAX;
+  return static_cast<int16_t>(v);
+}
+} // namespace
+
+TemperatureHistory::TemperatureHistory()
+{
+}
+
+void TemperatureHistory::Accumulator::add(int32_t sumCentiC, uint32_t n, int16_t lo, int16_t hi, uint32_t on)
+{
+  sum += sumCentiC;
+  count += n;
+  onCount += on;
+  if (lo < min)
+    min = lo;
+  if (hi > max)
+    max = hi;
+}
+
+TemperatureHistory::Bucket TemperatureHistory::Accumulator::close() const
+{
+  Bucket b{};
+  if (count == 0)
+    return b;
+  b.meanCentiC = clampCenti(sum / static_cast<int32_t>(count));
+  b.minCentiC = min;
+  b.maxCentiC = max;
+  b.heaterOnPct = static_cast<uint8_t>((onCount * 100U) / count);
+  return b;
+}
+
+void TemperatureHistory::append(int32_t centiC, bool heaterOn, uint32_t timestampMs)
+{
+  const int16_t c = clampCenti(centiC);
+
+  portENTER_CRITICAL(&mux_);
+
+  raw_.push(Sample{c, static_cast<uint8_t>(heaterOn ? FLAG_HEATER_ON : 0), 0}, timestampMs);
+
+  // Close the running minute before this sample if it has aged out
+  if (minuteAcc_.count > 0 && (timestampMs - minuteAcc_.startMs) >= MINUTE_MS)
+  {
+    minutes_.push(minuteAcc_.close(), timestampMs);
+
+    if (quarterAcc_.count == 0)
+      quarterAcc_.startMs = minuteAcc_.startMs;
+    quarterAcc_.add(minuteAcc_.sum, minuteAcc_.count, minuteAcc_.min, minuteAcc_.max, minuteAcc_.onCount);
+    if (++minutesInQuarter_ >= MINUTES_PER_QUARTER)
+    {
+      quarters_.push(quarterAcc_.close(), timestampMs);
+      quarterAcc_ = Accumulator{};
+      minutesInQuarter_ = 0;
+    }
+
+    minuteAcc_ = Accumulator{};
+  }
+
+  if (minuteAcc_.count == 0)
+    minuteAcc_.startMs = timestampMs;
+  minuteAcc_.add(c, 1, c, c, heaterOn ? 1 : 0);
+
+  portEXIT_CRITICAL(&mux_);
+}
+
+size_t TemperatureHistory::size(Tier tier) const
+{
+  portENTER_CRITICAL(&mux_);
+  size_t n = 0;
+  switch (tier)
+  {
+  case Tier::Raw:
+    n = raw_.count;
+    break;
+  case Tier::Minute:
+    n = minutes_.count;
+    break;
+  case Tier::Quarter:
+    n = quarters_.count;
+    break;
+  }
+  portEXIT_CRITICAL(&mux_);
+  return n;
+}
+
+bool TemperatureHistory::at(Tier tier, size_t age, Bucket &out) const
+{
+  bool ok = false;
+  portENTER_CRITICAL(&mux_);
+  switch (tier)
+  {
+  case Tier::Raw:
+    if (age < raw_.count)
+    {
+      const Sample &s = raw_.fromNewest(age);
+      out = Bucket{s.centiC, s.centiC, s.centiC,
+                   static_cast<uint8_t>((s.flags & FLAG_HEATER_ON) ? 100 : 0), 0};
+      ok = true;
+    }
+    break;
+  case Tier::Minute:
+    if (age < minutes_.count)
+    {
+      out = minutes_.fromNewest(age);
+      ok = true;
+    }
+    break;
+  case Tier::Quarter:
+    if (age < quarters_.count)
+    {
+      out = quarters_.fromNewest(age);
+      ok = true;
+    }
+    break;
+  }
+  portEXIT_CRITICAL(&mux_);
+  return ok;
+}
+
+uint32_t TemperatureHistory::newestMs(Tier tier) const
+{
+  portENTER_CRITICAL(&mux_);
+  uint32_t ms = 0;
+  switch (tier)
+  {
+  case Tier::Raw:
+    ms = raw_.newestMs;
+    break;
+  case Tier::Minute:
+    ms = minutes_.newestMs;
+    break;
+  case Tier::Quarter:
+    ms = quarters_.newestMs;
+    break;
+  }
+  portEXIT_CRITICAL(&mux_);
+  return ms;
+}
+
+uint32_t TemperatureHistory::intervalSeconds(Tier tier)
+{
+  switch (tier)
+  {
+  case Tier::Minute:
+    return MINUTE_MS / 1000UL;
+  case Tier::Quarter:
+    return (MINUTE_MS / 1000UL) * MINUTES_PER_QUARTER;
+  case Tier::Raw:
+  default:
+    return 1;
+  }
+}
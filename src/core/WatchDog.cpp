@@ -5,16 +5,9 @@
 #include "io/ShellyHandler.h"
 #include "core/LogManager.h"
 #include "heating/HeaterTask.h" // for g_heaterTaskHandle and startHeaterTask
-#include "core/TimeKeeper.h"
 #include "io/LedManager.h"
 #include <esp_system.h> // esp_restart()
 
-String logHeaterRestart();
-String logESPRestart(bool dueToHeater);
-String logWifiReconnectAttempt();
-String logShellyReconnectAttempt();
-String logShellyRestart();
-
 WatchDog::WatchDog(Config &config, Thermostat &thermostat, ShellyHandler &shelly, LogManager &logManager, LedManager &led, HeaterTask &heaterTask)
     : config_(config),
       thermostat_(thermostat),
@@ -74,14 +67,14 @@ void WatchDog::checkShelly()
     {
         Serial.printf("[WatchDog] Shelly not reachable, attempt to reconnect... (attempt %u)\n", shellyReconnectAttempts_);
         WiFi.reconnect();
-        logManager_.append(logShellyReconnectAttempt());
+        logManager_.event(LogEvent::WdShellyReconnect);
         led_.blinkTriple();
         return;
     }
     Serial.println(F("[WatchDog] Max Shelly reconnect attempts reached, restarting Shelly..."));
     shelly_.reboot();
     shellyReconnectAttempts_ = 0; // reset counter after reboot attempt
-    logManager_.append(logShellyRestart());
+    logManager_.event(LogEvent::WdShellyRestart);
     led_.rapidBurst();
 }
 
@@ -97,13 +90,14 @@ void WatchDog::checkWifi()
     {
         Serial.printf("[WatchDog] WiFi disconnected, trying to reconnect... (attempt %u)\n", wifiReconnectAttempts_);
         WiFi.reconnect();
-        logManager_.append(logWifiReconnectAttempt());
+        logManager_.event(LogEvent::WdWifiReconnect);
         led_.blinkDouble();
         return;
     }
     Serial.println(F("[WatchDog] Max WiFi reconnect attempts reached, restarting ESP..."));
-    logManager_.append(logESPRestart(false));
+    logManager_.event(LogEvent::WdEspRestartLink);
     led_.rapidBurst();
+    logManager_.flush();
     esp_restart();
 }
 
@@ -155,62 +149,15 @@ void WatchDog::checkHeater()
 
         // Recreate heater task with same dependencies
         heaterTask_.start(4096, 1); // stack size, priority
-        logManager_.append(logHeaterRestart());
+        logManager_.event(LogEvent::WdHeaterRestart);
         led_.rapidBurst();
         return;
     }
 
     // Too many restarts → full system reboot
     Serial.println(F("[WatchDog] Max heater restarts reached, restarting ESP..."));
-    logManager_.append(logESPRestart(true));
+    logManager_.event(LogEvent::WdEspRestartHeater);
     led_.rapidBurst();
+    logManager_.flush();
     esp_restart();
 }
-
-String logHeaterRestart()
-{
-    String line;
-    line.reserve(64);
-    line += timekeeper::formatLocal();
-    line += " - WatchDog: Heater task restarted";
-    return line;
-}
-String logESPRestart(bool dueToHeater)
-{
-    String line;
-    line.reserve(64);
-    line += timekeeper::formatLocal();
-    if (dueToHeater)
-    {
-        line += " - WatchDog: ESP restarted due to heater task failure";
-    }
-    else
-    {
-        line += " - WatchDog: ESP restarted due to WiFi/Shelly failure";
-    }
-    return line;
-}
-String logWifiReconnectAttempt()
-{
-    String line;
-    line.reserve(64);
-    line += timekeeper::formatLocal();
-    line += " - WatchDog: WiFi reconnect attempt";
-    return line;
-}
-String logShellyReconnectAttempt()
-{
-    String line;
-    line.reserve(64);
-    line += timekeeper::formatLocal();
-    line += " - WatchDog: Shelly reconnect attempt";
-    return line;
-}
-String logShellyRestart()
-{
-    String line;
-    line.reserve(64);
-    line += timekeeper::formatLocal();
-    line += " - WatchDog: Shelly restarted";
-    return line;
-}
@@ -0,0 +1,299 @@
+#include "heating/ActuatorTask.h"
+#include <math.h>
+
+#include "io/measurements.h"
+#include "core/TimeKeeper.h"
+
+namespace
+{
+constexpr const char *ACTUATOR_NS = "actuators";
+
+bool inWindow(int m, uint16_t startMin, uint16_t endMin)
+{
+    if (startMin == endMin)
+        return false;
+    if (startMin < endMin)
+        return m >= startMin && m < endMin;
+    // Wrap-around range, e.g. 20:00–06:00
+    return (m >= startMin) || (m < endMin);
+}
+} // namespace
+
+ActuatorTask::ActuatorTask(Config &config, HeaterTask &heaterTask, LogManager &logManager)
+    : config_(config),
+      heaterTask_(heaterTask),
+      logger_(logManager)
+{
+}
+
+bool ActuatorTask::add(const char *name, ShellyHandler &shelly)
+{
+    if (count_ >= MAX_ACTUATORS || handle_ != nullptr)
+    {
+        Serial.printf("⚠️ [Actuator] Cannot add %s\n", name);
+        return false;
+    }
+    Actuator &a = actuators_[count_++];
+    a.name = name;
+    a.shelly = &shelly;
+    return true;
+}
+
+void ActuatorTask::start(uint32_t stackSize, UBaseType_t priority)
+{
+    if (handle_ != nullptr)
+    {
+        Serial.println("[Actuator] Warning: task already running");
+        return;
+    }
+    if (count_ == 0)
+        return;
+
+    prefs_.begin(ACTUATOR_NS, false);
+    for (size_t i = 0; i < count_; ++i)
+    {
+        Actuator &a = actuators_[i];
+        Settings s;
+        if (prefs_.getBytes(a.name, &s, sizeof(s)) == sizeof(s))
+            a.settings = sanitize(s);
+        Serial.printf("[Actuator] %s -> %s#%u, schedule %s, sensor '%s'\n",
+                      a.name, a.shelly->ip().c_str(), a.shelly->switchId(),
+                      scheduleName(static_cast<Schedule>(a.settings.schedule)), a.settings.sensor);
+    }
+
+    xTaskCreate(
+        &ActuatorTask::taskEntry,
+        "ActuatorTask",
+        stackSize,
+        this,
+        priority,
+        &handle_);
+
+    Serial.println("[Actuator] Started actuator task");
+}
+
+void ActuatorTask::taskEntry(void *pvParameters)
+{
+    auto *self = static_cast<ActuatorTask *>(pvParameters);
+    self->run();
+    // never returns
+}
+
+void ActuatorTask::run()
+{
+    for (;;)
+    {
+        for (size_t i = 0; i < count_; ++i)
+            tick(actuators_[i]);
+
+        vTaskDelay(pdMS_TO_TICKS(config_.heaterTaskDelayS() * 1000));
+    }
+}
+
+void ActuatorTask::tick(Actuator &a)
+{
+    Settings s;
+    bool dirty;
+    portENTER_CRITICAL(&mux_);
+    s = a.settings;
+    dirty = a.dirty;
+    a.dirty = false;
+    portEXIT_CRITICAL(&mux_);
+
+    if (dirty)
+    {
+        a.thermostat.setTarget(s.targetDeciC / 10.0f);
+        a.thermostat.setHysteresis(s.hysteresisDeciC / 10.0f);
+    }
+
+    // Same reconciliation as HeaterTask: trust the relay over our own
+    // bookkeeping unless our command is still queued
+    bool isOn = a.isOn;
+    bool relayOn;
+    uint32_t relayAgeMs;
+    if (!a.shelly->switchPending() &&
+        a.shelly->cachedStatus(relayOn, relayAgeMs) &&
+        relayAgeMs <= RELAY_STALE_PERIODS * a.shelly->refreshIntervalMs())
+        isOn = relayOn;
+
+    const bool scheduled = scheduleAllows(s);
+    bool wantOn = scheduled && !(heaterTask_.isDeadzoneEnabled() && heaterTask_.isInDeadzone());
+
+    float sensorC = NAN;
+    if (s.sensor[0] != '\0')
+    {
+        const Measurements m = latestMeasurement();
+        bool found = false;
+        for (size_t i = 0; i < m.sensorCount; ++i)
+        {
+            if (strcmp(sensorName(i), s.sensor) != 0)
+                continue;
+            found = true;
+            if (m.sensors[i].valid)
+            {
+                sensorC = m.sensors[i].centiC / 100.0f;
+                // Keep the thermostat tracking even while not scheduled so
+                // its hysteresis state is right when the window opens
+                const bool cold = a.thermostat.updateCentiC(m.sensors[i].centiC);
+                wantOn = wantOn && cold;
+            }
+            else
+            {
+                wantOn = false; // don't heat blind
+            }
+            break;
+        }
+        if (!found)
+            wantOn = false;
+    }
+
+    if (wantOn != isOn)
+    {
+        if (isnan(sensorC))
+            logger_.event(wantOn ? LogEvent::ActuatorOn : LogEvent::ActuatorOff, {a.name});
+        else
+            logger_.event(wantOn ? LogEvent::ActuatorOnAt : LogEvent::ActuatorOffAt,
+                          {a.name, s.sensor, sensorC});
+        const char *name = a.name;
+        a.shelly->requestSwitch(wantOn, [this, name, wantOn](ShellyHandler::Result r)
+                                { onSwitchDone(name, wantOn, r); });
+        isOn = wantOn;
+    }
+
+    a.shelly->fitLeaseToCadence(config_.heaterTaskDelayS());
+    if (isOn)
+        a.shelly->holdOn(); // keep the ON lease renewed
+
+    portENTER_CRITICAL(&mux_);
+    a.scheduled = scheduled;
+    a.wantOn = wantOn;
+    a.isOn = isOn;
+    a.sensorC = sensorC;
+    portEXIT_CRITICAL(&mux_);
+}
+
+bool ActuatorTask::scheduleAllows(const Settings &s) const
+{
+    switch (static_cast<Schedule>(s.schedule))
+    {
+    case Schedule::Always:
+        return true;
+
+    case Schedule::Window:
+    {
+        const int m = timekeeper::localMinutesOfDay();
+        return m >= 0 && inWindow(m, s.startMin, s.endMin);
+    }
+
+    case Schedule::ReadyBy:
+    {
+        if (!config_.readyByActive())
+            return false;
+        const uint64_t now = timekeeper::nowUtc();
+        const uint64_t target = config_.readyByTargetEpochUtc();
+        if (now == 0 || now >= target)
+            return false;
+        return (target - now) <= static_cast<uint64_t>(s.leadMin) * 60ULL;
+    }
+
+    case Schedule::Off:
+    default:
+        return false;
+    }
+}
+
+ActuatorTask::Settings ActuatorTask::sanitize(const Settings &in)
+{
+    Settings s = in;
+    if (s.schedule > static_cast<uint8_t>(Schedule::ReadyBy))
+        s.schedule = static_cast<uint8_t>(Schedule::Off);
+    s.reserved = 0;
+    if (s.startMin > 1439)
+        s.startMin = 1439;
+    if (s.endMin > 1439)
+        s.endMin = 1439;
+    if (s.leadMin > 24 * 60)
+        s.leadMin = 24 * 60;
+    if (s.targetDeciC < -300)
+        s.targetDeciC = -300;
+    if (s.targetDeciC > 400)
+        s.targetDeciC = 400;
+    if (s.hysteresisDeciC < 1)
+        s.hysteresisDeciC = 1;
+    if (s.hysteresisDeciC > 100)
+        s.hysteresisDeciC = 100;
+    s.sensor[sizeof(s.sensor) - 1] = '\0';
+    return s;
+}
+
+int ActuatorTask::find(const char *name) const
+{
+    for (size_t i = 0; i < count_; ++i)
+    {
+        if (strcmp(actuators_[i].name, name) == 0)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool ActuatorTask::status(size_t index, Status &out) const
+{
+    if (index >= count_)
+        return false;
+    const Actuator &a = actuators_[index];
+    portENTER_CRITICAL(&mux_);
+    out.name = a.name;
+    out.shelly = a.shelly;
+    out.settings = a.settings;
+    out.scheduled = a.scheduled;
+    out.wantOn = a.wantOn;
+    out.isOn = a.isOn;
+    out.sensorC = a.sensorC;
+    portEXIT_CRITICAL(&mux_);
+    return true;
+}
+
+bool ActuatorTask::setSettings(size_t index, const Settings &settings)
+{
+    if (index >= count_)
+        return false;
+    Actuator &a = actuators_[index];
+    const Settings s = sanitize(settings);
+    portENTER_CRITICAL(&mux_);
+    a.settings = s;
+    a.dirty = true;
+    portEXIT_CRITICAL(&mux_);
+
+    prefs_.putBytes(a.name, &s, sizeof(s));
+    log(String(a.name) + " settings: schedule " + scheduleName(static_cast<Schedule>(s.schedule)) +
+        ", sensor '" + s.sensor + "'");
+    return true;
+}
+
+const char *ActuatorTask::scheduleName(Schedule schedule)
+{
+    switch (schedule)
+    {
+    case Schedule::Always:
+        return "always";
+    case Schedule::Window:
+        return "window";
+    case Schedule::ReadyBy:
+        return "ready_by";
+    case Schedule::Off:
+    default:
+        return "off";
+    }
+}
+
+void ActuatorTask::onSwitchDone(const char *name, bool on, ShellyHandler::Result result) const
+{
+    // Runs on that actuator's Shelly worker; the next tick re-reads the relay
+    if (result == ShellyHandler::Result::Failed)
+        log(String("Warning: ") + name + (on ? " switch ON failed" : " switch OFF failed"));
+}
+
+void ActuatorTask::log(const String &msg) const
+{
+    logger_.tagged("Actuator", msg);
+}
@@ -0,0 +1,231 @@
+#include "heating/EnergyMeter.h"
+#include <math.h>
+
+#include "core/TimeKeeper.h"
+
+namespace
+{
+constexpr const char *ENERGY_NS = "energy";
+constexpr const char *SESSIONS_KEY = "sessions";
+constexpr const char *COUNT_KEY = "count";
+
+// Plausible heater wattage; readings outside are metering glitches
+constexpr float MIN_PLAUSIBLE_W = 100.0f;
+constexpr float MAX_PLAUSIBLE_W = 3000.0f;
+} // namespace
+
+EnergyMeter::EnergyMeter(Config &config)
+    : config_(config)
+{
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+void EnergyMeter::begin()
+{
+    prefs_.begin(ENERGY_NS, false);
+    count_ = prefs_.getUChar(COUNT_KEY, 0);
+    if (count_ > MAX_SESSIONS)
+        count_ = 0;
+
+    size_t n = prefs_.getBytes(SESSIONS_KEY, sessions_.data(), sizeof(Session) * MAX_SESSIONS);
+    if (n != sizeof(Session) * MAX_SESSIONS)
+    {
+        sessions_.fill(Session{});
+        count_ = 0;
+    }
+    Serial.printf("[Energy] Loaded %u sessions\n", static_cast<unsigned>(count_));
+}
+
+void EnergyMeter::tick(uint32_t nowMs, bool relayOn, const ShellyStatus &status)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    if (!open_)
+    {
+        if (!relayOn)
+        {
+            lastCounterWh_ = status.energyWh;
+            xSemaphoreGive(mutex_);
+            return;
+        }
+        openLocked(Kind::Thermostat, nowMs);
+    }
+
+    const uint32_t dtMs = nowMs - lastTickMs_;
+    if (lastRelayOn_)
+        onMs_ += dtMs;
+
+    // Energy since the previous tick; a counter that went backwards means
+    // the Shelly restarted, so fall back to integration for that step
+    if (isfinite(status.energyWh) && isfinite(lastCounterWh_) && status.energyWh >= lastCounterWh_)
+    {
+        energyWh_ += status.energyWh - lastCounterWh_;
+    }
+    else if (lastRelayOn_)
+    {
+        float watts = status.apowerW;
+        Source used = Source::Integrated;
+        if (!isfinite(watts))
+        {
+            watts = config_.heaterPowerW();
+            used = Source::Assumed;
+        }
+        energyWh_ += watts * (static_cast<float>(dtMs) / 3600000.0f);
+        if (used > source_)
+            source_ = used;
+    }
+    lastCounterWh_ = status.energyWh;
+
+    if (relayOn)
+    {
+        lastOnMs_ = nowMs;
+        if (isfinite(status.apowerW) && status.apowerW >= MIN_PLAUSIBLE_W && status.apowerW <= MAX_PLAUSIBLE_W)
+        {
+            powerSumW_ += status.apowerW;
+            ++powerSamples_;
+        }
+    }
+    lastRelayOn_ = relayOn;
+    lastTickMs_ = nowMs;
+
+    // A thermostat session ends at its last ON once the relay stays off
+    if (kind_ == Kind::Thermostat && !relayOn && (nowMs - lastOnMs_) >= THERMOSTAT_GAP_MS)
+        closeLocked(lastOnMs_);
+
+    xSemaphoreGive(mutex_);
+}
+
+void EnergyMeter::beginSession(Kind kind)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const uint32_t now = millis();
+    if (open_)
+        closeLocked(now);
+    openLocked(kind, now);
+    xSemaphoreGive(mutex_);
+}
+
+void EnergyMeter::endSession(Kind kind)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (open_ && kind_ == kind)
+        closeLocked(millis());
+    xSemaphoreGive(mutex_);
+}
+
+float EnergyMeter::currentAvgOnW() const
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    float w = (open_ && powerSamples_ > 0) ? powerSumW_ / powerSamples_ : NAN;
+    xSemaphoreGive(mutex_);
+    return w;
+}
+
+void EnergyMeter::openLocked(Kind kind, uint32_t nowMs)
+{
+    open_ = true;
+    kind_ = kind;
+    startEpochUtc_ = timekeeper::isValid() ? static_cast<uint32_t>(timekeeper::nowUtc()) : 0;
+    startMs_ = nowMs;
+    lastTickMs_ = nowMs;
+    lastOnMs_ = nowMs;
+    onMs_ = 0;
+    energyWh_ = 0.0f;
+    powerSumW_ = 0.0f;
+    powerSamples_ = 0;
+    source_ = Source::Counter;
+    // lastRelayOn_ and lastCounterWh_ carry over: they describe the relay,
+    // not the session
+}
+
+EnergyMeter::Session EnergyMeter::currentLocked(uint32_t endMs) const
+{
+    Session s{};
+    s.startEpochUtc = startEpochUtc_;
+    s.durationS = (endMs - startMs_) / 1000;
+    s.onS = onMs_ / 1000;
+    s.energyDeciWh = static_cast<uint32_t>(lroundf(energyWh_ * 10.0f));
+    s.avgOnW = (powerSamples_ > 0) ? static_cast<uint16_t>(lroundf(powerSumW_ / powerSamples_)) : 0;
+    s.kind = static_cast<uint8_t>(kind_);
+    s.source = static_cast<uint8_t>(source_);
+    return s;
+}
+
+void EnergyMeter::closeLocked(uint32_t endMs)
+{
+    open_ = false;
+    const Session s = currentLocked(endMs);
+    if (s.onS < MIN_SAVE_ON_S)
+        return; // relay blip, not worth a record
+
+    // Newest first; the oldest record drops off the end
+    for (size_t i = MAX_SESSIONS - 1; i > 0; --i)
+        sessions_[i] = sessions_[i - 1];
+    sessions_[0] = s;
+    if (count_ < MAX_SESSIONS)
+        ++count_;
+    saveLocked();
+
+    Serial.printf("[Energy] %s session: %.1f Wh, %lus on of %lus, avg %u W\n",
+                  kindName(s.kind), s.energyDeciWh / 10.0f,
+                  static_cast<unsigned long>(s.onS), static_cast<unsigned long>(s.durationS),
+                  static_cast<unsigned>(s.avgOnW));
+
+    // Learn the real wattage (extension cords sag it in the cold)
+    if (powerSamples_ >= MIN_POWER_SAMPLES)
+    {
+        const float measured = powerSumW_ / powerSamples_;
+        const float learned = config_.heaterPowerW() + (measured - config_.heaterPowerW()) * LEARN_WEIGHT;
+        config_.setHeaterPowerW(learned);
+        config_.save();
+    }
+}
+
+void EnergyMeter::saveLocked()
+{
+    prefs_.putBytes(SESSIONS_KEY, sessions_.data(), sizeof(Session) * MAX_SESSIONS);
+    prefs_.putUChar(COUNT_KEY, static_cast<uint8_t>(count_));
+}
+
+EnergyMeter::Snapshot EnergyMeter::snapshot() const
+{
+    Snapshot snap{};
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    snap.open = open_;
+    if (open_)
+        snap.current = currentLocked(millis());
+    snap.count = count_;
+    snap.sessions = sessions_;
+    xSemaphoreGive(mutex_);
+    return snap;
+}
+
+const char *EnergyMeter::kindName(uint8_t kind)
+{
+    switch (static_cast<Kind>(kind))
+    {
+    case Kind::Thermostat:
+        return "thermostat";
+    case Kind::ReadyBy:
+        return "ready_by";
+    case Kind::Calibration:
+        return "calibration";
+    default:
+        return "unknown";
+    }
+}
+
+const char *EnergyMeter::sourceName(uint8_t source)
+{
+    switch (static_cast<Source>(source))
+    {
+    case Source::Counter:
+        return "counter";
+    case Source::Integrated:
+        return "integrated";
+    case Source::Assumed:
+        return "assumed";
+    default:
+        return "unknown";
+    }
+}
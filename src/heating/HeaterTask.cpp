@@ -3,6 +3,7 @@
 #include "io/measurements.h"
 #include "core/TimeKeeper.h"
 #include "io/WebSocketHub.h"
+#include "heating/EnergyMeter.h"
 
 HeaterTask::HeaterTask(Config &config,
                        Thermostat &thermostat,
@@ -49,18 +50,43 @@ void HeaterTask::run()
 {
     dzEnabled_ = config_.deadzoneEnabled();
     enabled_   = config_.heaterTaskEnabled();
+    // Sized for the slowest sensor, e.g. 750 ms for a 12-bit DS18B20
+    const uint32_t sampleWaitMs = measurementWaitMs() + SAMPLE_WAIT_MARGIN_MS;
     for (;;)
     {
-        if (!shelly_.getStatus(isHeaterOn_, false))
-            log("Warning: Failed to get Shelly status");
+        uint32_t seenSeq = requestMeasurement();
 
-        currentTemp_ = takeMeasurement(false).temperature;
-        bool shouldHeat = thermostat_.update(currentTemp_);
+        // The Shelly worker keeps the relay state fresh in the background;
+        // while our own command is still queued the cache predates it
+        bool relayOn;
+        uint32_t relayAgeMs;
+        if (!shelly_.switchPending())
+        {
+            if (!shelly_.cachedStatus(relayOn, relayAgeMs) || relayAgeMs > RELAY_STALE_PERIODS * shelly_.refreshIntervalMs())
+                log("Warning: Failed to get Shelly status");
+            else if (relayOn != isHeaterOn_)
+            {
+                isHeaterOn_ = relayOn;
+                if (relayCallback_)
+                    relayCallback_(isHeaterOn_); // switched outside this firmware, or our command failed
+            }
+        }
+
+        Measurements m;
+        const bool gotSample = waitForMeasurement(seenSeq, sampleWaitMs, m);
+        if (!gotSample && !sampleLate_)
+            log(String("Warning: No new sample within ") + sampleWaitMs + " ms; keeping the last decision");
+        sampleLate_ = !gotSample;
+        currentTemp_ = m.temperature;
+        // Integer path straight from the sensor; no new decision without a
+        // new sample (the relay, lease and watchdog upkeep below still run)
+        bool shouldHeat = (gotSample && m.seq != 0) ? thermostat_.updateCentiC(m.temperatureCentiC)
+                                                    : thermostat_.isHeaterOn();
 
         bool inDeadzone = isInDeadzone();
         if (inDeadzone != lastInDeadzone_)
         {
-            logger_.append(logDZChange(inDeadzone));
+            logger_.event(inDeadzone ? LogEvent::DeadzoneEnter : LogEvent::DeadzoneExit);
             lastInDeadzone_ = inDeadzone;
         }
 
@@ -74,17 +100,31 @@ void HeaterTask::run()
             if (shouldHeat && !isHeaterOn_)
             {
                 turnHeaterOn();
-                logger_.append(logHeaterChange(true, currentTemp_));
+                logger_.event(LogEvent::HeaterOn, {currentTemp_, config_.targetTemp()});
                 led_.blinkSingle();
             }
             else if (!shouldHeat && isHeaterOn_)
             {
                 turnHeaterOff();
-                logger_.append(logHeaterChange(false, currentTemp_));
+                logger_.event(LogEvent::HeaterOff, {currentTemp_, config_.targetTemp()});
                 led_.blinkSingle();
             }
         }
 
+        // Keeps the Shelly renewing its ON lease; if this loop stops, the
+        // relay switches itself off
+        shelly_.fitLeaseToCadence(config_.heaterTaskDelayS());
+        if (isHeaterOn_)
+            shelly_.holdOn();
+
+        if (energy_)
+        {
+            ShellyStatus meter;
+            uint32_t meterAgeMs;
+            shelly_.cachedStatus(meter, meterAgeMs);
+            energy_->tick(millis(), isHeaterOn_, meter);
+        }
+
         // Tell the watchdog "I am alive" (if configured)
         if (kickCallback_)
             kickCallback_();
@@ -102,15 +142,29 @@ bool HeaterTask::turnHeaterOn(bool force)
 {
     if (!isInDeadzone() || !dzEnabled_ || force)
     {
+        if (!isHeaterOn_ && relayCallback_)
+            relayCallback_(true);
         isHeaterOn_ = true;
-        return shelly_.switchOn();
+        return shelly_.requestSwitch(true, [this](ShellyHandler::Result r)
+                                     { onSwitchDone(true, r); });
     }
     return false;
 }
 bool HeaterTask::turnHeaterOff()
 {
+    if (isHeaterOn_ && relayCallback_)
+        relayCallback_(false);
     isHeaterOn_ = false;
-    return shelly_.switchOff();
+    return shelly_.requestSwitch(false, [this](ShellyHandler::Result r)
+                                 { onSwitchDone(false, r); });
+}
+
+void HeaterTask::onSwitchDone(bool on, ShellyHandler::Result result) const
+{
+    // Runs on the Shelly worker. The next loop corrects isHeaterOn_ from
+    // the refreshed relay state, so only report it here.
+    if (result == ShellyHandler::Result::Failed)
+        log(on ? "Warning: Shelly switch ON failed" : "Warning: Shelly switch OFF failed");
 }
 
 bool HeaterTask::isInDeadzone() const
@@ -154,36 +208,7 @@ void HeaterTask::setDeadzoneEnabled(bool enabled) {
     config_.save();
 }
 
-String HeaterTask::logHeaterChange(bool isOn, float currentTemp) const
-{
-    String line;
-    line.reserve(60);
-    line += timekeeper::formatLocal(); // "YYYY-MM-DD HH:MM:SS"
-    line += isOn ? " Heater turned ON" : " Heater turned OFF";
-    line += " By HeaterTask | Current: ";
-    line += String(currentTemp, 1);
-    line += "°C Target: ";
-    line += String(config_.targetTemp(), 1);
-    line += "°C";
-    return line;
-}
-
-String HeaterTask::logDZChange(bool inDZ) const
+void HeaterTask::log(const String &msg) const
 {
-    String line;
-    line.reserve(60);
-    line += timekeeper::formatLocal();
-    line += inDZ ? " Entered deadzone" : " Exited deadzone";
-    return line;
+    logger_.tagged("HeaterTask", msg);
 }
-
-String HeaterTask::log(const String &msg) const
-{
-    String line;
-    line.reserve(60 + msg.length());
-    line += timekeeper::formatLocal();
-    line += " [HeaterTask] ";
-    line += msg;
-    logger_.append(line);
-    return line;
-}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "heating/HeatingCalculator.h"
+#include <math.h>
 
 HeatingCalculator::HeatingCalculator(float cabinVolume_m3,
                                      float heaterPower_W,
@@ -40,7 +41,26 @@ float HeatingCalculator::estimateWarmupSeconds(float kFactor, float ambientTempC
     return totalSeconds;
 }
 
+float HeatingCalculator::heatingRateCPerMin(float kFactor) const
+{
+    const float massAir_kg = airDensity_kg_m3_ * cabinVolume_m3_;
+    const float idealSecondsPerDeg = (massAir_kg * specificHeat_J_kgK_) / heaterPower_W_;
+    const float effectiveSecondsPerDeg = idealSecondsPerDeg * kFactor;
+    if (effectiveSecondsPerDeg <= 0.0f) {
+        return 0.0f;
+    }
+    return 60.0f / effectiveSecondsPerDeg;
+}
+
 float HeatingCalculator::estimateWarmupMinutes(float kFactor, float ambientTempC, float targetTempC) const
 {
     return estimateWarmupSeconds(kFactor, ambientTempC, targetTempC) / 60.0f;
 }
+
+void HeatingCalculator::setHeaterPower(float heaterPower_W)
+{
+    // Ignore nonsense so a bad reading can't divide by zero above
+    if (isfinite(heaterPower_W) && heaterPower_W > 0.0f) {
+        heaterPower_W_ = heaterPower_W;
+    }
+}
@@ -3,7 +3,15 @@
 #include "io/measurements.h"
 #include "core/TimeKeeper.h"
 #include "heating/HeatingCalculator.h"
-#include "heating/KFactorCalibrator.h"
+#include "heating/EnergyMeter.h"
+#include "heating/KFactorCalibrationManager.h"
+#include "io/SlopeEstimator.h"
+
+namespace
+{
+// Warn when the cabin heats at less than this share of the modelled rate
+constexpr float SLOW_RATE_RATIO = 0.6f;
+}
 
 ReadyByTask::ReadyByTask(Config &config,
                          HeaterTask &heaterTask,
@@ -51,6 +59,7 @@ void ReadyByTask::schedule(uint64_t targetEpochUtc, float targetTempC)
     config_.setReadyByActive(true);
     heatingForced_ = false;
     targetTempReached_ = false;
+    slowRateLogged_ = false;
 
     thermostat_.setTarget(targetTempC);
     thermostat_.setHysteresis(0.0f); // disable hysteresis during ReadyBy
@@ -62,13 +71,7 @@ void ReadyByTask::schedule(uint64_t targetEpochUtc, float targetTempC)
     String targetFormatted = timekeeper::formatEpoch(targetEpochUtc);
     Serial.printf("[ReadyBy] Scheduled: target time=%s, targetTemp=%.1f°C\n",
                   targetFormatted.c_str(), targetTempC);
-    char buf[128];
-    snprintf(
-        buf,
-        sizeof(buf),
-        "Scheduled: target time=%s, targetTemp=%.1f°C",
-        targetFormatted.c_str(), targetTempC);
-    log(String(buf));
+    logManager_.event(LogEvent::ReadyByScheduled, {LogArg::epoch(targetEpochUtc), targetTempC});
 }
 
 bool ReadyByTask::getSchedule(uint64_t &targetEpochUtc, float &targetTempC) const
@@ -114,6 +117,9 @@ void ReadyByTask::run()
             continue;
         }
 
+        // Follows the wattage learned from the Shelly's metering
+        calculator.setHeaterPower(config_.heaterPowerW());
+
         bool exiting = false;
 
         // Capture current schedule state into locals (avoid re-reading volatile)
@@ -121,19 +127,14 @@ void ReadyByTask::run()
         float targetTmp = config_.readyByTargetTemp();
 
         // Measure current ambient
-        float ambient = takeMeasurement(false).temperature;
+        const Measurements m = latestMeasurement();
+        float ambient = m.temperature;
 
         // If we somehow ended up past target time, stop forcing and clear schedule
         if (now >= targetUtc)
         {
             exiting = true;
-            char buf[128];
-            snprintf(
-                buf,
-                sizeof(buf),
-                "Past target time, exiting. Reached temperature: %.1f/%.1f°C",
-                ambient, targetTmp);
-            log(String(buf));
+            logManager_.event(LogEvent::ReadyByPastTarget, {ambient, targetTmp});
             Serial.println("[ReadyBy] Schedule completed");
         }
 
@@ -143,6 +144,7 @@ void ReadyByTask::run()
         {
             k = calibMgr_->derivedKFor(ambient, targetTmp);
         }
+        predictedRateCPerMin_ = calculator.heatingRateCPerMin(k);
         float warmupSec = calculator.estimateWarmupSeconds(k, ambient, targetTmp);
         if (warmupSec < 0.0f)
         {
@@ -174,30 +176,23 @@ void ReadyByTask::run()
                 bool ok = heaterTask_.turnHeaterOn(true);
                 Serial.printf("[ReadyBy] Forcing heater ON to meet schedule (ambient=%.1f°C, target=%.1f°C, warmup=%.0fs) -> %s\n",
                               ambient, targetTmp, warmupSec, ok ? "OK" : "FAILED");
-                char buf[128];
-                snprintf(
-                    buf,
-                    sizeof(buf),
-                    "Forcing heater ON (ambient=%.1f°C, target=%.1f°C, warmup=%.0fs)",
-                    ambient, targetTmp, warmupSec);
-                log(String(buf));
+                logManager_.event(LogEvent::ReadyByForceOn, {ambient, targetTmp, warmupSec});
                 if (ok)
                 {
                     heatingForced_ = true;
+                    forcedSinceMs_ = millis();
+                    if (energy_)
+                        energy_->beginSession(EnergyMeter::Kind::ReadyBy);
                 }
             }
+            checkHeatingRate(m.slopeCPerMin, ambient, targetTmp, secondsUntilTarget);
             bool shouldHeat = thermostat_.update(ambient);
             bool heaterOn = heaterTask_.isHeaterOn();
             if (!shouldHeat && !targetTempReached_)
             {
                 // Target temp reached early
-                char buf[128];
-                snprintf(
-                    buf,
-                    sizeof(buf),
-                    "Target temperature %.1f°C reached %.0f minutes early (ambient=%.1f°C)",
-                    targetTmp, (static_cast<float>(secondsUntilTarget) / 60.0f), ambient);
-                log(String(buf));
+                logManager_.event(LogEvent::ReadyByReachedEarly,
+                                  {targetTmp, static_cast<float>(secondsUntilTarget) / 60.0f, ambient});
                 Serial.println("[ReadyBy] Target temperature reached; maintaining.");
                 targetTempReached_ = true;
                 thermostat_.setHysteresis(config_.hysteresis());
@@ -228,22 +223,52 @@ void ReadyByTask::run()
     }
 }
 
-String ReadyByTask::log(const String &msg) const
+void ReadyByTask::checkHeatingRate(float slopeCPerMin, float ambient, float targetTmp,
+                                   uint64_t secondsUntilTarget)
+{
+    // The slope window must only contain samples taken with the heater on
+    const uint32_t windowMs = SlopeEstimator::WINDOW * 1000UL;
+    if (!heatingForced_ || targetTempReached_ || (millis() - forcedSinceMs_) < windowMs)
+    {
+        observedRateCPerMin_ = NAN;
+        return;
+    }
+    observedRateCPerMin_ = slopeCPerMin;
+
+    const float predicted = predictedRateCPerMin_;
+    if (slowRateLogged_ || !isfinite(slopeCPerMin) || !(predicted > 0.0f))
+        return;
+    if (slopeCPerMin >= predicted * SLOW_RATE_RATIO)
+        return;
+
+    // Behind the model; only worth a log line if it costs the deadline
+    const float remainingC = targetTmp - ambient;
+    const float etaMin = (slopeCPerMin > 0.0f) ? remainingC / slopeCPerMin : INFINITY;
+    const float leftMin = static_cast<float>(secondsUntilTarget) / 60.0f;
+    if (etaMin <= leftMin)
+        return;
+
+    const float lateMin = isfinite(etaMin) ? etaMin - leftMin : leftMin;
+    logManager_.event(LogEvent::ReadyBySlow, {slopeCPerMin, predicted, lateMin});
+    Serial.printf("[ReadyBy] Heating slower than predicted (%.2f vs %.2f °C/min); target likely missed by %.0f min\n",
+                  slopeCPerMin, predicted, lateMin);
+    slowRateLogged_ = true;
+}
+
+void ReadyByTask::log(const String &msg) const
 {
-    String line;
-    line.reserve(60 + msg.length());
-    line += timekeeper::formatLocal();
-    line += " [ReadyByTask] ";
-    line += msg;
-    logManager_.append(line);
-    return line;
+    logManager_.tagged("ReadyByTask", msg);
 }
 
 void ReadyByTask::exitActions()
 {
     config_.setReadyByActive(false);
+    if (heatingForced_ && energy_)
+        energy_->endSession(EnergyMeter::Kind::ReadyBy);
     heatingForced_ = false;
     targetTempReached_ = false;
+    slowRateLogged_ = false;
+    observedRateCPerMin_ = NAN;
     thermostat_.setTarget(config_.targetTemp());
     thermostat_.setHysteresis(config_.hysteresis());
     heaterTask_.setEnabled(true); // re-enable normal thermostat control
@@ -6,41 +6,56 @@ Thermostat::Thermostat(float targetTemp, float hysteresis)
       hysteresis_(hysteresis),
       heaterOn_(false),
       initialized_(false) {
-      }
+    recomputeThresholds();
+}
 
-bool Thermostat::update(float currentTemp) {
+void Thermostat::recomputeThresholds() {
     const float halfBand = hysteresis_ * 0.5f;
+    targetCentiC_   = static_cast<int32_t>(lroundf(targetTemp_ * 100.0f));
+    onBelowCentiC_  = static_cast<int32_t>(lroundf((targetTemp_ - halfBand) * 100.0f));
+    offAboveCentiC_ = static_cast<int32_t>(lroundf((targetTemp_ + halfBand) * 100.0f));
+}
+
+bool Thermostat::update(float currentTemp) {
+    if (!isfinite(currentTemp)) {
+        return heaterOn_; // no reading yet; keep the previous decision
+    }
+    return updateCentiC(static_cast<int32_t>(lroundf(currentTemp * 100.0f)));
+}
 
+bool Thermostat::updateCentiC(int32_t currentCentiC) {
     if (!initialized_) {
-        heaterOn_ = currentTemp < targetTemp_;
+        heaterOn_ = currentCentiC < targetCentiC_;
         initialized_ = true;
         Serial.printf("[Thermostat] Initial state: shouldHeat=%s (currentTemp=%.2f, targetTemp=%.2f)\n",
                       heaterOn_ ? "true" : "false",
-                      currentTemp,
+                      currentCentiC / 100.0f,
                       targetTemp_);
         return heaterOn_;
     }
 
     if (heaterOn_) {
-        if (currentTemp >= targetTemp_ + halfBand) {
+        if (currentCentiC >= offAboveCentiC_) {
             heaterOn_ = false;
         }
     } else {
-        if (currentTemp <= targetTemp_ - halfBand) {
+        if (currentCentiC <= onBelowCentiC_) {
             heaterOn_ = true;
         }
     }
-    /* Serial.printf("[Thermostat] update: currentTemp=%.2f, targetTemp=%.2f, hysteresis=%.2f => shouldHeat=%s\n",
-                  currentTemp,
-                  targetTemp_,
-                  hysteresis_,
-                  heaterOn_ ? "true" : "false"); */
 
     return heaterOn_;
 }
 
-void Thermostat::setTarget(float targetTemp) { targetTemp_ = targetTemp; }
-void Thermostat::setHysteresis(float hysteresis) { hysteresis_ = hysteresis; }
+void Thermostat::setTarget(float targetTemp) {
+    targetTemp_ = targetTemp;
+    recomputeThresholds();
+}
+
+void Thermostat::setHysteresis(float hysteresis) {
+    hysteresis_ = hysteresis;
+    recomputeThresholds();
+}
 
 float Thermostat::target() const { return targetTemp_; }
 float Thermostat::hysteresis() const { return hysteresis_; }
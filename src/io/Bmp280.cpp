@@ -0,0 +1,133 @@
+#include "io/Bmp280.h"
+
+namespace
+{
+constexpr uint8_t REG_CALIB     = 0x88;
+constexpr uint8_t REG_CHIP_ID   = 0xD0;
+constexpr uint8_t REG_STATUS    = 0xF3;
+constexpr uint8_t REG_CTRL_MEAS = 0xF4;
+constexpr uint8_t REG_CONFIG    = 0xF5;
+constexpr uint8_t REG_DATA      = 0xF7; // press_msb .. temp_xlsb
+
+constexpr uint8_t STATUS_MEASURING = 0x08;
+constexpr uint8_t MODE_SLEEP  = 0x0;
+constexpr uint8_t MODE_FORCED = 0x1;
+
+// t_sb = 500 ms (100), filter = x16 (100)
+constexpr uint8_t CONFIG_VALUE = (0x4 << 5) | (0x4 << 2);
+
+inline uint16_t le16(const uint8_t *b) { return static_cast<uint16_t>(b[0] | (b[1] << 8)); }
+} // namespace
+
+bool Bmp280::begin(uint8_t address, TwoWire &wire)
+{
+    wire_ = &wire;
+    addr_ = address;
+
+    uint8_t id = 0;
+    if (!readRegs(REG_CHIP_ID, &id, 1))
+        return false;
+    // 0x58 for production parts, 0x56/0x57 for engineering samples
+    if (id != 0x58 && id != 0x56 && id != 0x57)
+        return false;
+
+    uint8_t raw[24];
+    if (!readRegs(REG_CALIB, raw, sizeof(raw)))
+        return false;
+
+    calib_.t1 = le16(&raw[0]);
+    calib_.t2 = static_cast<int16_t>(le16(&raw[2]));
+    calib_.t3 = static_cast<int16_t>(le16(&raw[4]));
+    calib_.p1 = le16(&raw[6]);
+    calib_.p2 = static_cast<int16_t>(le16(&raw[8]));
+    calib_.p3 = static_cast<int16_t>(le16(&raw[10]));
+    calib_.p4 = static_cast<int16_t>(le16(&raw[12]));
+    calib_.p5 = static_cast<int16_t>(le16(&raw[14]));
+    calib_.p6 = static_cast<int16_t>(le16(&raw[16]));
+    calib_.p7 = static_cast<int16_t>(le16(&raw[18]));
+    calib_.p8 = static_cast<int16_t>(le16(&raw[20]));
+    calib_.p9 = static_cast<int16_t>(le16(&raw[22]));
+
+    // config is only writable reliably in sleep mode
+    return writeReg(REG_CTRL_MEAS, MODE_SLEEP) && writeReg(REG_CONFIG, CONFIG_VALUE);
+}
+
+bool Bmp280::trigger(uint8_t osrsT, uint8_t osrsP)
+{
+    uint8_t ctrl = static_cast<uint8_t>(((osrsT & 0x7) << 5) | ((osrsP & 0x7) << 2) | MODE_FORCED);
+    return writeReg(REG_CTRL_MEAS, ctrl);
+}
+
+bool Bmp280::isMeasuring(bool &measuring)
+{
+    uint8_t status = 0;
+    if (!readRegs(REG_STATUS, &status, 1))
+        return false;
+    measuring = (status & STATUS_MEASURING) != 0;
+    return true;
+}
+
+bool Bmp280::readRaw(int32_t &adcT, int32_t &adcP)
+{
+    uint8_t b[6];
+    if (!readRegs(REG_DATA, b, sizeof(b)))
+        return false;
+    adcP = (static_cast<int32_t>(b[0]) << 12) | (static_cast<int32_t>(b[1]) << 4) | (b[2] >> 4);
+    adcT = (static_cast<int32_t>(b[3]) << 12) | (static_cast<int32_t>(b[4]) << 4) | (b[5] >> 4);
+    return true;
+}
+
+int32_t Bmp280::compensateTemperatureCentiC(int32_t adcT, int32_t &tFine) const
+{
+    const int32_t t1 = static_cast<int32_t>(calib_.t1);
+    const int32_t t2 = static_cast<int32_t>(calib_.t2);
+    const int32_t t3 = static_cast<int32_t>(calib_.t3);
+
+    int32_t var1 = ((((adcT >> 3) - (t1 << 1))) * t2) >> 11;
+    int32_t var2 = (((((adcT >> 4) - t1) * ((adcT >> 4) - t1)) >> 12) * t3) >> 14;
+    tFine = var1 + var2;
+    return (tFine * 5 + 128) >> 8;
+}
+
+uint32_t Bmp280::compensatePressurePa(int32_t adcP, int32_t tFine) const
+{
+    int64_t var1 = static_cast<int64_t>(tFine) - 128000;
+    int64_t var2 = var1 * var1 * static_cast<int64_t>(calib_.p6);
+    var2 = var2 + ((var1 * static_cast<int64_t>(calib_.p5)) * (static_cast<int64_t>(1) << 17));
+    var2 = var2 + (static_cast<int64_t>(calib_.p4) * (static_cast<int64_t>(1) << 35));
+    var1 = ((var1 * var1 * static_cast<int64_t>(calib_.p3)) >> 8) +
+           ((var1 * static_cast<int64_t>(calib_.p2)) * (static_cast<int64_t>(1) << 12));
+    var1 = (((static_cast<int64_t>(1) << 47) + var1) * static_cast<int64_t>(calib_.p1)) >> 33;
+    if (var1 == 0)
+        return 0; // avoid division by zero
+
+    int64_t p = 1048576 - adcP;
+    p = (((p * (static_cast<int64_t>(1) << 31)) - var2) * 3125) / var1;
+    var1 = (static_cast<int64_t>(calib_.p9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (static_cast<int64_t>(calib_.p8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (static_cast<int64_t>(calib_.p7) * 16);
+
+    // p is Q24.8 Pa; drop the fraction with rounding
+    return static_cast<uint32_t>((p + 128) >> 8);
+}
+
+bool Bmp280::writeReg(uint8_t reg, uint8_t value)
+{
+    wire_->beginTransmission(addr_);
+    wire_->write(reg);
+    wire_->write(value);
+    return wire_->endTransmission() == 0;
+}
+
+bool Bmp280::readRegs(uint8_t reg, uint8_t *buf, size_t len)
+{
+    wire_->beginTransmission(addr_);
+    wire_->write(reg);
+    if (wire_->endTransmission(false) != 0)
+        return false;
+    if (wire_->requestFrom(addr_, len) != len)
+        return false;
+    for (size_t i = 0; i < len; ++i)
+        buf[i] = static_cast<uint8_t>(wire_->read());
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "io/Bmp280Sensor.h"
+
+namespace
+{
+uint32_t oversamplingCount(Oversampling os)
+{
+    uint8_t code = static_cast<uint8_t>(os);
+    return code == 0 ? 0 : (1u << (code - 1));
+}
+} // namespace
+
+Bmp280Sensor::Bmp280Sensor(uint8_t address, TwoWire &wire)
+    : wire_(wire), address_(address)
+{
+}
+
+bool Bmp280Sensor::begin()
+{
+    return chip_.begin(address_, wire_);
+}
+
+bool Bmp280Sensor::trigger(const SamplingProfile &profile, bool withPressure)
+{
+    Oversampling p = withPressure ? profile.pressure : Oversampling::Skip;
+    if (!chip_.trigger(static_cast<uint8_t>(profile.temperature), static_cast<uint8_t>(p)))
+        return false;
+    convertingPressure_ = (p != Oversampling::Skip);
+    return true;
+}
+
+// Datasheet max t_meas: 1.25 + 2.3*T + (2.3*P + 0.575) ms, pressure term only if enabled
+uint32_t Bmp280Sensor::conversionMs(const SamplingProfile &profile, bool withPressure) const
+{
+    uint32_t us = 1250 + 2300 * oversamplingCount(profile.temperature);
+    if (withPressure && profile.pressure != Oversampling::Skip)
+        us += 2300 * oversamplingCount(profile.pressure) + 575;
+    return (us + 999) / 1000;
+}
+
+bool Bmp280Sensor::ready()
+{
+    bool measuring = true;
+    return chip_.isMeasuring(measuring) && !measuring;
+}
+
+bool Bmp280Sensor::collect(Reading &out)
+{
+    int32_t adcT = 0;
+    int32_t adcP = 0;
+    if (!chip_.readRaw(adcT, adcP) || adcT == Bmp280::ADC_SKIPPED)
+        return false;
+
+    int32_t tFine = 0;
+    out.centiC = chip_.compensateTemperatureCentiC(adcT, tFine);
+
+    // Pressure is only compensated after a pressure conversion; otherwise
+    // the last good value is carried over
+    if (convertingPressure_ && adcP != Bmp280::ADC_SKIPPED)
+    {
+        uint32_t pa = chip_.compensatePressurePa(adcP, tFine);
+        if (pa > 30000 && pa < 110000)
+            lastPressurePa_ = pa;
+    }
+    out.pressurePa = lastPressurePa_;
+    return true;
+}
@@ -0,0 +1,111 @@
+#include "io/Ds18b20Sensor.h"
+
+#include <string.h>
+
+namespace
+{
+constexpr uint8_t FAMILY_DS18B20     = 0x28;
+constexpr uint8_t CMD_CONVERT_T      = 0x44;
+constexpr uint8_t CMD_READ_SCRATCH   = 0xBE;
+constexpr uint8_t CMD_WRITE_SCRATCH  = 0x4E;
+
+// Max conversion time for 9..12 bit resolution (datasheet t_CONV)
+constexpr uint32_t CONVERSION_MS[] = {94, 188, 375, 750};
+} // namespace
+
+Ds18b20Sensor::Ds18b20Sensor(OneWire &bus, const uint8_t *rom, uint8_t resolutionBits)
+    : bus_(bus),
+      resolutionBits_(resolutionBits < 9 ? 9 : (resolutionBits > 12 ? 12 : resolutionBits))
+{
+    if (rom != nullptr)
+    {
+        memcpy(rom_, rom, sizeof(rom_));
+        haveRom_ = true;
+    }
+}
+
+bool Ds18b20Sensor::begin()
+{
+    if (!haveRom_)
+    {
+        bus_.reset_search();
+        while (bus_.search(rom_))
+        {
+            if (rom_[0] == FAMILY_DS18B20 && OneWire::crc8(rom_, 7) == rom_[7])
+            {
+                haveRom_ = true;
+                break;
+            }
+        }
+        if (!haveRom_)
+            return false;
+    }
+
+    // TH/TL alarm bytes are unused; config byte carries the resolution
+    if (!select())
+        return false;
+    bus_.write(CMD_WRITE_SCRATCH);
+    bus_.write(0x4B);
+    bus_.write(0x46);
+    bus_.write(static_cast<uint8_t>(((resolutionBits_ - 9) << 5) | 0x1F));
+    return bus_.reset() != 0;
+}
+
+bool Ds18b20Sensor::select()
+{
+    if (!haveRom_ || bus_.reset() == 0)
+        return false; // no presence pulse
+    bus_.select(rom_);
+    return true;
+}
+
+bool Ds18b20Sensor::trigger(const SamplingProfile &, bool)
+{
+    if (!select())
+        return false;
+    bus_.write(CMD_CONVERT_T, 0);
+    triggerMs_ = millis();
+    return true;
+}
+
+uint32_t Ds18b20Sensor::conversionMs(const SamplingProfile &, bool) const
+{
+    return CONVERSION_MS[resolutionBits_ - 9];
+}
+
+bool Ds18b20Sensor::ready()
+{
+    // Polling read slots only works while the bus stays idle, and other
+    // devices on it may be addressed in between; go by the datasheet time.
+    return (millis() - triggerMs_) >= CONVERSION_MS[resolutionBits_ - 9];
+}
+
+bool Ds18b20Sensor::collect(Reading &out)
+{
+    if (!select())
+        return false;
+    bus_.write(CMD_READ_SCRATCH);
+
+    uint8_t data[9];
+    bus_.read_bytes(data, sizeof(data));
+    if (OneWire::crc8(data, 8) != data[8])
+        return false;
+
+    // An all-zero scratchpad passes the CRC too; the config byte has fixed
+    // bits (0xx11111) that a floating bus does not produce
+    if ((data[4] & 0x9F) != 0x1F)
+        return false;
+
+    // Use the resolution the chip reports; it falls back to its EEPROM
+    // setting after a brown-out
+    const uint8_t bits = static_cast<uint8_t>(9 + ((data[4] >> 5) & 0x3));
+    int16_t raw = static_cast<int16_t>((data[1] << 8) | data[0]);
+    // Low bits are undefined below 12-bit resolution
+    raw = static_cast<int16_t>(raw & ~((1 << (12 - bits)) - 1));
+
+    // 1/16 °C -> centi-°C, rounded half away from zero
+    int32_t v = static_cast<int32_t>(raw) * 100;
+    out.centiC = (v >= 0) ? (v + 8) / 16 : -((-v + 8) / 16);
+    out.pressurePa = 0;
+    return true;
+}
@@ -0,0 +1,299 @@
+#include "io/MqttLink.h"
+#include <WiFi.h>
+
+namespace
+{
+// Service interval of the socket; incoming pushes and RPC replies wait at
+// most this long
+constexpr uint32_t LOOP_DELAY_MS = 20;
+constexpr uint16_t KEEPALIVE_S = 30;
+
+bool topicIs(const char *topic, const String &prefix, const char *suffix)
+{
+    const size_t n = prefix.length();
+    return strncmp(topic, prefix.c_str(), n) == 0 && strcmp(topic + n, suffix) == 0;
+}
+} // namespace
+
+MqttLink::MqttLink(const char *host, uint16_t port, const char *clientId, const char *topicRoot)
+    : host_(host),
+      port_(port),
+      clientId_(clientId),
+      topicRoot_(topicRoot)
+{
+    availabilityTopic_ = topicRoot_ + "/availability";
+    replyTopic_ = clientId_ + "/rpc";
+    mutex_ = xSemaphoreCreateMutex();
+    rpcMutex_ = xSemaphoreCreateMutex();
+    rpcDone_ = xSemaphoreCreateBinary();
+
+    client_.setClient(net_);
+    client_.setServer(host_.c_str(), port_);
+    client_.setBufferSize(BUFFER_SIZE);
+    client_.setKeepAlive(KEEPALIVE_S);
+    client_.setCallback([this](char *topic, uint8_t *payload, unsigned int len)
+                        { onMessage(topic, payload, len); });
+}
+
+void MqttLink::setCredentials(const char *user, const char *password)
+{
+    user_ = user;
+    password_ = password;
+}
+
+bool MqttLink::attachShelly(ShellyHandler &shelly, const char *topicPrefix)
+{
+    if (routeCount_ >= MAX_SHELLYS || handle_ != nullptr)
+    {
+        Serial.printf("⚠️ [MQTT] Cannot attach Shelly %s\n", topicPrefix);
+        return false;
+    }
+    ShellyRoute &route = routes_[routeCount_++];
+    route.link = this;
+    route.shelly = &shelly;
+    route.prefix = topicPrefix;
+    shelly.setRpcTransport(&route);
+    return true;
+}
+
+bool MqttLink::addTelemetry(const char *subtopic, TelemetryFn fn)
+{
+    if (telemetryCount_ >= MAX_TELEMETRY || handle_ != nullptr)
+        return false;
+    Telemetry &t = telemetry_[telemetryCount_++];
+    t.topic = topicRoot_ + "/" + subtopic;
+    t.fn = fn;
+    return true;
+}
+
+void MqttLink::start(uint32_t stackSize, UBaseType_t priority)
+{
+    if (handle_ != nullptr)
+    {
+        Serial.println("[MQTT] Warning: task already running");
+        return;
+    }
+    xTaskCreate(
+        &MqttLink::taskEntry,
+        "MqttTask",
+        stackSize,
+        this,
+        priority,
+        &handle_);
+
+    Serial.printf("[MQTT] Started, broker %s:%u\n", host_.c_str(), port_);
+}
+
+void MqttLink::taskEntry(void *pvParameters)
+{
+    auto *self = static_cast<MqttLink *>(pvParameters);
+    self->run();
+    // never returns
+}
+
+void MqttLink::run()
+{
+    for (;;)
+    {
+        if (WiFi.status() == WL_CONNECTED)
+        {
+            xSemaphoreTake(mutex_, portMAX_DELAY);
+            const bool up = client_.connected();
+            if (up)
+                client_.loop(); // dispatches onMessage()
+            xSemaphoreGive(mutex_);
+
+            if (!up && connected_)
+            {
+                connected_ = false;
+                nextAttemptMs_ = millis();
+                Serial.println("[MQTT] Connection lost; Shelly falls back to HTTP");
+                for (size_t i = 0; i < routeCount_; ++i)
+                    routes_[i].shelly->requestRefresh();
+            }
+            if (!up && (int32_t)(millis() - nextAttemptMs_) >= 0)
+                connect();
+        }
+        else if (connected_)
+        {
+            connected_ = false;
+        }
+
+        if (connected_)
+        {
+            const uint32_t sinceLast = millis() - lastTelemetryMs_;
+            if (sinceLast >= TELEMETRY_INTERVAL_MS ||
+                (telemetryRequested_ && sinceLast >= TELEMETRY_MIN_GAP_MS))
+                publishTelemetry();
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(LOOP_DELAY_MS));
+    }
+}
+
+bool MqttLink::connect()
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const char *user = user_.length() ? user_.c_str() : nullptr;
+    const char *password = password_.length() ? password_.c_str() : nullptr;
+    bool ok = client_.connect(clientId_.c_str(), user, password,
+                              availabilityTopic_.c_str(), 1, true, "offline");
+    if (ok)
+    {
+        client_.publish(availabilityTopic_.c_str(), "online", true);
+        ok = client_.subscribe(replyTopic_.c_str());
+        for (size_t i = 0; i < routeCount_ && ok; ++i)
+        {
+            const ShellyRoute &r = routes_[i];
+            ok = client_.subscribe((r.prefix + "/events/rpc").c_str()) &&
+                 client_.subscribe((r.prefix + "/status/switch:" + r.shelly->switchId()).c_str());
+        }
+        if (!ok)
+            client_.disconnect();
+    }
+    const int state = client_.state();
+    xSemaphoreGive(mutex_);
+
+    if (!ok)
+    {
+        nextAttemptMs_ = millis() + backoffMs_;
+        Serial.printf("[MQTT] Connect to %s:%u failed (state %d), retry in %u ms\n",
+                      host_.c_str(), port_, state, static_cast<unsigned>(backoffMs_));
+        backoffMs_ = (backoffMs_ * 2 > RECONNECT_MAX_MS) ? RECONNECT_MAX_MS : backoffMs_ * 2;
+        return false;
+    }
+
+    backoffMs_ = RECONNECT_MIN_MS;
+    ++connects_;
+    connected_ = true;
+    Serial.printf("[MQTT] Connected to %s:%u as %s\n", host_.c_str(), port_, clientId_.c_str());
+
+    // Read the relays once over the new channel; later changes are pushed
+    for (size_t i = 0; i < routeCount_; ++i)
+        routes_[i].shelly->requestRefresh();
+    publishTelemetry();
+    return true;
+}
+
+void MqttLink::publishTelemetry()
+{
+    telemetryRequested_ = false;
+    lastTelemetryMs_ = millis();
+    for (size_t i = 0; i < telemetryCount_; ++i)
+    {
+        JsonDocument doc;
+        telemetry_[i].fn(doc);
+        String payload;
+        serializeJson(doc, payload);
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        if (client_.publish(telemetry_[i].topic.c_str(), payload.c_str(), true))
+            ++publishes_;
+        xSemaphoreGive(mutex_);
+    }
+}
+
+bool MqttLink::rpc(const String &prefix, const char *method, const String &params, JsonDocument *result)
+{
+    if (!connected_)
+        return false;
+
+    xSemaphoreTake(rpcMutex_, portMAX_DELAY);
+    xSemaphoreTake(rpcDone_, 0); // drop a reply that arrived after its timeout
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const uint32_t id = nextRpcId_++;
+    pendingId_ = id;
+    pendingResult_ = result;
+    pendingOk_ = false;
+    String frame = String("{\"id\":") + id + ",\"src\":\"" + clientId_ + "\",\"method\":\"" + method +
+                   "\",\"params\":" + params + "}";
+    const bool sent = client_.publish((prefix + "/rpc").c_str(), frame.c_str());
+    xSemaphoreGive(mutex_);
+    ++rpcs_;
+
+    bool ok = false;
+    if (sent && xSemaphoreTake(rpcDone_, pdMS_TO_TICKS(RPC_TIMEOUT_MS)) == pdTRUE)
+        ok = pendingOk_;
+    else if (sent)
+    {
+        ++rpcTimeouts_;
+        Serial.printf("[MQTT] %s to %s timed out\n", method, prefix.c_str());
+    }
+
+    // The reply handler runs under mutex_, so after this it can no longer
+    // touch the caller's result document
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    pendingId_ = 0;
+    pendingResult_ = nullptr;
+    xSemaphoreGive(mutex_);
+
+    xSemaphoreGive(rpcMutex_);
+    return ok;
+}
+
+void MqttLink::onMessage(char *topic, uint8_t *payload, unsigned int len)
+{
+    if (replyTopic_ == topic)
+    {
+        onRpcReply(payload, len);
+        return;
+    }
+    for (size_t i = 0; i < routeCount_; ++i)
+    {
+        ShellyRoute &route = routes_[i];
+        if (topicIs(topic, route.prefix, "/events/rpc"))
+            onShellyEvent(route, payload, len);
+        else if (strncmp(topic, route.prefix.c_str(), route.prefix.length()) == 0 &&
+                 strncmp(topic + route.prefix.length(), "/status/switch:", 15) == 0 &&
+                 atoi(topic + route.prefix.length() + 15) == route.shelly->switchId())
+            onShellyStatus(route, payload, len);
+    }
+}
+
+void MqttLink::onRpcReply(const uint8_t *payload, unsigned int len)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, len))
+        return;
+    if (pendingId_ == 0 || (doc["id"] | 0U) != pendingId_)
+        return; // late reply to a call that already timed out
+
+    pendingOk_ = doc["error"].isNull();
+    if (!pendingOk_)
+        Serial.printf("[MQTT] RPC error %d: %s\n", doc["error"]["code"] | 0,
+                      doc["error"]["message"] | "");
+    else if (pendingResult_)
+        pendingResult_->set(doc["result"]);
+    pendingId_ = 0;
+    xSemaphoreGive(rpcDone_);
+}
+
+void MqttLink::onShellyEvent(ShellyRoute &route, const uint8_t *payload, unsigned int len)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, len))
+        return;
+
+    const char *method = doc["method"] | "";
+    if (strcmp(method, "NotifyStatus") != 0 && strcmp(method, "NotifyFullStatus") != 0)
+        return;
+
+    // Partial updates only carry the fields that changed
+    char key[12];
+    snprintf(key, sizeof(key), "switch:%u", route.shelly->switchId());
+    JsonVariant output = doc["params"][key]["output"];
+    if (output.is<bool>())
+        route.shelly->pushStatus(output.as<bool>());
+}
+
+void MqttLink::onShellyStatus(ShellyRoute &route, const uint8_t *payload, unsigned int len)
+{
+    // Full Switch.GetStatus object, metering included
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, len))
+        return;
+    ShellyStatus status;
+    if (ShellyHandler::parseStatus(doc.as<JsonVariantConst>(), status))
+        route.shelly->pushStatus(status);
+}
@@ -0,0 +1,154 @@
+#include "io/SampleFilter.h"
+
+namespace
+{
+constexpr int32_t Q16_ONE = 65536;
+
+int32_t absDiff(int32_t a, int32_t b) { return (a > b) ? (a - b) : (b - a); }
+
+// Running variance update: var += (x - var) * pct / 100
+uint32_t blendVariance(uint32_t var, uint32_t sample, uint8_t pct)
+{
+    int64_t delta = static_cast<int64_t>(sample) - static_cast<int64_t>(var);
+    return static_cast<uint32_t>(static_cast<int64_t>(var) + (delta * pct) / 100);
+}
+} // namespace
+
+SampleFilter::SampleFilter()
+{
+}
+
+void SampleFilter::configure(const Settings &settings)
+{
+    settings_ = settings;
+    if (settings_.medianN < 1)
+        settings_.medianN = 1;
+    if (settings_.medianN > MAX_MEDIAN_N)
+        settings_.medianN = MAX_MEDIAN_N;
+    if (settings_.emaAlphaPct < 1)
+        settings_.emaAlphaPct = 1;
+    if (settings_.emaAlphaPct > 100)
+        settings_.emaAlphaPct = 100;
+    if (settings_.kalmanR == 0)
+        settings_.kalmanR = 1;
+    reset();
+}
+
+void SampleFilter::reset()
+{
+    seeded_ = false;
+    consecutiveRejects_ = 0;
+    windowHead_ = 0;
+    windowCount_ = 0;
+}
+
+void SampleFilter::seed(int32_t rawCentiC)
+{
+    estimate_ = rawCentiC;
+    emaQ8_ = rawCentiC * 256;
+    variance_ = settings_.kalmanR;
+    window_[0] = rawCentiC;
+    windowHead_ = static_cast<uint8_t>(1 % settings_.medianN);
+    windowCount_ = 1;
+    consecutiveRejects_ = 0;
+    seeded_ = true;
+}
+
+bool SampleFilter::process(int32_t rawCentiC, int32_t &filteredCentiC)
+{
+    if (!seeded_)
+    {
+        seed(rawCentiC);
+        ++accepted_;
+        filteredCentiC = estimate_;
+        return true;
+    }
+
+    const int32_t innovation = rawCentiC - estimate_;
+
+    if (settings_.gateCentiC != 0 && absDiff(rawCentiC, estimate_) > settings_.gateCentiC)
+    {
+        ++rejected_;
+        if (++consecutiveRejects_ >= MAX_CONSECUTIVE_REJECTS)
+        {
+            // Persistent disagreement: the level really moved, follow it
+            seed(rawCentiC);
+            ++reseeds_;
+            filteredCentiC = estimate_;
+            return true;
+        }
+        filteredCentiC = estimate_;
+        return false;
+    }
+
+    consecutiveRejects_ = 0;
+    ++accepted_;
+
+    const uint32_t innovSq = static_cast<uint32_t>(static_cast<int64_t>(innovation) * innovation);
+
+    switch (settings_.mode)
+    {
+    case Mode::None:
+        estimate_ = rawCentiC;
+        variance_ = blendVariance(variance_, innovSq, 10);
+        break;
+
+    case Mode::Median:
+        window_[windowHead_] = rawCentiC;
+        windowHead_ = static_cast<uint8_t>((windowHead_ + 1) % settings_.medianN);
+        if (windowCount_ < settings_.medianN)
+            ++windowCount_;
+        estimate_ = median();
+        variance_ = blendVariance(variance_, innovSq, 10);
+        break;
+
+    case Mode::Ema:
+        emaQ8_ += ((rawCentiC * 256 - emaQ8_) * settings_.emaAlphaPct) / 100;
+        estimate_ = (emaQ8_ >= 0) ? ((emaQ8_ + 128) >> 8) : -((-emaQ8_ + 128) >> 8);
+        variance_ = blendVariance(variance_, innovSq, settings_.emaAlphaPct);
+        break;
+
+    case Mode::Kalman:
+    {
+        // Predict (random walk), then correct with gain K = P / (P + R) in Q16
+        uint32_t p = variance_ + settings_.kalmanQ;
+        int64_t k = (static_cast<int64_t>(p) * Q16_ONE) / (p + settings_.kalmanR);
+        estimate_ += static_cast<int32_t>((k * innovation) / Q16_ONE);
+        variance_ = static_cast<uint32_t>(((Q16_ONE - k) * p) / Q16_ONE);
+        break;
+    }
+    }
+
+    filteredCentiC = estimate_;
+    return true;
+}
+
+int32_t SampleFilter::median() const
+{
+    int32_t sorted[MAX_MEDIAN_N];
+    for (uint8_t i = 0; i < windowCount_; ++i)
+    {
+        // Insertion sort; N is tiny
+        int32_t v = window_[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = v;
+    }
+    return sorted[windowCount_ / 2];
+}
+
+SampleFilter::Stats SampleFilter::stats() const
+{
+    Stats s{};
+    s.mode = settings_.mode;
+    s.estimateCentiC = estimate_;
+    s.varianceCenti2 = variance_;
+    s.accepted = accepted_;
+    s.rejected = rejected_;
+    s.reseeds = reseeds_;
+    return s;
+}
@@ -0,0 +1,172 @@
+#include "io/ShellyEvents.h"
+#include <ArduinoJson.h>
+
+ShellyEvents::ShellyEvents(AsyncWebServer &server, ShellyHandler &shelly)
+    : ws_("/shelly/ws"),
+      server_(server)
+{
+  addDevice(shelly);
+}
+
+bool ShellyEvents::addDevice(ShellyHandler &shelly)
+{
+  if (deviceCount_ >= MAX_DEVICES)
+  {
+    Serial.printf("⚠️ [ShellyWS] Too many devices, ignoring %s#%u\n",
+                  shelly.ip().c_str(), shelly.switchId());
+    return false;
+  }
+  devices_[deviceCount_++].shelly = &shelly;
+  return true;
+}
+
+void ShellyEvents::begin()
+{
+  server_.on(ShellyHandler::EVENT_PATH, HTTP_GET,
+             [this](AsyncWebServerRequest *request)
+             { handleWebhook(request); });
+
+  ws_.onEvent([this](AsyncWebSocket *server,
+                     AsyncWebSocketClient *client,
+                     AwsEventType type,
+                     void *arg,
+                     uint8_t *data,
+                     size_t len)
+              { this->onEvent(server, client, type, arg, data, len); });
+  server_.addHandler(&ws_);
+}
+
+bool ShellyEvents::knownIp(const String &ip) const
+{
+  for (size_t i = 0; i < deviceCount_; ++i)
+  {
+    if (devices_[i].shelly->ip() == ip)
+      return true;
+  }
+  return false;
+}
+
+void ShellyEvents::setConnected(const String &ip, uint32_t clientId, bool connected)
+{
+  for (size_t i = 0; i < deviceCount_; ++i)
+  {
+    Device &d = devices_[i];
+    if (d.shelly->ip() != ip)
+      continue;
+    if (!connected && d.clientId != clientId)
+      continue; // a newer connection from the same device took over
+    d.clientId = connected ? clientId : 0;
+    d.shelly->setPushConnected(connected);
+  }
+}
+
+void ShellyEvents::handleWebhook(AsyncWebServerRequest *request)
+{
+  const String ip = request->client()->remoteIP().toString();
+  if (!knownIp(ip))
+  {
+    request->send(403, "text/plain", "Forbidden");
+    return;
+  }
+  if (!request->hasParam("output"))
+  {
+    request->send(400, "text/plain", "Missing output");
+    return;
+  }
+
+  // Hooks registered before channels were supported carry no id
+  const long id = request->hasParam("id") ? request->getParam("id")->value().toInt() : 0;
+  const bool on = request->getParam("output")->value() == "true";
+  for (size_t i = 0; i < deviceCount_; ++i)
+  {
+    ShellyHandler *shelly = devices_[i].shelly;
+    if (shelly->ip() == ip && shelly->switchId() == id)
+    {
+      shelly->pushStatus(on);
+      request->send(200, "text/plain", "OK");
+      return;
+    }
+  }
+  request->send(404, "text/plain", "Unknown switch");
+}
+
+void ShellyEvents::onEvent(AsyncWebSocket *server,
+                           AsyncWebSocketClient *client,
+                           AwsEventType type,
+                           void *arg,
+                           uint8_t *data,
+                           size_t len)
+{
+  switch (type)
+  {
+  case WS_EVT_CONNECT:
+  {
+    const String ip = client->remoteIP().toString();
+    if (!knownIp(ip))
+    {
+      client->close();
+      break;
+    }
+    Serial.printf("[ShellyWS] Shelly %s connected (client #%u)\n", ip.c_str(), client->id());
+    setConnected(ip, client->id(), true);
+    break;
+  }
+
+  case WS_EVT_DISCONNECT:
+    for (size_t i = 0; i < deviceCount_; ++i)
+    {
+      if (devices_[i].clientId == client->id())
+      {
+        const String ip = devices_[i].shelly->ip();
+        Serial.printf("[ShellyWS] Shelly %s disconnected\n", ip.c_str());
+        setConnected(ip, client->id(), false);
+        break;
+      }
+    }
+    break;
+
+  case WS_EVT_DATA:
+  {
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    // Status notifications are small; fragmented frames are not expected
+    if (!(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT))
+      break;
+    for (size_t i = 0; i < deviceCount_; ++i)
+    {
+      if (devices_[i].clientId == client->id())
+      {
+        handleNotification(devices_[i].shelly->ip(), data, len);
+        break;
+      }
+    }
+    break;
+  }
+
+  default:
+    break;
+  }
+}
+
+void ShellyEvents::handleNotification(const String &ip, const uint8_t *data, size_t len)
+{
+  JsonDocument doc;
+  if (deserializeJson(doc, data, len))
+    return;
+
+  const char *method = doc["method"] | "";
+  if (strcmp(method, "NotifyStatus") != 0 && strcmp(method, "NotifyFullStatus") != 0)
+    return; // NotifyEvent etc.
+
+  // Partial updates only carry the fields (and channels) that changed
+  for (size_t i = 0; i < deviceCount_; ++i)
+  {
+    ShellyHandler *shelly = devices_[i].shelly;
+    if (shelly->ip() != ip)
+      continue;
+    char key[12];
+    snprintf(key, sizeof(key), "switch:%u", shelly->switchId());
+    JsonVariant output = doc["params"][key]["output"];
+    if (output.is<bool>())
+      shelly->pushStatus(output.as<bool>());
+  }
+}
@@ -1,16 +1,312 @@
 #include "io/ShellyHandler.h"
 
 #include <WiFi.h>
-#include <HTTPClient.h>
+#include <ArduinoJson.h>
 
-ShellyHandler::ShellyHandler(String ipAddress)
+#include "io/BodyStream.h"
+
+namespace
+{
+constexpr const char *HOOK_ON = "carheater_on";
+constexpr const char *HOOK_OFF = "carheater_off";
+} // namespace
+
+ShellyHandler::ShellyHandler(String ipAddress, uint8_t switchId)
 {
-    // Build base URL: "http://192.168.33.1/rpc/Switch.Set?id=0&on="
     ip_ = ipAddress;
-    baseUrl_ = String("http://") + ipAddress + "/rpc/Switch.Set?id=0&on=";
-    Serial.printf("[Shelly] Initialized with base URL: %s\n", baseUrl_.c_str());
+    switchId_ = switchId;
+    baseUri_ = String("/rpc/Switch.Set?id=") + switchId_ + "&on=";
+    mutex_ = xSemaphoreCreateMutex();
+    statusMutex_ = xSemaphoreCreateMutex();
+    cmdMutex_ = xSemaphoreCreateMutex();
+
+    // Keep the socket open between requests; the Shelly honours keep-alive
+    http_.setReuse(true);
+    http_.setConnectTimeout(MAX_TIMEOUT_MS);
+    http_.setTimeout(MAX_TIMEOUT_MS);
+    Serial.printf("[Shelly] Initialized with base URL: http://%s%s\n", ip_.c_str(), baseUri_.c_str());
+}
+
+void ShellyHandler::start(uint32_t stackSize, UBaseType_t priority)
+{
+    if (handle_ != nullptr)
+    {
+        Serial.println("[Shelly] Warning: worker task already running");
+        return;
+    }
+    xTaskCreate(
+        &ShellyHandler::taskEntry,
+        "ShellyTask",
+        stackSize,
+        this,
+        priority,
+        &handle_);
+    requestRefresh(); // first status read right away, not after an interval
+
+    Serial.println("[Shelly] Started worker task");
+}
+
+void ShellyHandler::taskEntry(void *pvParameters)
+{
+    auto *self = static_cast<ShellyHandler *>(pvParameters);
+    self->run();
+    // never returns
+}
+
+void ShellyHandler::run()
+{
+    for (;;)
+    {
+        // Woken by requestSwitch()/requestRefresh(), or by the timeout for
+        // the periodic status read or the next lease renewal
+        uint32_t waitMs = refreshIntervalMs();
+        const uint32_t renewInMs = leaseRenewInMs();
+        if (renewInMs < waitMs)
+            waitMs = renewInMs;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+
+        // Let a fresh command sit for the debounce window; anything queued
+        // meanwhile replaces or cancels it in requestSwitch()
+        uint32_t holdMs = 0;
+        xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+        if (pending_.valid)
+        {
+            const uint32_t queuedFor = millis() - pending_.queuedAtMs;
+            if (queuedFor < SWITCH_DEBOUNCE_MS)
+                holdMs = SWITCH_DEBOUNCE_MS - queuedFor;
+        }
+        xSemaphoreGive(cmdMutex_);
+        if (holdMs > 0)
+            vTaskDelay(pdMS_TO_TICKS(holdMs));
+
+        PendingSwitch cmd;
+        bool refresh;
+        bool noop = false;
+        xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+        cmd = std::move(pending_);
+        pending_ = PendingSwitch{};
+        // A push may have confirmed the state while the command waited
+        if (cmd.valid && confirmedState(cmd.on))
+        {
+            noop = true;
+            ++switchSuppressed_;
+        }
+        inFlight_ = cmd.valid && !noop;
+        inFlightOn_ = cmd.on;
+        if (inFlight_)
+            ++switchSent_;
+        refresh = refreshRequested_;
+        refreshRequested_ = false;
+        xSemaphoreGive(cmdMutex_);
+
+        if (noop)
+        {
+            if (cmd.done)
+                cmd.done(Result::Suppressed);
+        }
+        else if (cmd.valid)
+        {
+            const bool ok = sendSwitchRequest(cmd.on);
+            xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+            inFlight_ = false;
+            xSemaphoreGive(cmdMutex_);
+            if (cmd.done)
+                cmd.done(ok ? Result::Ok : Result::Failed);
+            if (!ok)
+                refresh = true; // find out where the relay actually is
+        }
+
+        if (webhooksWanted_ && WiFi.status() == WL_CONNECTED)
+        {
+            String selfIp = WiFi.localIP().toString();
+            if (selfIp != webhookIp_)
+            {
+                webhooksRegistered_ = registerWebhooks(selfIp);
+                webhookIp_ = webhooksRegistered_ ? selfIp : String();
+            }
+        }
+
+        // A renewal is a Switch.Set that reports the relay state too, so it
+        // stands in for this cycle's status read
+        if (!cmd.valid && leaseRenewInMs() == 0)
+            renewLease();
+
+        // A successful switch or a push just refreshed the cache, so this
+        // is usually a no-op right after one
+        bool isOn;
+        getStatus(isOn, false, refresh ? 0 : refreshIntervalMs());
+    }
+}
+
+void ShellyHandler::pushStatus(bool isOn)
+{
+    bool known;
+    uint32_t ageMs;
+    bool wasOn;
+    known = cachedStatus(wasOn, ageMs);
+    storeOutput(isOn);
+    lastContactMs_ = millis();
+    ++pushes_;
+    if (!known || wasOn != isOn)
+        Serial.printf("[Shelly] Pushed state: %s\n", isOn ? "ON" : "OFF");
+}
+
+void ShellyHandler::pushStatus(const ShellyStatus &status)
+{
+    bool known;
+    uint32_t ageMs;
+    bool wasOn;
+    known = cachedStatus(wasOn, ageMs);
+    storeStatus(status);
+    lastContactMs_ = millis();
+    ++pushes_;
+    if (!known || wasOn != status.output)
+        Serial.printf("[Shelly] Pushed state: %s\n", status.output ? "ON" : "OFF");
+}
+
+bool ShellyHandler::registerWebhooks(const String &selfIp)
+{
+    JsonDocument filter;
+    filter["hooks"][0]["id"] = true;
+    filter["hooks"][0]["cid"] = true;
+    filter["hooks"][0]["name"] = true;
+    filter["hooks"][0]["enable"] = true;
+    filter["hooks"][0]["urls"] = true;
+
+    JsonDocument doc;
+    if (requestJson("/rpc/Webhook.List", doc, &filter) != 200)
+        return false;
+
+    const String base = String("http://") + selfIp + EVENT_PATH + "?id=" + switchId_ + "&output=";
+    const String urlOn = base + "true";
+    const String urlOff = base + "false";
+
+    bool haveOn = false;
+    bool haveOff = false;
+    for (JsonObjectConst hook : doc["hooks"].as<JsonArrayConst>())
+    {
+        const char *name = hook["name"] | "";
+        const bool isOn = strcmp(name, HOOK_ON) == 0;
+        if (!isOn && strcmp(name, HOOK_OFF) != 0)
+            continue; // somebody else's hook
+        if ((hook["cid"] | 0) != switchId_)
+            continue; // another channel's handler owns it
+
+        const char *url = hook["urls"][0] | "";
+        if ((isOn ? urlOn : urlOff) == url && (hook["enable"] | false))
+        {
+            (isOn ? haveOn : haveOff) = true;
+            continue;
+        }
+
+        // Points at an old address of ours; replace it
+        String body = String("{\"id\":") + (hook["id"] | 0) + "}";
+        request("/rpc/Webhook.Delete", body.c_str());
+    }
+
+    bool ok = true;
+    if (!haveOn)
+    {
+        String body = String("{\"cid\":") + switchId_ + ",\"enable\":true,\"event\":\"switch.on\",\"name\":\"" +
+                      HOOK_ON + "\",\"urls\":[\"" + urlOn + "\"]}";
+        ok = (request("/rpc/Webhook.Create", body.c_str()) == 200) && ok;
+    }
+    if (!haveOff)
+    {
+        String body = String("{\"cid\":") + switchId_ + ",\"enable\":true,\"event\":\"switch.off\",\"name\":\"" +
+                      HOOK_OFF + "\",\"urls\":[\"" + urlOff + "\"]}";
+        ok = (request("/rpc/Webhook.Create", body.c_str()) == 200) && ok;
+    }
+
+    Serial.printf("[Shelly] Webhooks -> %s: %s\n", base.c_str(), ok ? "registered" : "FAILED");
+    return ok;
+}
+
+bool ShellyHandler::requestSwitch(bool on, Completion done)
+{
+    if (handle_ == nullptr)
+    {
+        // No worker yet (early boot): do it inline
+        const bool ok = sendSwitchRequest(on);
+        if (done)
+            done(ok ? Result::Ok : Result::Failed);
+        return ok;
+    }
+
+    Completion replaced;
+    bool suppressed = false;
+    xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+    // Where the relay will be once nothing else is queued
+    if (on)
+        holdOn();
+    else
+        holdValid_ = false;
+
+    const bool atTarget = inFlight_ ? (inFlightOn_ == on) : confirmedState(on);
+    if (atTarget)
+    {
+        // No-op write; also cancels a queued opposite command (on/off/on)
+        if (pending_.valid)
+        {
+            replaced = std::move(pending_.done);
+            pending_ = PendingSwitch{};
+            ++switchSuperseded_;
+        }
+        suppressed = true;
+    }
+    else if (pending_.valid && pending_.on == on)
+    {
+        suppressed = true; // same command already queued
+    }
+    else
+    {
+        if (pending_.valid)
+        {
+            replaced = std::move(pending_.done);
+            ++switchSuperseded_;
+        }
+        pending_.valid = true;
+        pending_.on = on;
+        pending_.queuedAtMs = millis();
+        pending_.done = std::move(done);
+    }
+    if (suppressed)
+        ++switchSuppressed_;
+    xSemaphoreGive(cmdMutex_);
+
+    if (!suppressed)
+        xTaskNotifyGive(handle_);
+    if (replaced)
+        replaced(Result::Superseded);
+    if (suppressed && done)
+        done(Result::Suppressed);
+    return true;
+}
+
+bool ShellyHandler::confirmedState(bool on) const
+{
+    // Only trust a state recent enough that a manual press would have been
+    // seen by now; an older one gets the write anyway
+    ShellyStatus status;
+    return freshStatus(status, refreshIntervalMs()) && status.output == on;
+}
+
+void ShellyHandler::requestRefresh()
+{
+    xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+    refreshRequested_ = true;
+    xSemaphoreGive(cmdMutex_);
+    if (handle_ != nullptr)
+        xTaskNotifyGive(handle_);
 }
 
+bool ShellyHandler::switchPending() const
+{
+    xSemaphoreTake(cmdMutex_, portMAX_DELAY);
+    const bool pending = pending_.valid || inFlight_;
+    xSemaphoreGive(cmdMutex_);
+    return pending;
+}
 
 bool ShellyHandler::switchOn()
 {
@@ -25,7 +321,7 @@ bool ShellyHandler::switchOff()
 bool ShellyHandler::toggle()
 {
     bool isOn;
-    if (!getStatus(isOn))
+    if (!getStatus(isOn, false))
     {
         Serial.println("[Shelly] Failed to get current status for toggle");
         return false;
@@ -33,6 +329,340 @@ bool ShellyHandler::toggle()
     return sendSwitchRequest(!isOn);
 }
 
+void ShellyHandler::closeConnection()
+{
+    http_.end();
+    client_.stop();
+}
+
+int ShellyHandler::requestOnce(const String &uri, const char *postBody, const BodySink &sink)
+{
+    if (!client_.connected())
+        ++connects_;
+    ++requests_;
+
+    // begin() keeps the existing socket when it is still connected
+    if (!http_.begin(client_, ip_, PORT, uri))
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    if (postBody != nullptr)
+        http_.addHeader("Content-Type", "application/json");
+
+    int code = (postBody != nullptr) ? http_.POST(postBody) : http_.GET();
+    const int length = (code > 0) ? http_.getSize() : -1;
+    if (code > 0 && sink.json != nullptr && length >= 0)
+    {
+        // Parse straight off the socket; no copy of the body is made
+        BodyStream body(client_, static_cast<size_t>(length));
+        body.setTimeout(currentTimeoutMs());
+        DeserializationError err = (sink.filter != nullptr)
+                                       ? deserializeJson(*sink.json, body, DeserializationOption::Filter(*sink.filter))
+                                       : deserializeJson(*sink.json, body);
+        body.drain(currentTimeoutMs());
+        if (err || !body.complete())
+            code = PARSE_ERROR;
+    }
+    else if (code > 0)
+    {
+        // Drain the body even if nobody wants it, or it would be read as
+        // the start of the next response on this socket. Chunked replies
+        // (no Content-Length) also land here.
+        String text = http_.getString();
+        if (sink.json != nullptr)
+        {
+            DeserializationError err = (sink.filter != nullptr)
+                                           ? deserializeJson(*sink.json, text, DeserializationOption::Filter(*sink.filter))
+                                           : deserializeJson(*sink.json, text);
+            if (err)
+                code = PARSE_ERROR;
+        }
+        else if (sink.text != nullptr)
+            *sink.text = text;
+    }
+    http_.end(); // keeps the socket open when reuse is possible
+    if (code > 0)
+        lastContactMs_ = millis();
+    return code;
+}
+
+void ShellyHandler::storeStatus(const ShellyStatus &status)
+{
+    portENTER_CRITICAL(&cacheMux_);
+    cached_ = status;
+    cachedAtMs_ = millis();
+    cacheValid_ = true;
+    portEXIT_CRITICAL(&cacheMux_);
+}
+
+void ShellyHandler::storeOutput(bool isOn)
+{
+    // Metering fields keep their last reading until the next full status
+    portENTER_CRITICAL(&cacheMux_);
+    cached_.output = isOn;
+    cachedAtMs_ = millis();
+    cacheValid_ = true;
+    portEXIT_CRITICAL(&cacheMux_);
+}
+
+bool ShellyHandler::freshStatus(ShellyStatus &status, uint32_t maxAgeMs) const
+{
+    bool fresh = false;
+    portENTER_CRITICAL(&cacheMux_);
+    if (cacheValid_ && (millis() - cachedAtMs_) <= maxAgeMs)
+    {
+        status = cached_;
+        fresh = true;
+    }
+    portEXIT_CRITICAL(&cacheMux_);
+    return fresh;
+}
+
+bool ShellyHandler::cachedStatus(ShellyStatus &status, uint32_t &ageMs) const
+{
+    portENTER_CRITICAL(&cacheMux_);
+    const bool valid = cacheValid_;
+    status = cached_;
+    ageMs = millis() - cachedAtMs_;
+    portEXIT_CRITICAL(&cacheMux_);
+    return valid;
+}
+
+bool ShellyHandler::cachedStatus(bool &isOn, uint32_t &ageMs) const
+{
+    ShellyStatus status;
+    const bool valid = cachedStatus(status, ageMs);
+    isOn = status.output;
+    return valid;
+}
+
+int ShellyHandler::request(const String &uri, const char *postBody, String *payload)
+{
+    BodySink sink;
+    sink.text = payload;
+    return requestSink(uri, postBody, sink);
+}
+
+int ShellyHandler::requestJson(const String &uri, JsonDocument &doc, const JsonDocument *filter)
+{
+    BodySink sink;
+    sink.json = &doc;
+    sink.filter = filter;
+    return requestSink(uri, nullptr, sink);
+}
+
+int ShellyHandler::requestSink(const String &uri, const char *postBody, const BodySink &sink)
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    if (!breakerAllows(millis()))
+    {
+        xSemaphoreGive(mutex_);
+        return BREAKER_OPEN;
+    }
+
+    const uint32_t timeoutMs = currentTimeoutMs();
+    http_.setConnectTimeout(static_cast<int32_t>(timeoutMs));
+    http_.setTimeout(static_cast<uint16_t>(timeoutMs));
+
+    const bool reused = client_.connected();
+    uint32_t startMs = millis();
+    int code = requestOnce(uri, postBody, sink);
+    if (code <= 0)
+    {
+        // Drop the socket either way so the next call starts clean
+        closeConnection();
+        // A reused socket may have been closed by the Shelly while idle;
+        // one retry on a fresh connection covers that, as long as sending
+        // the request twice cannot do harm
+        if (reused && safeToRetry(postBody, code))
+        {
+            startMs = millis();
+            code = requestOnce(uri, postBody, sink);
+        }
+        if (code <= 0)
+            closeConnection();
+    }
+
+    // A garbled body still proves the Shelly is there
+    const bool reachable = (code > 0 || code == PARSE_ERROR);
+    if (code > 0)
+        observeRtt(millis() - startMs);
+    else if (!reachable)
+        backOffTimeout();
+    breakerRecord(reachable, millis());
+
+    xSemaphoreGive(mutex_);
+    return code;
+}
+
+bool ShellyHandler::safeToRetry(const char *postBody, int code)
+{
+    // GETs only read or set absolute state (Switch.Set), so repeating one
+    // is harmless even if the Shelly already acted on it
+    if (postBody == nullptr)
+        return true;
+    // A POST may create a duplicate webhook or a second reboot, unless it
+    // never left: a lost connection or a read timeout can come after the
+    // Shelly has already handled it
+    return code == HTTPC_ERROR_CONNECTION_REFUSED || code == HTTPC_ERROR_SEND_HEADER_FAILED ||
+           code == HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+}
+
+bool ShellyHandler::breakerAllows(uint32_t nowMs)
+{
+    bool allowed = true;
+    portENTER_CRITICAL(&breakerMux_);
+    if (breaker_ == BreakerState::Open)
+    {
+        if ((nowMs - openedAtMs_) >= cooldownMs_)
+            breaker_ = BreakerState::HalfOpen; // this request is the probe
+        else
+        {
+            ++fastFails_;
+            allowed = false;
+        }
+    }
+    portEXIT_CRITICAL(&breakerMux_);
+    return allowed;
+}
+
+void ShellyHandler::breakerRecord(bool reachable, uint32_t nowMs)
+{
+    BreakerState before;
+    BreakerState after;
+    portENTER_CRITICAL(&breakerMux_);
+    before = breaker_;
+    if (reachable)
+    {
+        consecutiveFailures_ = 0;
+        cooldownMs_ = BREAKER_MIN_COOLDOWN_MS;
+        breaker_ = BreakerState::Closed;
+    }
+    else
+    {
+        if (consecutiveFailures_ < UINT8_MAX)
+            ++consecutiveFailures_;
+        if (breaker_ == BreakerState::HalfOpen)
+        {
+            // Probe failed: back off further
+            cooldownMs_ = (cooldownMs_ * 2 > BREAKER_MAX_COOLDOWN_MS) ? BREAKER_MAX_COOLDOWN_MS : cooldownMs_ * 2;
+            breaker_ = BreakerState::Open;
+            openedAtMs_ = nowMs;
+            ++trips_;
+        }
+        else if (breaker_ == BreakerState::Closed && consecutiveFailures_ >= BREAKER_FAILURE_THRESHOLD)
+        {
+            breaker_ = BreakerState::Open;
+            openedAtMs_ = nowMs;
+            ++trips_;
+        }
+    }
+    after = breaker_;
+    const uint32_t cooldown = cooldownMs_;
+    portEXIT_CRITICAL(&breakerMux_);
+
+    if (after == BreakerState::Open && before != BreakerState::Open)
+        Serial.printf("[Shelly] Breaker open, retry in %lu ms\n", static_cast<unsigned long>(cooldown));
+    else if (after == BreakerState::Closed && before != BreakerState::Closed)
+        Serial.println("[Shelly] Breaker closed, Shelly reachable again");
+}
+
+void ShellyHandler::observeRtt(uint32_t rttMs)
+{
+    portENTER_CRITICAL(&breakerMux_);
+    if (srttMs_ == 0)
+    {
+        srttMs_ = rttMs > 0 ? rttMs : 1;
+        rttVarMs_ = rttMs / 2;
+    }
+    else
+    {
+        // RFC 6298: rttvar += (|srtt - rtt| - rttvar) / 4, srtt += (rtt - srtt) / 8
+        const int32_t err = static_cast<int32_t>(rttMs) - static_cast<int32_t>(srttMs_);
+        const int32_t absErr = err < 0 ? -err : err;
+        rttVarMs_ = static_cast<uint32_t>(static_cast<int32_t>(rttVarMs_) + (absErr - static_cast<int32_t>(rttVarMs_)) / 4);
+        srttMs_ = static_cast<uint32_t>(static_cast<int32_t>(srttMs_) + err / 8);
+        if (srttMs_ == 0)
+            srttMs_ = 1;
+    }
+    timeoutBackoff_ = 0;
+    portEXIT_CRITICAL(&breakerMux_);
+}
+
+void ShellyHandler::backOffTimeout()
+{
+    // No RTT sample from a failed request, so without this a timeout
+    // settled at the floor could never grow to fit a slower reply
+    portENTER_CRITICAL(&breakerMux_);
+    if ((MIN_TIMEOUT_MS << timeoutBackoff_) < MAX_TIMEOUT_MS)
+        ++timeoutBackoff_;
+    portEXIT_CRITICAL(&breakerMux_);
+}
+
+uint32_t ShellyHandler::currentTimeoutMs() const
+{
+    portENTER_CRITICAL(&breakerMux_);
+    const uint32_t srtt = srttMs_;
+    const uint32_t var = rttVarMs_;
+    const uint8_t backoff = timeoutBackoff_;
+    portEXIT_CRITICAL(&breakerMux_);
+
+    if (srtt == 0)
+        return MAX_TIMEOUT_MS; // nothing measured yet
+    uint32_t t = srtt + 4 * var;
+    if (t < MIN_TIMEOUT_MS)
+        t = MIN_TIMEOUT_MS;
+    t <<= backoff;
+    if (t > MAX_TIMEOUT_MS)
+        t = MAX_TIMEOUT_MS;
+    return t;
+}
+
+ShellyHandler::BreakerStats ShellyHandler::breakerStats() const
+{
+    BreakerStats st{};
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&breakerMux_);
+    st.state = breaker_;
+    st.consecutiveFailures = consecutiveFailures_;
+    st.trips = trips_;
+    st.fastFails = fastFails_;
+    if (breaker_ == BreakerState::Open)
+    {
+        const uint32_t elapsed = now - openedAtMs_;
+        st.retryInMs = (elapsed < cooldownMs_) ? (cooldownMs_ - elapsed) : 0;
+    }
+    st.srttMs = srttMs_;
+    st.rttVarMs = rttVarMs_;
+    st.timeoutBackoff = timeoutBackoff_;
+    portEXIT_CRITICAL(&breakerMux_);
+    st.timeoutMs = currentTimeoutMs();
+    return st;
+}
+
+const char *ShellyHandler::breakerStateName(BreakerState state)
+{
+    switch (state)
+    {
+    case BreakerState::Closed:
+        return "closed";
+    case BreakerState::Open:
+        return "open";
+    case BreakerState::HalfOpen:
+        return "half_open";
+    default:
+        return "unknown";
+    }
+}
+
+String ShellyHandler::errorString(int code)
+{
+    if (code == PARSE_ERROR)
+        return "response parse error";
+    if (code == BREAKER_OPEN)
+        return "circuit breaker open";
+    return HTTPClient::errorToString(code);
+}
+
 bool ShellyHandler::sendSwitchRequest(bool on)
 {
     if (WiFi.status() != WL_CONNECTED)
@@ -41,20 +671,39 @@ bool ShellyHandler::sendSwitchRequest(bool on)
         return false;
     }
 
-    String url = baseUrl_ + (on ? "true" : "false");
-    Serial.print("[Shelly] Request: ");
-    Serial.println(url);
+    const uint32_t leaseS = on ? onLeaseS_ : 0;
 
-    HTTPClient http;
-    http.begin(url);
+    if (transport_ && transport_->connected())
+    {
+        String params = String("{\"id\":") + switchId_ + ",\"on\":" + (on ? "true" : "false");
+        if (leaseS > 0)
+            params += String(",\"toggle_after\":") + leaseS;
+        params += "}";
+        if (transport_->call("Switch.Set", params, nullptr))
+        {
+            lastContactMs_ = millis();
+            storeOutput(on);
+            leaseActive_ = leaseS > 0;
+            leaseSentAtMs_ = millis();
+            leaseSentS_ = leaseS;
+            return true;
+        }
+        Serial.println("[Shelly] Switch.Set over RPC transport failed, trying HTTP");
+    }
 
-    int httpCode = http.GET();
+    String uri = baseUri_ + (on ? "true" : "false");
+    if (leaseS > 0)
+        uri += String("&toggle_after=") + leaseS;
+    Serial.print("[Shelly] Request: ");
+    Serial.println(uri);
+
+    String payload;
+    int httpCode = request(uri, nullptr, &payload);
 
     if (httpCode <= 0)
     {
         Serial.print("[Shelly] HTTP GET failed: ");
-        Serial.println(http.errorToString(httpCode));
-        http.end();
+        Serial.println(errorString(httpCode));
         return false;
     }
 
@@ -62,40 +711,154 @@ bool ShellyHandler::sendSwitchRequest(bool on)
     Serial.println(httpCode);
 
     // Optional: read response body for debugging
-    String payload = http.getString();
     Serial.print("[Shelly] Response: ");
     Serial.println(payload);
 
-    http.end();
-
     // Treat any 2xx as success
-    return (httpCode >= 200 && httpCode < 300);
+    if (httpCode < 200 || httpCode >= 300)
+        return false;
+
+    // The relay now is what we asked for; no need to read it back
+    storeOutput(on);
+    leaseActive_ = leaseS > 0;
+    leaseSentAtMs_ = millis();
+    leaseSentS_ = leaseS;
+    return true;
+}
+
+void ShellyHandler::fitLeaseToCadence(float periodS)
+{
+    uint32_t leaseS = DEFAULT_ON_LEASE_S;
+    const float wantedS = periodS * LEASE_CADENCE_FACTOR;
+    if (wantedS > leaseS)
+        leaseS = static_cast<uint32_t>(ceilf(wantedS));
+    onLeaseS_ = leaseS;
+}
+
+uint32_t ShellyHandler::leaseRenewInMs() const
+{
+    if (onLeaseS_ == 0)
+        return UINT32_MAX;
+    if (!leaseActive_)
+    {
+        // Relay found on without our lease (button press, an ON that was
+        // suppressed as redundant): arm one
+        bool relayOn;
+        uint32_t ageMs;
+        return (holdValid_ && cachedStatus(relayOn, ageMs) && relayOn) ? 0 : UINT32_MAX;
+    }
+    // Renew on the schedule of the lease actually running on the Shelly;
+    // the renewal then carries the current length
+    const uint32_t halfMs = leaseSentS_ * 500UL;
+    const uint32_t elapsed = millis() - leaseSentAtMs_;
+    return (elapsed >= halfMs) ? 0 : halfMs - elapsed;
+}
+
+void ShellyHandler::renewLease()
+{
+    bool relayOn;
+    uint32_t ageMs;
+    if (!cachedStatus(relayOn, ageMs) || !relayOn)
+    {
+        // Switched off meanwhile (lease ran out, button, other client)
+        leaseActive_ = false;
+        return;
+    }
+    if (!holdValid_ || (millis() - holdAtMs_) >= onLeaseS_ * 1000UL)
+    {
+        // Nobody has asked for heat for a whole lease: let the Shelly
+        // switch off on its own
+        Serial.println("[Shelly] ON not held by a control loop; letting the lease run out");
+        leaseActive_ = false;
+        holdValid_ = false;
+        return;
+    }
+    if (sendSwitchRequest(true))
+    {
+        ++leaseRenewals_;
+    }
+    else
+    {
+        // Retry a quarter lease later
+        leaseActive_ = true;
+        leaseSentAtMs_ = millis() - leaseSentS_ * 250UL;
+    }
 }
 
-bool ShellyHandler::getStatus(bool &isOn, bool verbose)
+bool ShellyHandler::getStatus(bool &isOn, bool verbose, uint32_t maxAgeMs)
 {
+    ShellyStatus status;
+    if (!getStatus(status, verbose, maxAgeMs))
+        return false;
+    isOn = status.output;
+    return true;
+}
+
+bool ShellyHandler::getStatus(ShellyStatus &status, bool verbose, uint32_t maxAgeMs)
+{
+    if (freshStatus(status, maxAgeMs))
+    {
+        ++cacheHits_;
+        return true;
+    }
+
     if (WiFi.status() != WL_CONNECTED)
     {
         Serial.println("[Shelly] WiFi not connected, cannot query status");
         return false;
     }
 
-    // For Gen3: /rpc/Switch.GetStatus?id=0
-    String url = String("http://") + ip_ + "/rpc/Switch.GetStatus?id=0";
+    xSemaphoreTake(statusMutex_, portMAX_DELAY);
+    // Whoever held the lock before us may just have refreshed it
+    if (freshStatus(status, maxAgeMs))
+    {
+        xSemaphoreGive(statusMutex_);
+        ++cacheHits_;
+        return true;
+    }
+    bool ok = fetchStatus(status, verbose);
+    xSemaphoreGive(statusMutex_);
+    return ok;
+}
+
+bool ShellyHandler::parseStatus(JsonVariantConst src, ShellyStatus &status)
+{
+    return parseShellyStatus(src, status);
+}
+
+bool ShellyHandler::fetchStatus(ShellyStatus &status, bool verbose)
+{
+    if (transport_ && transport_->connected())
+    {
+        JsonDocument result;
+        String params = String("{\"id\":") + switchId_ + "}";
+        if (transport_->call("Switch.GetStatus", params, &result) && parseStatus(result.as<JsonVariantConst>(), status))
+        {
+            lastContactMs_ = millis();
+            storeStatus(status);
+            return true;
+        }
+        Serial.println("[Shelly] Switch.GetStatus over RPC transport failed, trying HTTP");
+    }
+
+    // For Gen3: /rpc/Switch.GetStatus?id=<switchId>
+    String uri = String("/rpc/Switch.GetStatus?id=") + switchId_;
     if (verbose) {
         Serial.print("[Shelly] Status request: ");
-        Serial.println(url);
+        Serial.println(uri);
     }
 
-    HTTPClient http;
-    http.begin(url);
-
-    int httpCode = http.GET();
+    JsonDocument doc;
+    int httpCode = requestJson(uri, doc, &shellyStatusFilter());
+    if (httpCode == PARSE_ERROR)
+    {
+        Serial.println("[Shelly] Could not parse status response");
+        return false;
+    }
     if (httpCode <= 0)
     {
         Serial.print("[Shelly] HTTP GET failed (status): ");
-        Serial.println(http.errorToString(httpCode));
-        http.end();
+        Serial.println(errorString(httpCode));
         return false;
     }
 
@@ -106,55 +869,46 @@ bool ShellyHandler::getStatus(bool &isOn, bool verbose)
 
     if (httpCode < 200 || httpCode >= 300)
     {
-        http.end();
         return false;
     }
 
-    String payload = http.getString();
-    http.end();
-
-    if (verbose) {
-        Serial.print("[Shelly] Status response: ");
-        Serial.println(payload);
-    }
-
-    // Very simple parsing: look for output/on true/false
-    if (payload.indexOf("\"output\":true") != -1 || payload.indexOf("\"on\":true") != -1)
+    if (!parseStatus(doc.as<JsonVariantConst>(), status))
     {
-        isOn = true;
-        return true;
+        Serial.println("[Shelly] Could not parse on/off state from response");
+        return false;
     }
+    storeStatus(status);
 
-    if (payload.indexOf("\"output\":false") != -1 || payload.indexOf("\"on\":false") != -1)
-    {
-        isOn = false;
-        return true;
+    if (verbose) {
+        Serial.printf("[Shelly] Status: output=%s apower=%.1fW voltage=%.1fV temp=%.1f°C\n",
+                      status.output ? "true" : "false", status.apowerW, status.voltageV, status.temperatureC);
     }
-
-    Serial.println("[Shelly] Could not parse on/off state from response");
-    return false;
+    return true;
 }
 
 bool ShellyHandler::reboot()
 {
-    HTTPClient http;
-    String url = "http://" + ip_ + "/rpc/Shelly.Reboot";
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
+    int code = request("/rpc/Shelly.Reboot", "{}");
 
-    int code = http.POST("{}");
-    http.end();
+    // The Shelly drops every connection while it restarts, and the relay
+    // state has to be read again once it is back
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    closeConnection();
+    xSemaphoreGive(mutex_);
+    portENTER_CRITICAL(&cacheMux_);
+    cacheValid_ = false;
+    portEXIT_CRITICAL(&cacheMux_);
 
     return (code == 200);
 }
 
 bool ShellyHandler::ping() {
-    HTTPClient http;
-    String url = "http://" + ip_ + "/rpc/Shelly.GetStatus";
-
-    http.begin(url);
-    int code = http.GET();
-    http.end();
+    // Any recent answer (status poll, switch command) already proves it is up
+    if (lastContactMs_ != 0 && (millis() - lastContactMs_) < PING_FRESH_MS)
+        return true;
 
+    // Sys.GetStatus is a fraction of Shelly.GetStatus and answers the same
+    // "is it alive" question
+    int code = request("/rpc/Sys.GetStatus");
     return (code == 200);
-}
\ No newline at end of file
+}
@@ -0,0 +1,29 @@
+#include "io/ShellyStatus.h"
+
+const JsonDocument &shellyStatusFilter()
+{
+    static JsonDocument filter;
+    if (filter.isNull())
+    {
+        filter["output"] = true;
+        filter["apower"] = true;
+        filter["voltage"] = true;
+        filter["current"] = true;
+        filter["temperature"]["tC"] = true;
+        filter["aenergy"]["total"] = true;
+    }
+    return filter;
+}
+
+bool parseShellyStatus(JsonVariantConst src, ShellyStatus &status)
+{
+    if (!src["output"].is<bool>())
+        return false;
+    status.output = src["output"].as<bool>();
+    status.apowerW = src["apower"] | NAN;
+    status.voltageV = src["voltage"] | NAN;
+    status.currentA = src["current"] | NAN;
+    status.temperatureC = src["temperature"]["tC"] | NAN;
+    status.energyWh = src["aenergy"]["total"] | NAN;
+    return true;
+}
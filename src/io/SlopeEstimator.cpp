@@ -0,0 +1,100 @@
+#include "io/SlopeEstimator.h"
+
+namespace
+{
+// Rebase once the newest sample is ~1.8 h past the origin. Keeps every
+// sum comfortably inside int64 (n·Σt² stays below 2^50).
+constexpr int64_t REBASE_TICKS = 1 << 16;
+
+int16_t clampCenti(int32_t v)
+{
+    if (v < INT16_MIN)
+        return INT16_MIN;
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    return static_cast<int16_t>(v);
+}
+} // namespace
+
+SlopeEstimator::SlopeEstimator()
+{
+}
+
+void SlopeEstimator::reset()
+{
+    head_ = 0;
+    count_ = 0;
+    sumT_ = sumY_ = sumTT_ = sumTY_ = 0;
+}
+
+void SlopeEstimator::add(int32_t centiC, uint32_t timestampMs)
+{
+    if (count_ > 0 && (timestampMs - lastMs_) > MAX_GAP_MS)
+        reset();
+    if (count_ == 0)
+        originMs_ = timestampMs;
+    lastMs_ = timestampMs;
+
+    if (count_ == WINDOW)
+    {
+        // Oldest sample sits at head_ once the ring is full
+        const Point &old = points_[head_];
+        const int64_t t = ticksOf(old.ms);
+        const int64_t y = old.centiC;
+        sumT_ -= t;
+        sumY_ -= y;
+        sumTT_ -= t * t;
+        sumTY_ -= t * y;
+        --count_;
+    }
+
+    const Point p{timestampMs, clampCenti(centiC)};
+    points_[head_] = p;
+    head_ = (head_ + 1) % WINDOW;
+    ++count_;
+
+    const int64_t t = ticksOf(p.ms);
+    const int64_t y = p.centiC;
+    sumT_ += t;
+    sumY_ += y;
+    sumTT_ += t * t;
+    sumTY_ += t * y;
+
+    if (t >= REBASE_TICKS)
+        rebase();
+}
+
+void SlopeEstimator::rebase()
+{
+    // Move the origin to the oldest sample, in whole ticks so every stored
+    // sample keeps exactly the tick it was summed with, minus d.
+    const Point &oldest = points_[(head_ + WINDOW - count_) % WINDOW];
+    const int64_t d = ticksOf(oldest.ms);
+    if (d <= 0)
+        return;
+
+    const int64_t n = static_cast<int64_t>(count_);
+    // Σ(t-d)² = Σt² - 2dΣt + n·d²,  Σ(t-d)y = Σty - dΣy
+    sumTT_ += -2 * d * sumT_ + n * d * d;
+    sumTY_ -= d * sumY_;
+    sumT_ -= n * d;
+    originMs_ += static_cast<uint32_t>(d) * 100U;
+}
+
+bool SlopeEstimator::slopeMilliCPerMin(int32_t &out) const
+{
+    if (count_ < MIN_SAMPLES)
+        return false;
+
+    const int64_t n = static_cast<int64_t>(count_);
+    const int64_t den = n * sumTT_ - sumT_ * sumT_;
+    if (den <= 0)
+        return false;
+    const int64_t num = n * sumTY_ - sumT_ * sumY_;
+
+    // num/den is centi-°C per 100 ms; × 600 ticks/min × 10 milli/centi
+    const int64_t scaled = num * 6000;
+    const int64_t q = (scaled >= 0) ? (scaled + den / 2) / den : -((-scaled + den / 2) / den);
+    out = static_cast<int32_t>(q);
+    return true;
+}
@@ -111,13 +111,14 @@ void WebSocketHub::broadcastTimeSync()
   ws_.textAll(json);
 }
 
-void WebSocketHub::broadcastLogLine(const String &line)
+void WebSocketHub::broadcastLogLine(uint32_t seq, const String &line)
 {
   if (!ws_.count())
     return;
 
   JsonDocument doc;
   doc["type"] = "log_append";
+  doc["seq"] = seq;
   doc["line"] = line;
 
   String json;
@@ -129,22 +130,28 @@ void WebSocketHub::broadcastTempUpdate()
 {
   if (!ws_.count())
     return;
+  JsonDocument doc;
+  buildTempUpdate(doc);
+
+  String json;
+  serializeJson(doc, json);
+  ws_.textAll(json);
+}
+
+void WebSocketHub::buildTempUpdate(JsonDocument &doc)
+{
   String currentTime = timekeeper::isValid()
                            ? timekeeper::formatLocal()
                            : "Not set";
-  JsonDocument doc;
   doc["type"] = "temp_update";
   doc["temp"] = heaterTask_.currentTemp();
+  doc["slope_c_per_min"] = latestMeasurement().slopeCPerMin;
   doc["is_on"] = heaterTask_.isHeaterOn();
   doc["time_synced"] = timekeeper::isTrulyValid();
   doc["current_time"] = currentTime;
   doc["in_deadzone"] = heaterTask_.isInDeadzone();
   doc["dz_enabled"] = heaterTask_.isDeadzoneEnabled();
   doc["heater_task_enabled"] = heaterTask_.isEnabled();
-
-  String json;
-  serializeJson(doc, json);
-  ws_.textAll(json);
 }
 
 void WebSocketHub::broadcastReadyByUpdate()
@@ -152,7 +159,15 @@ void WebSocketHub::broadcastReadyByUpdate()
   if (!ws_.count())
     return;
   JsonDocument doc;
+  buildReadyByUpdate(doc);
+
+  String json;
+  serializeJson(doc, json);
+  ws_.textAll(json);
+}
 
+void WebSocketHub::buildReadyByUpdate(JsonDocument &doc)
+{
   doc["type"] = "ready_by_update";
 
   // If time invalid or no schedule → just "scheduled: false"
@@ -179,11 +194,12 @@ void WebSocketHub::broadcastReadyByUpdate()
       uint64_t nowUtc = timekeeper::nowUtc();
       doc["now_epoch_utc"] = nowUtc;
 
-      float ambient = takeMeasurement(false).temperature;
+      float ambient = latestTemperature();
       doc["ambient_temp_c"] = ambient;
 
       // Use same physics as ReadyBy to estimate warmup / start time
       HeatingCalculator calc;
+      calc.setHeaterPower(config_.heaterPowerW());
       float k = calibration_.derivedKFor(ambient, targetTemp);
       float warmupSec = calc.estimateWarmupSeconds(k, ambient, targetTemp);
       if (warmupSec < 0.0f)
@@ -191,6 +207,12 @@ void WebSocketHub::broadcastReadyByUpdate()
 
       doc["warmup_seconds"] = warmupSec;
 
+      float observedRate = NAN;
+      float predictedRate = NAN;
+      readyByTask_.heatingRates(observedRate, predictedRate);
+      doc["observed_rate_c_per_min"] = observedRate;
+      doc["predicted_rate_c_per_min"] = predictedRate;
+
       uint64_t warmup = static_cast<uint64_t>(warmupSec);
       uint64_t secondsLeft = (targetEpoch > nowUtc) ? (targetEpoch - nowUtc) : 0;
 
@@ -207,12 +229,8 @@ void WebSocketHub::broadcastReadyByUpdate()
       doc["start_epoch_utc"] = startEpochUtc;
     }
   }
-  doc["current_temp"] = takeMeasurement(false).temperature;
+  doc["current_temp"] = latestTemperature();
   doc["time_synced"] = timekeeper::isTrulyValid();
-
-  String json;
-  serializeJson(doc, json);
-  ws_.textAll(json);
 }
 
 void WebSocketHub::broadcastCalibrationUpdate()
@@ -232,6 +250,7 @@ void WebSocketHub::broadcastCalibrationUpdate()
   doc["current_temp_c"] = st.currentTempC;
   doc["elapsed_seconds"] = st.elapsedSeconds;
   doc["suggested_k"] = st.suggestedK;
+  doc["slope_c_per_min"] = st.slopeCPerMin;
   doc["current_k"] = config_.kFactor();
   doc["time_synced"] = timekeeper::isTrulyValid();
   doc["auto_enabled"] = config_.autoCalibrationEnabled();
@@ -1,30 +1,80 @@
-#include <Adafruit_BMP280.h>
+#include <Wire.h>
+
+#include <atomic>
+#include <stdarg.h>
 
 #include "io/measurements.h"
+#include "io/Bmp280.h"
+#include "io/Bmp280Sensor.h"
+#include "io/SlopeEstimator.h"
 
-Adafruit_BMP280 bmp;
-static Measurements g_last_valid{NAN, NAN, NAN};
-static bool g_have_valid = false;
-static unsigned long g_last_ms = 0;
 static unsigned long g_last_fault_log_ms = 0;
 
+// Published samples: double buffer indexed by the low bit of the sequence number
+static Measurements g_slots[2];
+static std::atomic<uint32_t> g_published{0};
+
+static TaskHandle_t g_sampler_task = nullptr;
+static uint32_t g_interval_ms = 1000;
+static MeasurementCallback g_callback{nullptr};
+
+struct SensorSlot {
+    const char* name;
+    Sensor* sensor;
+    uint8_t weight;
+    bool triggered;
+    uint32_t deadlineMs;
+    SampleFilter filter;
+    SensorReading reading;
+};
+
+// Registry is filled from setup() and fixed once the sampler runs
+static SensorSlot g_sensors[MAX_SENSORS];
+static size_t g_sensor_count = 0;
+
+// Filter state is touched by the sampler and by settings/stats callers
+static portMUX_TYPE g_filter_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Only the sampler task touches this
+static SlopeEstimator g_slope;
+
+static std::atomic<uint8_t> g_aggregate_mode{static_cast<uint8_t>(AggregateMode::Named)};
+static std::atomic<uint8_t> g_aggregate_index{0};
+
+// Slack on top of a sensor's worst-case conversion time
+static constexpr uint32_t CONVERSION_TIMEOUT_MS = 100;
+// A sensor that has not delivered for this long leaves the aggregate
+static constexpr uint32_t SENSOR_STALE_MS = 10000;
+
+static SamplingProfile g_profile{Oversampling::X2, Oversampling::X16, 60};
+static std::atomic<bool> g_pressure_requested{true};
+static uint16_t g_since_pressure = 0;
+
+static void log_fault(const char* fmt, ...) {
+    unsigned long now = millis();
+    if (now - g_last_fault_log_ms <= 10000UL) return;
+    g_last_fault_log_ms = now;
+
+    char buf[128];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    Serial.println(buf);
+}
+
 static bool try_init_addr_pins(uint8_t address, uint8_t sda, uint8_t scl) {
     Wire.begin(sda, scl);
     delay(10);
-    if (bmp.begin(address)) {
+    Bmp280 probe;
+    if (probe.begin(address)) {
         Serial.printf("BMP280 found at 0x%02X (SDA=%u, SCL=%u)\n", address, sda, scl);
-        // Use forced mode so we explicitly trigger a fresh conversion each read
-        bmp.setSampling(Adafruit_BMP280::MODE_FORCED,     /* Operating Mode. */
-                        Adafruit_BMP280::SAMPLING_X2,     /* Temp. oversampling */
-                        Adafruit_BMP280::SAMPLING_X16,    /* Pressure oversampling */
-                        Adafruit_BMP280::FILTER_X16,      /* Filtering. */
-                        Adafruit_BMP280::STANDBY_MS_500); /* Standby time. */
         return true;
     }
     return false;
 }
 
-bool initBMP280(uint8_t address, uint8_t sda, uint8_t scl) {
+static bool find_bmp280(uint8_t& address, uint8_t sda, uint8_t scl) {
     // Try caller-provided first, then common ESP32-C3 pairs and both addresses.
     // Prefer 6/7 to avoid conflict with LED on IO8 on many SuperMini boards.
     if (try_init_addr_pins(address, sda, scl)) return true;
@@ -37,59 +87,355 @@ bool initBMP280(uint8_t address, uint8_t sda, uint8_t scl) {
         uint8_t sda_i = sda_opts[i];
         uint8_t scl_i = scl_opts[i];
         if (try_init_addr_pins(address, sda_i, scl_i)) return true;
-        if (try_init_addr_pins(alt_addr, sda_i, scl_i)) return true;
+        if (try_init_addr_pins(alt_addr, sda_i, scl_i)) {
+            address = alt_addr;
+            return true;
+        }
     }
-
-    Serial.println("Could not find a valid BMP280 sensor on common I2C pins (6/7, 4/5, 8/9) or addresses (0x76/0x77). Check wiring.");
     return false;
 }
 
-Measurements takeMeasurement(bool verbose) {
-    Measurements m;
-    // In forced mode, trigger a new conversion before reading
-    if (!bmp.takeForcedMeasurement()) {
-        Serial.println("[BMP280] Forced measurement failed; returning last value if available.");
-        unsigned long now = millis();
-        if (now - g_last_fault_log_ms > 10000UL) {
-            g_last_fault_log_ms = now;
+bool initBMP280(uint8_t address, uint8_t sda, uint8_t scl) {
+    if (!find_bmp280(address, sda, scl)) {
+        Serial.println("Could not find a valid BMP280 sensor on common I2C pins (6/7, 4/5, 8/9) or addresses (0x76/0x77). Check wiring.");
+        return false;
+    }
+    static Bmp280Sensor primary(address);
+    return addSensor("cabin", &primary, 1);
+}
+
+bool addSensor(const char* name, Sensor* sensor, uint8_t weight) {
+    if (g_sampler_task != nullptr) {
+        Serial.println("[Sensors] Cannot add sensors after the sampler started");
+        return false;
+    }
+    if (g_sensor_count >= MAX_SENSORS) {
+        Serial.printf("[Sensors] Registry full; '%s' ignored\n", name);
+        return false;
+    }
+    for (size_t i = 0; i < g_sensor_count; ++i) {
+        if (g_sensors[i].sensor == sensor) return true;
+    }
+    if (!sensor->begin()) {
+        Serial.printf("[Sensors] %s '%s' not found\n", sensor->type(), name);
+        return false;
+    }
+
+    SensorSlot& slot = g_sensors[g_sensor_count];
+    slot.name = name;
+    slot.sensor = sensor;
+    slot.weight = weight;
+    slot.reading = SensorReading{0, 0, 0, 0, false, false};
+    ++g_sensor_count;
+
+    Serial.printf("[Sensors] #%u %s '%s' registered (weight %u)\n",
+                  static_cast<unsigned>(g_sensor_count - 1), sensor->type(), name, weight);
+    return true;
+}
+
+size_t sensorCount() {
+    return g_sensor_count;
+}
+
+const char* sensorName(size_t index) {
+    return index < g_sensor_count ? g_sensors[index].name : "";
+}
+
+const char* sensorType(size_t index) {
+    return index < g_sensor_count ? g_sensors[index].sensor->type() : "";
+}
+
+void setAggregate(AggregateMode mode, uint8_t namedIndex) {
+    g_aggregate_index = namedIndex;
+    g_aggregate_mode = static_cast<uint8_t>(mode);
+}
+
+// Trigger phase: start a conversion on every sensor back to back and
+// return the longest conversion time among those that started.
+static uint32_t trigger_all(bool withPressure) {
+    uint32_t waitMs = 0;
+    for (size_t i = 0; i < g_sensor_count; ++i) {
+        SensorSlot& slot = g_sensors[i];
+        slot.triggered = slot.sensor->trigger(g_profile, withPressure);
+        if (!slot.triggered) {
+            log_fault("[Sensors] Failed to trigger '%s'; keeping last value.", slot.name);
+            continue;
         }
+        const uint32_t ms = slot.sensor->conversionMs(g_profile, withPressure);
+        slot.deadlineMs = millis() + ms + CONVERSION_TIMEOUT_MS;
+        if (ms > waitMs) waitMs = ms;
     }
-    m.temperature = bmp.readTemperature();
-    m.pressure    = bmp.readPressure() / 100.0F;
-    m.altitude    = bmp.readAltitude(1013.25);
+    return waitMs;
+}
 
-    bool temp_ok = (m.temperature > -40.0f && m.temperature < 85.0f);
-    bool pres_ok = (m.pressure > 300.0f && m.pressure < 1100.0f);
+// Collect phase for one sensor: poll until ready, read, validate and filter.
+// On failure the previous reading is kept and only ages out.
+static bool collect_one(SensorSlot& slot) {
+    while (!slot.sensor->ready()) {
+        if (static_cast<int32_t>(millis() - slot.deadlineMs) > 0) {
+            log_fault("[Sensors] Conversion on '%s' timed out; keeping last value.", slot.name);
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
 
-    if (!temp_ok || !pres_ok) {
-        Serial.println("[BMP280] Invalid reading detected (I2C glitch?). Keeping last value.");
-        unsigned long now = millis();
-        if (now - g_last_fault_log_ms > 10000UL) {
-            g_last_fault_log_ms = now;
+    Sensor::Reading r{};
+    if (!slot.sensor->collect(r)) {
+        log_fault("[Sensors] Failed to read '%s'; keeping last value.", slot.name);
+        return false;
+    }
+    if (r.centiC <= -4000 || r.centiC >= 8500) {
+        log_fault("[Sensors] Invalid reading on '%s' (bus glitch?). Keeping last value.", slot.name);
+        return false;
+    }
+
+    int32_t filtered = r.centiC;
+    portENTER_CRITICAL(&g_filter_mux);
+    slot.filter.process(r.centiC, filtered);
+    portEXIT_CRITICAL(&g_filter_mux);
+
+    slot.reading.centiC = filtered;
+    slot.reading.rawCentiC = r.centiC;
+    slot.reading.pressurePa = r.pressurePa;
+    slot.reading.timestampMs = millis();
+    return true;
+}
+
+// Reduces the valid per-sensor values to one control value. Works on both
+// the filtered and the raw value so the two stay comparable.
+static bool aggregate(const Measurements& m, int32_t& centiC, int32_t& rawCentiC) {
+    const AggregateMode mode = static_cast<AggregateMode>(g_aggregate_mode.load());
+    if (mode == AggregateMode::Named) {
+        const uint8_t idx = g_aggregate_index.load();
+        if (idx < m.sensorCount && m.sensors[idx].valid) {
+            centiC = m.sensors[idx].centiC;
+            rawCentiC = m.sensors[idx].rawCentiC;
+            return true;
         }
-    } else {
-        g_last_valid = m;
-        g_have_valid = true;
-        g_last_ms = millis();
+        log_fault("[Sensors] Named sensor #%u unavailable; using weighted mean.", idx);
     }
 
-    const Measurements& out = g_have_valid ? g_last_valid : m;
-    if (verbose) {
-        Serial.print("T: ");
-        Serial.print(out.temperature, 2);
-        Serial.print(" °C  |  P: ");
-        Serial.print(out.pressure, 2);
-        Serial.print(" hPa  |  Alt: ");
-        Serial.print(out.altitude, 2);
-        Serial.println(" m");
+    bool any = false;
+    if (mode == AggregateMode::Min) {
+        for (size_t i = 0; i < m.sensorCount; ++i) {
+            const SensorReading& s = m.sensors[i];
+            // Weight 0 marks a probe outside the cabin; never a control input
+            if (!s.valid || g_sensors[i].weight == 0) continue;
+            if (!any || s.centiC < centiC) {
+                centiC = s.centiC;
+                rawCentiC = s.rawCentiC;
+            }
+            any = true;
+        }
+        return any;
+    }
+
+    int64_t sum = 0;
+    int64_t rawSum = 0;
+    uint32_t weights = 0;
+    for (size_t i = 0; i < m.sensorCount; ++i) {
+        const SensorReading& s = m.sensors[i];
+        const uint8_t w = g_sensors[i].weight;
+        if (!s.valid || w == 0) continue;
+        sum += static_cast<int64_t>(s.centiC) * w;
+        rawSum += static_cast<int64_t>(s.rawCentiC) * w;
+        weights += w;
+    }
+    if (weights == 0) return false;
+    centiC = static_cast<int32_t>(sum / static_cast<int64_t>(weights));
+    rawCentiC = static_cast<int32_t>(rawSum / static_cast<int64_t>(weights));
+    return true;
+}
+
+// One sampler cycle: trigger everything, sleep once for the slowest
+// conversion, then collect all sensors in a single pass. The wait is a task
+// delay, so the CPU (and the network stack) stays available meanwhile.
+static bool sample_once(Measurements& out) {
+    if (g_sensor_count == 0) return false;
+
+    bool withPressure = g_pressure_requested.exchange(false) ||
+                        (g_profile.pressureEveryN != 0 && g_since_pressure >= g_profile.pressureEveryN);
+    g_since_pressure = withPressure ? 0 : g_since_pressure + 1;
+
+    const uint32_t waitMs = trigger_all(withPressure);
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+    bool fresh = false;
+    for (size_t i = 0; i < g_sensor_count; ++i) {
+        SensorSlot& slot = g_sensors[i];
+        slot.reading.fresh = slot.triggered && collect_one(slot);
+        if (slot.reading.fresh) fresh = true;
+    }
+    // Nothing new this cycle: keep the last published sample
+    if (!fresh) return false;
+
+    Measurements m{};
+    m.timestampMs = millis();
+    m.sensorCount = static_cast<uint8_t>(g_sensor_count);
+    for (size_t i = 0; i < g_sensor_count; ++i) {
+        SensorReading& r = g_sensors[i].reading;
+        r.valid = r.timestampMs != 0 && (m.timestampMs - r.timestampMs) < SENSOR_STALE_MS;
+        m.sensors[i] = r;
+        if (m.pressurePa == 0 && r.valid) m.pressurePa = r.pressurePa;
+    }
+
+    int32_t centiC = 0;
+    int32_t rawCentiC = 0;
+    if (!aggregate(m, centiC, rawCentiC)) return false;
+
+    m.temperatureCentiC = centiC;
+    m.rawCentiC = rawCentiC;
+    // Float views for the UI / planning code; one conversion per sample
+    m.temperature = static_cast<float>(centiC) / 100.0f;
+    m.pressure = m.pressurePa ? static_cast<float>(m.pressurePa) / 100.0f : NAN;
+
+    // Slope runs on the filtered value so a rejected spike cannot tilt it
+    g_slope.add(centiC, m.timestampMs);
+    int32_t slope = 0;
+    m.slopeCPerMin = g_slope.slopeMilliCPerMin(slope) ? static_cast<float>(slope) / 1000.0f : NAN;
+    out = m;
+    return true;
+}
+
+// Single writer (the sampler task): fill the slot readers are not looking at,
+// then flip g_published. A reader holding seq N reads slot (N & 1), which is
+// not rewritten until after N + 1 has been published.
+static void publish(Measurements m) {
+    uint32_t seq = g_published.load(std::memory_order_relaxed) + 1;
+    m.seq = seq;
+    std::atomic_thread_fence(std::memory_order_release);
+    g_slots[seq & 1u] = m;
+    g_published.store(seq, std::memory_order_release);
+
+    if (g_callback) {
+        g_callback(m);
+    }
+}
+
+static void sampler_loop(void* pvParameters) {
+    const TickType_t period = pdMS_TO_TICKS(g_interval_ms);
+    TickType_t nextDue = xTaskGetTickCount();
+    for (;;) {
+        // Sleep until the next period, or until requestMeasurement() wakes us
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = (static_cast<int32_t>(nextDue - now) > 0) ? (nextDue - now) : 0;
+        ulTaskNotifyTake(pdTRUE, wait);
+        nextDue = xTaskGetTickCount() + period;
+
+        Measurements m;
+        if (sample_once(m)) {
+            publish(m);
+        }
+    }
+}
+
+void startMeasurementTask(uint32_t intervalMs, uint32_t stackSize, UBaseType_t priority) {
+    if (g_sampler_task != nullptr) {
+        Serial.println("[Sensors] Warning: sampler task already running");
+        return;
+    }
+    g_interval_ms = intervalMs;
+
+    // Prime the snapshot so consumers starting right after us see a real value
+    Measurements m;
+    if (sample_once(m)) {
+        publish(m);
+    }
+
+    xTaskCreate(&sampler_loop, "Sampler", stackSize, nullptr, priority, &g_sampler_task);
+    Serial.printf("[Sensors] Sampler task started (%u sensors, every %lu ms)\n",
+                  static_cast<unsigned>(g_sensor_count), static_cast<unsigned long>(intervalMs));
+}
+
+Measurements latestMeasurement() {
+    for (;;) {
+        uint32_t seq = g_published.load(std::memory_order_acquire);
+        if (seq == 0) {
+            Measurements none{};
+            none.temperature = NAN;
+            none.pressure = NAN;
+            none.slopeCPerMin = NAN;
+            return none;
+        }
+        Measurements out = g_slots[seq & 1u];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // If nothing new was published the slot cannot have been touched.
+        // Otherwise the writer finished a newer sample: just take that one.
+        if (g_published.load(std::memory_order_relaxed) == seq) {
+            return out;
+        }
+    }
+}
+
+void setMeasurementCallback(MeasurementCallback cb) {
+    g_callback = cb;
+}
+
+void setFilterSettings(const SampleFilter::Settings& settings) {
+    portENTER_CRITICAL(&g_filter_mux);
+    for (SensorSlot& slot : g_sensors) {
+        slot.filter.configure(settings);
+    }
+    portEXIT_CRITICAL(&g_filter_mux);
+}
+
+SampleFilter::Stats filterStats(size_t sensorIndex) {
+    if (sensorIndex >= MAX_SENSORS) sensorIndex = 0;
+    portENTER_CRITICAL(&g_filter_mux);
+    SampleFilter::Stats s = g_sensors[sensorIndex].filter.stats();
+    portEXIT_CRITICAL(&g_filter_mux);
+    return s;
+}
+
+void setSamplingProfile(const SamplingProfile& profile) {
+    g_profile = profile;
+    g_pressure_requested = true;
+}
+
+float latestTemperature() {
+    return latestMeasurement().temperature;
+}
+
+void requestPressure() {
+    g_pressure_requested = true;
+}
+
+float pressureAltitude(float pressure_hPa, float seaLevel_hPa) {
+    if (!isfinite(pressure_hPa) || pressure_hPa <= 0.0f) return NAN;
+    return 44330.0f * (1.0f - powf(pressure_hPa / seaLevel_hPa, 0.1903f));
+}
+
+uint32_t requestMeasurement() {
+    uint32_t seq = g_published.load(std::memory_order_acquire);
+    if (g_sampler_task != nullptr) {
+        xTaskNotifyGive(g_sampler_task);
+    }
+    return seq;
+}
+
+uint32_t measurementWaitMs() {
+    uint32_t slowest = 0;
+    for (size_t i = 0; i < g_sensor_count; ++i) {
+        const uint32_t ms = g_sensors[i].sensor->conversionMs(g_profile, true);
+        if (ms > slowest) slowest = ms;
+    }
+    return slowest + CONVERSION_TIMEOUT_MS;
+}
+
+bool waitForMeasurement(uint32_t afterSeq, uint32_t timeoutMs, Measurements& out) {
+    const uint32_t start = millis();
+    for (;;) {
+        out = latestMeasurement();
+        if (out.seq != afterSeq) return true;
+        if (millis() - start >= timeoutMs) return false;
+        vTaskDelay(pdMS_TO_TICKS(5));
     }
-    return out;
 }
 
 bool getLastMeasurement(Measurements& out, uint32_t& age_ms) {
-    if (!g_have_valid) return false;
-    out = g_last_valid;
+    Measurements m = latestMeasurement();
+    if (m.seq == 0) return false;
+    out = m;
     unsigned long now = millis();
-    age_ms = (now >= g_last_ms) ? (now - g_last_ms) : 0;
+    age_ms = (now >= m.timestampMs) ? (now - m.timestampMs) : 0;
     return true;
 }
@@ -17,8 +17,16 @@
 #include "core/WatchDog.h"
 #include "io/LedManager.h"
 #include "io/WebSocketHub.h"
+#include "io/ShellyEvents.h"
 #include "heating/ReadyByTask.h"
-#include "heating/KFactorCalibrator.h"
+#include "heating/KFactorCalibrationManager.h"
+#include "core/TemperatureHistory.h"
+#include "core/SampleRecorder.h"
+#include "heating/EnergyMeter.h"
+#include "heating/ActuatorTask.h"
+#include "io/MqttLink.h"
+#include "io/Bmp280Sensor.h"
+#include "io/Ds18b20Sensor.h"
 
 #include <nvs_flash.h>
 #include <nvs.h>
@@ -30,15 +38,61 @@ static AsyncWebServer server(80);
 
 static Config config;
 static Thermostat thermostat(0.0f, 0.0f); // will overwrite below
-static ShellyHandler shelly(SHELLY_IP);
+#ifndef SHELLY_SWITCH_ID
+#define SHELLY_SWITCH_ID 0
+#endif
+static ShellyHandler shelly(SHELLY_IP, SHELLY_SWITCH_ID);
 static LogManager logManager;
+static TemperatureHistory tempHistory;
+static SampleRecorder recorder;
+static EnergyMeter energyMeter(config);
+
+// Optional extra sensors, enabled from staticconfig.h
+#ifdef SECOND_BMP280_I2C_ADDRESS
+static Bmp280Sensor windshieldSensor(SECOND_BMP280_I2C_ADDRESS);
+#endif
+#ifdef DS18B20_PIN
+static OneWire oneWire(DS18B20_PIN);
+static Ds18b20Sensor outsideSensor(oneWire);
+#endif
+// Optional auxiliary heater outputs, enabled from staticconfig.h. Each may
+// be its own Shelly or another channel (SWITCH_ID) of one already in use.
+#ifdef ENGINE_HEATER_SHELLY_IP
+#ifndef ENGINE_HEATER_SWITCH_ID
+#define ENGINE_HEATER_SWITCH_ID 0
+#endif
+static ShellyHandler engineShelly(ENGINE_HEATER_SHELLY_IP, ENGINE_HEATER_SWITCH_ID);
+#endif
+#ifdef BATTERY_WARMER_SHELLY_IP
+#ifndef BATTERY_WARMER_SWITCH_ID
+#define BATTERY_WARMER_SWITCH_ID 0
+#endif
+static ShellyHandler batteryShelly(BATTERY_WARMER_SHELLY_IP, BATTERY_WARMER_SWITCH_ID);
+#endif
 static LedManager ledManager(LED_PIN, LED_ACTIVE_HIGH != 0);
 static HeaterTask heaterTask(config, thermostat, shelly, logManager, ledManager);
 static WatchDog watchdog(config, thermostat, shelly, logManager, ledManager, heaterTask);
 static ReadyByTask readyByTask(config, heaterTask, logManager, thermostat);
 static KFactorCalibrationManager calibration(config, heaterTask, readyByTask, logManager);
+static ActuatorTask actuators(config, heaterTask, logManager);
+
+// Optional MQTT transport: relay RPC + pushes for the Shellys and retained
+// telemetry, enabled from staticconfig.h
+#ifdef MQTT_BROKER_HOST
+#ifndef SHELLY_MQTT_PREFIX
+#error "MQTT_BROKER_HOST needs SHELLY_MQTT_PREFIX (the Shelly's MQTT topic prefix)"
+#endif
+#ifndef MQTT_BROKER_PORT
+#define MQTT_BROKER_PORT 1883
+#endif
+#ifndef MQTT_TOPIC_ROOT
+#define MQTT_TOPIC_ROOT "car-heater"
+#endif
+static MqttLink mqtt(MQTT_BROKER_HOST, MQTT_BROKER_PORT, "car-heater", MQTT_TOPIC_ROOT);
+#endif
 
 static WebSocketHub webSocketHub(server, heaterTask, readyByTask, config, calibration);
+static ShellyEvents shellyEvents(server, shelly);
 static WebInterface webInterface(
     server,
     config,
@@ -49,7 +103,11 @@ static WebInterface webInterface(
     ledManager,
     heaterTask,
     readyByTask,
-    calibration);
+    calibration,
+    tempHistory,
+    recorder,
+    energyMeter,
+    actuators);
 
 void setup()
 {
@@ -82,7 +140,10 @@ void setup()
     if (!logManager.begin())
         Serial.println("⚠️ [LogManager] Failed to initialize");
     else
+    {
+        logManager.start(4096, 1);
         Serial.println("[LogManager] Initialized");
+    }
 
     thermostat.setTarget(config.targetTemp());
     thermostat.setHysteresis(config.hysteresis());
@@ -93,6 +154,34 @@ void setup()
         BMP280_I2C_ADDRESS,
         I2C_SDA_PIN,
         I2C_SCL_PIN);
+#ifdef SECOND_BMP280_I2C_ADDRESS
+    addSensor("windshield", &windshieldSensor, 1);
+#endif
+#ifdef DS18B20_PIN
+    addSensor("outside", &outsideSensor, 0); // reported, but kept out of the cabin mean
+#endif
+    setAggregate(static_cast<AggregateMode>(config.aggregateMode()), config.aggregateSensor());
+    SampleFilter::Settings filter;
+    filter.mode = static_cast<SampleFilter::Mode>(config.filterMode());
+    filter.gateCentiC = static_cast<uint16_t>(lroundf(config.filterGateC() * 100.0f));
+    setFilterSettings(filter);
+    recorder.start(3072, 1); // stack size, priority
+    recorder.setEnabled(config.recordingEnabled());
+    heaterTask.setRelayCallback([](bool on)
+                                {
+                                  recorder.addRelay(on, millis());
+#ifdef MQTT_BROKER_HOST
+                                  mqtt.requestTelemetry();
+#endif
+                                });
+    setMeasurementCallback([](const Measurements &m)
+                           {
+                             tempHistory.append(m.temperatureCentiC, heaterTask.isHeaterOn(), m.timestampMs);
+                             recorder.addSample(m); });
+    Serial.printf("[History] Temperature history uses %u bytes\n",
+                  static_cast<unsigned>(TemperatureHistory::FOOTPRINT_BYTES));
+    // Sampler owns the I2C bus from here on; everyone else reads its snapshot
+    startMeasurementTask(1000, 3072, 2); // interval ms, stack size, priority
 
     // Start LED manager
     ledManager.begin();
@@ -101,8 +190,50 @@ void setup()
     heaterTask.setKickCallback([]()
                                { watchdog.kickHeater(); });
 
+    energyMeter.begin();
+    heaterTask.setEnergyMeter(&energyMeter);
+    readyByTask.setEnergyMeter(&energyMeter);
+    calibration.setEnergyMeter(&energyMeter);
+
+#ifdef MQTT_BROKER_HOST
+    // Attach before the Shelly workers start; relay RPCs use HTTP until
+    // the link is connected
+#if defined(MQTT_USER) && defined(MQTT_PASSWORD)
+    mqtt.setCredentials(MQTT_USER, MQTT_PASSWORD);
+#endif
+    mqtt.attachShelly(shelly, SHELLY_MQTT_PREFIX);
+#if defined(ENGINE_HEATER_SHELLY_IP) && defined(ENGINE_HEATER_MQTT_PREFIX)
+    mqtt.attachShelly(engineShelly, ENGINE_HEATER_MQTT_PREFIX);
+#endif
+#if defined(BATTERY_WARMER_SHELLY_IP) && defined(BATTERY_WARMER_MQTT_PREFIX)
+    mqtt.attachShelly(batteryShelly, BATTERY_WARMER_MQTT_PREFIX);
+#endif
+    mqtt.addTelemetry("state", [](JsonDocument &doc)
+                      {
+                        webSocketHub.buildTempUpdate(doc);
+                        doc["target_c"] = config.targetTemp(); });
+    mqtt.addTelemetry("ready_by", [](JsonDocument &doc)
+                      { webSocketHub.buildReadyByUpdate(doc); });
+    mqtt.start(4096, 1); // stack size, priority
+#endif
+    shelly.enableWebhooks(true); // relay changes are pushed; polling only reconciles
+    shelly.start(4096, 1); // stack size, priority
+    // Every output has its own Shelly worker, so they poll and switch in parallel
+#ifdef ENGINE_HEATER_SHELLY_IP
+    actuators.add("engine", engineShelly);
+    shellyEvents.addDevice(engineShelly);
+    engineShelly.enableWebhooks(true);
+    engineShelly.start(4096, 1);
+#endif
+#ifdef BATTERY_WARMER_SHELLY_IP
+    actuators.add("battery", batteryShelly);
+    shellyEvents.addDevice(batteryShelly);
+    batteryShelly.enableWebhooks(true);
+    batteryShelly.start(4096, 1);
+#endif
     heaterTask.start(4096, 1); // stack size, priority
     readyByTask.start(4096, 1); // stack size, priority
+    actuators.start(3072, 1); // no task unless an auxiliary output is configured
     calibration.begin(4096, 1);
     calibration.setUpdateCallback([]()
                                   { webSocketHub.broadcastCalibrationUpdate(); });
@@ -115,12 +246,18 @@ void setup()
 
     // Setup WebSocket integration
     webSocketHub.begin();
+    shellyEvents.begin();
     heaterTask.setWsTempUpdateCallback([]()
                             { webSocketHub.broadcastTempUpdate(); });
-    logManager.setCallback([](const String &line)
-                            { webSocketHub.broadcastLogLine(line); });
+    logManager.setCallback([](uint32_t seq, const String &line)
+                            { webSocketHub.broadcastLogLine(seq, line); });
     readyByTask.setWsReadyByUpdateCallback([]()
-                            { webSocketHub.broadcastReadyByUpdate(); });
+                            {
+                              webSocketHub.broadcastReadyByUpdate();
+#ifdef MQTT_BROKER_HOST
+                              mqtt.requestTelemetry();
+#endif
+                            });
 
     // Print NVS stats
     printNvsStats();
@@ -3,6 +3,7 @@
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include <esp_system.h>
+#include <memory>
 
 #include "io/wifihelper.h"
 #include "io/measurements.h"
@@ -10,7 +11,7 @@
 #include "ui/WebInterface.h"
 #include "heating/ReadyByTask.h"
 #include "heating/HeatingCalculator.h"
-#include "heating/KFactorCalibrator.h"
+#include "heating/KFactorCalibrationManager.h"
 
 WebInterface::WebInterface(AsyncWebServer &server,
                            Config &config,
@@ -21,7 +22,11 @@ WebInterface::WebInterface(AsyncWebServer &server,
                            LedManager &led,
                            HeaterTask &heaterTask,
                            ReadyByTask &readyByTask,
-                           KFactorCalibrationManager &calibration)
+                           KFactorCalibrationManager &calibration,
+                           TemperatureHistory &history,
+                           SampleRecorder &recorder,
+                           EnergyMeter &energy,
+                           ActuatorTask &actuators)
     : server_(server),
       config_(config),
       thermostat_(thermostat),
@@ -31,7 +36,11 @@ WebInterface::WebInterface(AsyncWebServer &server,
       led_(led),
       heaterTask_(heaterTask),
       readyByTask_(readyByTask),
-      calibration_(calibration)
+      calibration_(calibration),
+      history_(history),
+      recorder_(recorder),
+      energy_(energy),
+      actuators_(actuators)
 {
 }
 
@@ -91,9 +100,31 @@ void WebInterface::setupApiRoutes()
   server_.on("/api/logs", HTTP_GET, [this](AsyncWebServerRequest *request)
              { handleApiLogs(request); });
 
+  server_.on("/api/history", HTTP_GET, [this](AsyncWebServerRequest *request)
+             { handleApiHistory(request); });
+
+  // Sensor recording
+  server_.on("/api/recording", HTTP_GET, [this](AsyncWebServerRequest *request)
+             { handleApiRecording(request); });
+  server_.on("/api/recording", HTTP_POST, [this](AsyncWebServerRequest *request)
+             { handleRecordingSettings(request); });
+  server_.on("/api/recording/download", HTTP_GET, [this](AsyncWebServerRequest *request)
+             { handleRecordingDownload(request); });
+
+  server_.on("/api/energy", HTTP_GET, [this](AsyncWebServerRequest *request)
+             { handleApiEnergy(request); });
+
+  // Relay outputs: the cabin heater plus any auxiliary actuators
+  server_.on("/api/actuators", HTTP_GET, [this](AsyncWebServerRequest *request)
+             { handleApiActuators(request); });
+  server_.on("/api/actuators/settings", HTTP_POST, [this](AsyncWebServerRequest *request)
+             { handleActuatorSettings(request); });
+
   server_.on("/api/reboot", HTTP_POST, [this](AsyncWebServerRequest *request)
              {
                Serial.println("[Web] Reboot request received");
+               recorder_.flush();
+               logManager_.flush();
                request->send(200, "text/plain", "Rebooting...");
                delay(100);
                esp_restart(); });
@@ -229,6 +260,26 @@ void WebInterface::handleSetConfig(AsyncWebServerRequest *request)
     uint16_t m = v.substring(3, 5).toInt();
     config_.setDeadzoneEndMin(h * 60 + m);
   }
+  if (request->hasParam("fltmode", true) || request->hasParam("fltgate", true))
+  {
+    if (request->hasParam("fltmode", true))
+      config_.setFilterMode(static_cast<uint8_t>(request->getParam("fltmode", true)->value().toInt()));
+    if (request->hasParam("fltgate", true))
+      config_.setFilterGateC(request->getParam("fltgate", true)->value().toFloat());
+
+    SampleFilter::Settings filter;
+    filter.mode = static_cast<SampleFilter::Mode>(config_.filterMode());
+    filter.gateCentiC = static_cast<uint16_t>(lroundf(config_.filterGateC() * 100.0f));
+    setFilterSettings(filter);
+  }
+  if (request->hasParam("aggmode", true) || request->hasParam("aggsensor", true))
+  {
+    if (request->hasParam("aggmode", true))
+      config_.setAggregateMode(static_cast<uint8_t>(request->getParam("aggmode", true)->value().toInt()));
+    if (request->hasParam("aggsensor", true))
+      config_.setAggregateSensor(static_cast<uint8_t>(request->getParam("aggsensor", true)->value().toInt()));
+    setAggregate(static_cast<AggregateMode>(config_.aggregateMode()), config_.aggregateSensor());
+  }
 
   config_.save();
   led_.blinkSingle();
@@ -244,17 +295,65 @@ void WebInterface::handleLogsClear(AsyncWebServerRequest *request)
 
 void WebInterface::handleApiStatus(AsyncWebServerRequest *request)
 {
-  bool isOn;
-
-  float currentTemp = takeMeasurement().temperature;
+  ShellyStatus relay;
+  uint32_t relayAgeMs = 0;
+  // The Shelly worker keeps the relay state fresh; never block the async server on it
+  const bool relayKnown = shelly_.cachedStatus(relay, relayAgeMs);
+
+  Measurements m = latestMeasurement();
+  // Pressure is only converted on demand; this refreshes it for the next poll
+  requestPressure();
   String currentTime = timekeeper::isValid()
                            ? timekeeper::formatLocal()
                            : "Not set";
 
   JsonDocument doc;
   doc["wifi_ssid"] = wifiSSID_;
-  doc["temp"] = currentTemp;
-  doc["is_on"] = shelly_.getStatus(isOn) ? isOn : false;
+  doc["temp"] = m.temperature;
+  doc["slope_c_per_min"] = m.slopeCPerMin;
+  doc["pressure_hpa"] = m.pressure;
+  doc["altitude_m"] = pressureAltitude(m.pressure);
+  doc["is_on"] = relayKnown ? relay.output : false;
+  if (relayKnown)
+    doc["relay_age_ms"] = relayAgeMs;
+  else
+    doc["relay_age_ms"] = nullptr;
+  doc["relay_push"] = shelly_.pushActive();
+  // NAN (not metered / not read yet) serializes as null
+  JsonObject meter = doc["relay_meter"].to<JsonObject>();
+  meter["apower_w"] = relay.apowerW;
+  meter["voltage_v"] = relay.voltageV;
+  meter["current_a"] = relay.currentA;
+  meter["temp_c"] = relay.temperatureC;
+  meter["energy_wh"] = relay.energyWh;
+
+  ShellyHandler::BreakerStats br = shelly_.breakerStats();
+  JsonObject link = doc["shelly"].to<JsonObject>();
+  link["breaker"] = ShellyHandler::breakerStateName(br.state);
+  link["failures"] = br.consecutiveFailures;
+  link["trips"] = br.trips;
+  link["fast_fails"] = br.fastFails;
+  link["retry_in_ms"] = br.retryInMs;
+  link["srtt_ms"] = br.srttMs;
+  link["rttvar_ms"] = br.rttVarMs;
+  link["timeout_ms"] = br.timeoutMs;
+  link["timeout_backoff"] = br.timeoutBackoff;
+  link["requests"] = shelly_.requestCount();
+  link["connects"] = shelly_.connectCount();
+  link["switch_sent"] = shelly_.switchSent();
+  link["switch_suppressed"] = shelly_.switchSuppressed();
+  link["switch_superseded"] = shelly_.switchSuperseded();
+  link["on_lease_s"] = shelly_.onLeaseS();
+  link["lease_renewals"] = shelly_.leaseRenewals();
+  JsonObject logs = doc["logs"].to<JsonObject>();
+  logs["dropped"] = logManager_.droppedLines();
+  logs["pending"] = logManager_.pendingLines();
+  logs["syncs"] = logManager_.syncs();
+  const LogStore::Stats ls = logManager_.store().stats();
+  logs["segments"] = ls.segments;
+  logs["stored_bytes"] = ls.bytes;
+  logs["first_seq"] = ls.firstSeq;
+  logs["last_seq"] = ls.lastSeq;
   doc["current_time"] = currentTime;
   doc["time_synced"] = timekeeper::isTrulyValid();
   doc["in_deadzone"] = heaterTask_.isInDeadzone();
@@ -267,24 +366,243 @@ void WebInterface::handleApiStatus(AsyncWebServerRequest *request)
   doc["dz_start"] = fmtHHMM(config_.deadzoneStartMin());
   doc["dz_end"] = fmtHHMM(config_.deadzoneEndMin());
 
+  SampleFilter::Stats fs = filterStats();
+  JsonObject filter = doc["filter"].to<JsonObject>();
+  filter["mode"] = static_cast<uint8_t>(fs.mode);
+  filter["gate_c"] = config_.filterGateC();
+  filter["raw_temp"] = m.rawCentiC / 100.0f;
+  filter["variance_c2"] = fs.varianceCenti2 / 10000.0f;
+  filter["accepted"] = fs.accepted;
+  filter["rejected"] = fs.rejected;
+  filter["reseeds"] = fs.reseeds;
+
+  JsonObject agg = doc["aggregate"].to<JsonObject>();
+  agg["mode"] = config_.aggregateMode();
+  agg["sensor"] = config_.aggregateSensor();
+
+  const uint32_t nowMs = millis();
+  JsonArray sensors = doc["sensors"].to<JsonArray>();
+  for (size_t i = 0; i < m.sensorCount; ++i)
+  {
+    const SensorReading &r = m.sensors[i];
+    JsonObject o = sensors.add<JsonObject>();
+    o["name"] = sensorName(i);
+    o["type"] = sensorType(i);
+    o["valid"] = r.valid;
+    o["temp"] = r.centiC / 100.0f;
+    o["raw_temp"] = r.rawCentiC / 100.0f;
+    if (r.pressurePa != 0)
+      o["pressure_hpa"] = r.pressurePa / 100.0f;
+    o["age_ms"] = r.timestampMs ? nowMs - r.timestampMs : 0;
+    o["rejected"] = filterStats(i).rejected;
+  }
+
   String json;
   serializeJson(doc, json);
   request->send(200, "application/json", json);
 }
 
+namespace
+{
+// State of one /api/logs response. The filler renders one entry at a time
+// into pending and copies as much as fits into each chunk, so a response
+// needs this object and nothing more however many entries it carries.
+class LogStream
+{
+public:
+  LogStream(const LogManager &logs, uint32_t fromSeq, uint32_t endSeq, size_t limit)
+      : logs_(logs), endSeq_(endSeq), left_(limit)
+  {
+    cursor_.seq = fromSeq;
+  }
+
+  // Text sent before the entries (must fit in pending_)
+  void begin(const char *header)
+  {
+    pendingLen_ = strlcpy(pending_, header, sizeof(pending_));
+  }
+
+  size_t fill(uint8_t *buf, size_t maxLen)
+  {
+    size_t n = copyPending(buf, maxLen);
+    while (n < maxLen && !done_)
+    {
+      if (left_ == 0 || ended_)
+      {
+        pendingLen_ = strlcpy(pending_, "]}", sizeof(pending_));
+        pendingOff_ = 0;
+        done_ = true;
+        n += copyPending(buf + n, maxLen - n);
+        break;
+      }
+      const size_t visited = logs_.read(cursor_, left_, [&](uint32_t seq, const uint8_t *rec, size_t len)
+                                        {
+        if (seq >= endSeq_)
+        {
+          ended_ = true;
+          return false;
+        }
+        --left_;
+        stage(seq, rec, len);
+        n += copyPending(buf + n, maxLen - n);
+        return pendingOff_ == pendingLen_ && n < maxLen; });
+      if (visited == 0)
+        ended_ = true;
+    }
+    return n;
+  }
+
+private:
+  size_t copyPending(uint8_t *buf, size_t maxLen)
+  {
+    size_t take = pendingLen_ - pendingOff_;
+    if (take > maxLen)
+      take = maxLen;
+    memcpy(buf, pending_ + pendingOff_, take);
+    pendingOff_ += take;
+    return take;
+  }
+
+  // {"seq":N,"text":"..."} with the text JSON-escaped
+  void stage(uint32_t seq, const uint8_t *rec, size_t len)
+  {
+    char text[LogManager::MAX_TEXT_LEN];
+    renderLogRecord(rec, len, text, sizeof(text));
+    size_t pos = snprintf(pending_, sizeof(pending_), "%s{\"seq\":%lu,\"text\":\"",
+                          first_ ? "" : ",", static_cast<unsigned long>(seq));
+    first_ = false;
+    for (const char *c = text; *c && pos + 8 < sizeof(pending_); ++c)
+    {
+      const unsigned char ch = static_cast<unsigned char>(*c);
+      if (ch == '"' || ch == '\\')
+      {
+        pending_[pos++] = '\\';
+        pending_[pos++] = static_cast<char>(ch);
+      }
+      else if (ch < 0x20)
+        pos += snprintf(pending_ + pos, sizeof(pending_) - pos, "\\u%04x", ch);
+      else
+        pending_[pos++] = static_cast<char>(ch);
+    }
+    pending_[pos++] = '"';
+    pending_[pos++] = '}';
+    pendingLen_ = pos;
+    pendingOff_ = 0;
+  }
+
+  const LogManager &logs_;
+  LogStore::Cursor cursor_;
+  uint32_t endSeq_;   // first seq not to send
+  size_t left_;       // entries still allowed
+  bool first_ = true;
+  bool ended_ = false;
+  bool done_ = false;
+  // Worst case: every text byte escaped as \u00XX
+  char pending_[LogManager::MAX_TEXT_LEN * 6 + 40];
+  size_t pendingLen_ = 0;
+  size_t pendingOff_ = 0;
+};
+} // namespace
+
 void WebInterface::handleApiLogs(AsyncWebServerRequest *request)
 {
-  JsonDocument doc;
-  String logs = logManager_.toStringNewestFirst();
-  if (logs.isEmpty())
+  // ?before=<seq> pages back (default: the newest entries), ?after=<seq>
+  // catches up; ?limit=N entries. Entries come oldest first; next_before
+  // is the cursor for the page before this one.
+  size_t limit = 50;
+  if (request->hasParam("limit"))
   {
-    logs = "No log entries yet.";
+    long v = request->getParam("limit")->value().toInt();
+    if (v > 0)
+      limit = static_cast<size_t>(v);
   }
-  doc["logs"] = logs;
-  doc["time_synced"] = timekeeper::isTrulyValid();
-  String json;
-  serializeJson(doc, json);
-  request->send(200, "application/json", json);
+  if (limit > 200)
+    limit = 200;
+
+  const uint32_t firstSeq = logManager_.firstSeq();
+  const uint32_t lastSeq = logManager_.lastSeq();
+  uint32_t fromSeq;
+  uint32_t endSeq;
+  if (request->hasParam("after"))
+  {
+    fromSeq = strtoul(request->getParam("after")->value().c_str(), nullptr, 10) + 1;
+    endSeq = lastSeq + 1;
+  }
+  else
+  {
+    endSeq = lastSeq + 1;
+    if (request->hasParam("before"))
+    {
+      const uint32_t before = strtoul(request->getParam("before")->value().c_str(), nullptr, 10);
+      if (before < endSeq)
+        endSeq = before;
+    }
+    fromSeq = endSeq > limit ? endSeq - limit : 1;
+  }
+  if (fromSeq < firstSeq)
+    fromSeq = firstSeq;
+
+  auto stream = std::make_shared<LogStream>(logManager_, fromSeq, endSeq, limit);
+  char header[128];
+  snprintf(header, sizeof(header),
+           "{\"time_synced\":%s,\"first_seq\":%lu,\"last_seq\":%lu,\"next_before\":%lu,\"entries\":[",
+           timekeeper::isTrulyValid() ? "true" : "false",
+           static_cast<unsigned long>(firstSeq), static_cast<unsigned long>(lastSeq),
+           static_cast<unsigned long>(fromSeq));
+  stream->begin(header);
+
+  AsyncWebServerResponse *res = request->beginChunkedResponse(
+      "application/json", [stream](uint8_t *buf, size_t maxLen, size_t)
+      { return stream->fill(buf, maxLen); });
+  request->send(res);
+}
+
+void WebInterface::handleApiHistory(AsyncWebServerRequest *request)
+{
+  // ?tier=0 (1 s), 1 (1 min), 2 (15 min); ?limit=N newest entries
+  uint8_t tierNum = 1;
+  if (request->hasParam("tier"))
+  {
+    tierNum = static_cast<uint8_t>(request->getParam("tier")->value().toInt());
+    if (tierNum > 2)
+      tierNum = 2;
+  }
+  size_t limit = 120;
+  if (request->hasParam("limit"))
+  {
+    long v = request->getParam("limit")->value().toInt();
+    if (v > 0)
+      limit = static_cast<size_t>(v);
+  }
+  if (limit > 360)
+    limit = 360;
+
+  auto tier = static_cast<TemperatureHistory::Tier>(tierNum);
+  size_t count = history_.size(tier);
+  if (count > limit)
+    count = limit;
+
+  uint32_t newestMs = history_.newestMs(tier);
+  uint32_t newestAgeS = (count > 0) ? (millis() - newestMs) / 1000UL : 0;
+
+  // Written straight into the response buffer; each point is
+  // [mean, min, max, heater_on_pct], newest first, temperatures in centi-°C
+  AsyncResponseStream *res = request->beginResponseStream("application/json");
+  res->printf("{\"tier\":%u,\"interval_s\":%lu,\"newest_age_s\":%lu,\"points\":[",
+              static_cast<unsigned>(tierNum),
+              static_cast<unsigned long>(TemperatureHistory::intervalSeconds(tier)),
+              static_cast<unsigned long>(newestAgeS));
+  TemperatureHistory::Bucket b;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (!history_.at(tier, i, b))
+      break;
+    res->printf("%s[%d,%d,%d,%u]", i ? "," : "",
+                b.meanCentiC, b.minCentiC, b.maxCentiC,
+                static_cast<unsigned>(b.heaterOnPct));
+  }
+  res->print("]}");
+  request->send(res);
 }
 
 void WebInterface::handleReadyByStatus(AsyncWebServerRequest *request)
@@ -315,11 +633,12 @@ void WebInterface::handleReadyByStatus(AsyncWebServerRequest *request)
       uint64_t nowUtc = timekeeper::nowUtc();
       doc["now_epoch_utc"] = nowUtc;
 
-      float ambient = takeMeasurement(false).temperature;
+      float ambient = latestTemperature();
       doc["ambient_temp_c"] = ambient;
 
       // Use same physics as ReadyBy to estimate warmup / start time
       HeatingCalculator calc;
+      calc.setHeaterPower(config_.heaterPowerW());
       float k = calibration_.derivedKFor(ambient, targetTemp);
       float warmupSec = calc.estimateWarmupSeconds(k, ambient, targetTemp);
       if (warmupSec < 0.0f)
@@ -343,7 +662,7 @@ void WebInterface::handleReadyByStatus(AsyncWebServerRequest *request)
       doc["start_epoch_utc"] = startEpochUtc;
     }
   }
-  doc["current_temp"] = takeMeasurement(false).temperature;
+  doc["current_temp"] = latestTemperature();
   doc["time_synced"] = timekeeper::isTrulyValid();
 
   String json;
@@ -381,8 +700,9 @@ void WebInterface::handleReadyBySchedule(AsyncWebServerRequest *request)
     uint64_t nowUtc = timekeeper::nowUtc();
     doc["now_epoch_utc"] = nowUtc;
 
-    float ambient = takeMeasurement(false).temperature;
+    float ambient = latestTemperature();
     HeatingCalculator calc;
+    calc.setHeaterPower(config_.heaterPowerW());
     float warmupSec = calc.estimateWarmupSeconds(config_.kFactor(), ambient, targetTemp);
     if (warmupSec < 0.0f)
       warmupSec = 0.0f;
@@ -423,13 +743,14 @@ void WebInterface::handleCalibrationStatus(AsyncWebServerRequest *request)
   doc["current_temp_c"] = st.currentTempC;
   doc["elapsed_seconds"] = st.elapsedSeconds;
   doc["suggested_k"] = st.suggestedK;
+  doc["slope_c_per_min"] = st.slopeCPerMin;
   doc["time_synced"] = timekeeper::isTrulyValid();
   doc["current_k"] = config_.kFactor();
   doc["auto_enabled"] = config_.autoCalibrationEnabled();
   doc["auto_start_min"] = config_.autoCalibStartMin();
   doc["auto_end_min"] = config_.autoCalibEndMin();
   doc["auto_target_cap_c"] = config_.autoCalibTargetCapC();
-  doc["current_temp"] = takeMeasurement(false).temperature;
+  doc["current_temp"] = latestTemperature();
 
   JsonArray recs = doc["records"].to<JsonArray>();
   for (size_t i = 0; i < st.recordCount && i < st.records.size(); ++i)
@@ -562,3 +883,215 @@ String WebInterface::fmtHHMM(uint16_t minutes) const
   snprintf(buf, sizeof(buf), "%02u:%02u", h, m);
   return String(buf);
 }
+
+void WebInterface::handleApiRecording(AsyncWebServerRequest *request)
+{
+  SampleRecorder::Stats st = recorder_.stats();
+  JsonDocument doc;
+  doc["enabled"] = st.enabled;
+  doc["file_bytes"] = st.fileBytes;
+  doc["max_file_bytes"] = SampleRecorder::MAX_FILE_BYTES;
+  doc["blocks_written"] = st.blocksWritten;
+  doc["blocks_dropped"] = st.blocksDropped;
+  doc["pending_records"] = st.pending;
+  doc["has_previous"] = LittleFS.exists(SampleRecorder::OLD_PATH);
+
+  String json;
+  serializeJson(doc, json);
+  request->send(200, "application/json", json);
+}
+
+namespace
+{
+void energySessionToJson(const EnergyMeter::Session &s, JsonObject o)
+{
+  o["kind"] = EnergyMeter::kindName(s.kind);
+  o["start_epoch_utc"] = s.startEpochUtc;
+  o["duration_s"] = s.durationS;
+  o["on_s"] = s.onS;
+  o["energy_wh"] = s.energyDeciWh / 10.0f;
+  o["duty_pct"] = (s.durationS > 0) ? (s.onS * 100.0f) / s.durationS : 0.0f;
+  o["avg_w"] = (s.durationS > 0) ? (s.energyDeciWh * 360.0f) / s.durationS : 0.0f;
+  if (s.avgOnW > 0)
+    o["avg_on_w"] = s.avgOnW;
+  else
+    o["avg_on_w"] = nullptr;
+  o["source"] = EnergyMeter::sourceName(s.source);
+}
+} // namespace
+
+void WebInterface::handleApiEnergy(AsyncWebServerRequest *request)
+{
+  EnergyMeter::Snapshot snap = energy_.snapshot();
+
+  JsonDocument doc;
+  doc["heater_power_w"] = config_.heaterPowerW();
+  if (snap.open)
+    energySessionToJson(snap.current, doc["current"].to<JsonObject>());
+  else
+    doc["current"] = nullptr;
+  JsonArray sessions = doc["sessions"].to<JsonArray>();
+  for (size_t i = 0; i < snap.count; ++i)
+    energySessionToJson(snap.sessions[i], sessions.add<JsonObject>());
+
+  String json;
+  serializeJson(doc, json);
+  request->send(200, "application/json", json);
+}
+
+namespace
+{
+void relayToJson(const ShellyHandler &shelly, JsonObject o)
+{
+  o["ip"] = shelly.ip();
+  o["switch_id"] = shelly.switchId();
+  bool isOn;
+  uint32_t ageMs;
+  if (shelly.cachedStatus(isOn, ageMs))
+  {
+    o["relay_on"] = isOn;
+    o["relay_age_ms"] = ageMs;
+  }
+  else
+  {
+    o["relay_on"] = nullptr;
+    o["relay_age_ms"] = nullptr;
+  }
+  o["pending"] = shelly.switchPending();
+  o["push"] = shelly.pushActive();
+  o["breaker"] = ShellyHandler::breakerStateName(shelly.breakerStats().state);
+}
+
+void actuatorToJson(const ActuatorTask::Status &st, JsonObject o)
+{
+  o["name"] = st.name;
+  o["controller"] = "actuator";
+  relayToJson(*st.shelly, o);
+  o["is_on"] = st.isOn;
+  o["want_on"] = st.wantOn;
+  o["scheduled"] = st.scheduled;
+  o["schedule"] = ActuatorTask::scheduleName(static_cast<ActuatorTask::Schedule>(st.settings.schedule));
+  o["start_min"] = st.settings.startMin;
+  o["end_min"] = st.settings.endMin;
+  o["lead_min"] = st.settings.leadMin;
+  o["sensor"] = st.settings.sensor;
+  o["target_c"] = st.settings.targetDeciC / 10.0f;
+  o["hysteresis_c"] = st.settings.hysteresisDeciC / 10.0f;
+  o["sensor_c"] = st.sensorC; // NAN (unbound / no reading) serializes as null
+}
+} // namespace
+
+void WebInterface::handleApiActuators(AsyncWebServerRequest *request)
+{
+  JsonDocument doc;
+  JsonArray list = doc["actuators"].to<JsonArray>();
+
+  JsonObject cabin = list.add<JsonObject>();
+  cabin["name"] = "cabin";
+  cabin["controller"] = "heater_task";
+  relayToJson(shelly_, cabin);
+  cabin["is_on"] = heaterTask_.isHeaterOn();
+
+  for (size_t i = 0; i < actuators_.count(); ++i)
+  {
+    ActuatorTask::Status st;
+    if (actuators_.status(i, st))
+      actuatorToJson(st, list.add<JsonObject>());
+  }
+
+  String json;
+  serializeJson(doc, json);
+  request->send(200, "application/json", json);
+}
+
+void WebInterface::handleActuatorSettings(AsyncWebServerRequest *request)
+{
+  const bool fromBody = true;
+  if (!request->hasParam("name", fromBody))
+  {
+    request->send(400, "application/json", "{\"ok\":false,\"err\":\"missing name\"}");
+    return;
+  }
+  const int index = actuators_.find(request->getParam("name", fromBody)->value().c_str());
+  ActuatorTask::Status st;
+  if (index < 0 || !actuators_.status(index, st))
+  {
+    request->send(404, "application/json", "{\"ok\":false,\"err\":\"unknown actuator\"}");
+    return;
+  }
+
+  ActuatorTask::Settings s = st.settings;
+  if (request->hasParam("schedule", fromBody))
+  {
+    const String &v = request->getParam("schedule", fromBody)->value();
+    bool known = false;
+    for (uint8_t k = 0; k <= static_cast<uint8_t>(ActuatorTask::Schedule::ReadyBy); ++k)
+    {
+      if (v == ActuatorTask::scheduleName(static_cast<ActuatorTask::Schedule>(k)))
+      {
+        s.schedule = k;
+        known = true;
+      }
+    }
+    if (!known)
+    {
+      request->send(400, "application/json", "{\"ok\":false,\"err\":\"bad schedule\"}");
+      return;
+    }
+  }
+  if (request->hasParam("start_min", fromBody))
+    s.startMin = request->getParam("start_min", fromBody)->value().toInt();
+  if (request->hasParam("end_min", fromBody))
+    s.endMin = request->getParam("end_min", fromBody)->value().toInt();
+  if (request->hasParam("lead_min", fromBody))
+    s.leadMin = request->getParam("lead_min", fromBody)->value().toInt();
+  if (request->hasParam("sensor", fromBody))
+  {
+    const String &v = request->getParam("sensor", fromBody)->value();
+    strlcpy(s.sensor, v.c_str(), sizeof(s.sensor));
+  }
+  if (request->hasParam("target_c", fromBody))
+    s.targetDeciC = static_cast<int16_t>(lroundf(request->getParam("target_c", fromBody)->value().toFloat() * 10.0f));
+  if (request->hasParam("hysteresis_c", fromBody))
+    s.hysteresisDeciC = static_cast<uint16_t>(lroundf(request->getParam("hysteresis_c", fromBody)->value().toFloat() * 10.0f));
+  actuators_.setSettings(index, s);
+
+  JsonDocument doc;
+  doc["ok"] = true;
+  actuators_.status(index, st);
+  actuatorToJson(st, doc["actuator"].to<JsonObject>());
+  String json;
+  serializeJson(doc, json);
+  request->send(200, "application/json", json);
+}
+
+void WebInterface::handleRecordingSettings(AsyncWebServerRequest *request)
+{
+  const bool fromBody = true;
+  if (!request->hasParam("enabled", fromBody))
+  {
+    request->send(400, "application/json", "{\"ok\":false,\"err\":\"missing enabled\"}");
+    return;
+  }
+  bool en = request->getParam("enabled", fromBody)->value() == "1";
+  recorder_.setEnabled(en);
+  config_.setRecordingEnabled(en);
+  config_.save();
+  handleApiRecording(request);
+}
+
+void WebInterface::handleRecordingDownload(AsyncWebServerRequest *request)
+{
+  // ?file=old serves the rotated file
+  const bool old = request->hasParam("file") && request->getParam("file")->value() == "old";
+  const char *path = old ? SampleRecorder::OLD_PATH : SampleRecorder::PATH;
+  if (!old)
+    recorder_.flush();
+  if (!LittleFS.exists(path))
+  {
+    request->send(404, "text/plain", "No recording");
+    return;
+  }
+  auto *res = request->beginResponse(LittleFS, path, "application/octet-stream", true);
+  request->send(res);
+}
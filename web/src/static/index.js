@@ -3,6 +3,13 @@ let wsStatus = null;
 async function handleStatusData(data) {
   const currentTemp = data.temp;
   document.getElementById("currentTemp").textContent = currentTemp.toFixed(1);
+  const slopeEl = document.getElementById("tempSlope");
+  if (slopeEl) {
+    const slope = data.slope_c_per_min;
+    slopeEl.textContent = (typeof slope === "number")
+      ? `(${slope >= 0 ? "+" : ""}${slope.toFixed(2)} °C/min)`
+      : "";
+  }
   const navTemp = document.getElementById("navTemp");
   if (navTemp) {
     navTemp.textContent = `${currentTemp.toFixed(1)}°`;
@@ -72,6 +79,22 @@ async function loadStatus() {
     document.getElementById("taskdelay").value = data.task_delay.toFixed(1);
     document.getElementById("dzs").value       = data.dz_start || "";
     document.getElementById("dze").value       = data.dz_end || "";
+    if (data.aggregate && Array.isArray(data.sensors)) {
+      const sel = document.getElementById("aggsensor");
+      sel.innerHTML = "";
+      data.sensors.forEach((s, i) => {
+        const opt = document.createElement("option");
+        opt.value = String(i);
+        opt.textContent = `${s.name} (${s.valid ? s.temp.toFixed(1) + "°C" : "offline"})`;
+        sel.appendChild(opt);
+      });
+      sel.value = String(data.aggregate.sensor);
+      document.getElementById("aggmode").value = String(data.aggregate.mode);
+    }
+    if (data.filter) {
+      document.getElementById("fltmode").value = String(data.filter.mode);
+      document.getElementById("fltgate").value = data.filter.gate_c.toFixed(1);
+    }
 
   } catch (err) {
     console.error("Failed to load status:", err);
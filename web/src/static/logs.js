@@ -1,26 +1,77 @@
-function appendLogLine(line) {
+// Entries are fetched a page at a time by sequence number: the newest page
+// on load, older pages as the list is scrolled to its end, and anything
+// missed while the WebSocket was down via ?after=.
+const LOG_PAGE = 50;
+
+const logState = {
+  newestSeq: 0,    // newest entry shown
+  nextBefore: 0,   // cursor for the next older page
+  firstSeq: 0,     // oldest entry the device still has
+  loadingOlder: false,
+};
+
+function getLogList() {
   const container = document.getElementById("logs");
-  if (!container) return;
+  if (!container) return null;
 
   let list = container.querySelector(".logs-list");
   if (!list) {
+    container.innerHTML = "";
     list = document.createElement("div");
     list.className = "logs-list";
     container.appendChild(list);
   }
+  return list;
+}
 
+function makeLogLine(text) {
   const item = document.createElement("pre");
   item.className = "log-line";
-  item.textContent = line;
+  item.textContent = text;
+  return item;
+}
+
+function appendLogLine(seq, line) {
+  // Skip what a catch-up fetch already showed
+  if (seq && seq <= logState.newestSeq) return;
+  const list = getLogList();
+  if (!list) return;
+  if (seq) logState.newestSeq = seq;
 
   // Newest first: insert at top
-  if (list.firstChild) {
-    list.insertBefore(item, list.firstChild);
-  } else {
-    list.appendChild(item);
+  list.insertBefore(makeLogLine(line), list.firstChild);
+}
+
+function updateOlderButton() {
+  const container = document.getElementById("logs");
+  if (!container) return;
+  let btn = container.querySelector(".logs-older");
+  const more = logState.nextBefore > logState.firstSeq;
+  if (!more) {
+    if (btn) btn.remove();
+    return;
+  }
+  if (!btn) {
+    btn = document.createElement("button");
+    btn.type = "button";
+    btn.className = "secondary logs-older";
+    btn.textContent = "Load older";
+    btn.addEventListener("click", loadOlderLogs);
+    container.appendChild(btn);
   }
 }
 
+async function fetchLogPage(query) {
+  const resp = await fetch(`/api/logs?limit=${LOG_PAGE}&${query}`);
+  if (!resp.ok) throw new Error("HTTP " + resp.status);
+  const data = await resp.json();
+  logState.firstSeq = data.first_seq;
+  if (!data.time_synced) {
+    syncTimeFromDevice();
+  }
+  return data;
+}
+
 async function loadLogs() {
   const container = document.getElementById("logs");
   if (!container) return;
@@ -28,36 +79,28 @@ async function loadLogs() {
   container.textContent = "Loading…";
 
   try {
-    const resp = await fetch("/api/logs");
-    if (!resp.ok) throw new Error("HTTP " + resp.status);
-
-    const data = await resp.json();
-    const lines = data.logs.split("\n").filter(line => line.trim().length > 0);
+    const data = await fetchLogPage("");
 
     container.innerHTML = "";
 
-    if (lines.length === 0) {
+    if (data.entries.length === 0) {
       const p = document.createElement("p");
       p.className = "muted";
       p.textContent = "No log entries yet.";
       container.appendChild(p);
+      logState.newestSeq = data.last_seq;
+      logState.nextBefore = 0;
       return;
     }
 
-    const list = document.createElement("div");
-    list.className = "logs-list";
-
-    for (const line of lines) {
-      const item = document.createElement("pre");
-      item.className = "log-line";
-      item.textContent = line;
-      list.appendChild(item);
-    }
-
-    container.appendChild(list);
-    if (!data.time_synced) {
-      syncTimeFromDevice();
+    const list = getLogList();
+    // Entries arrive oldest first
+    for (const e of data.entries) {
+      list.insertBefore(makeLogLine(e.text), list.firstChild);
     }
+    logState.newestSeq = data.entries[data.entries.length - 1].seq;
+    logState.nextBefore = data.next_before;
+    updateOlderButton();
 
   } catch (err) {
     console.error("Failed to load logs:", err);
@@ -69,18 +112,67 @@ async function loadLogs() {
   }
 }
 
+async function loadOlderLogs() {
+  if (logState.loadingOlder || logState.nextBefore <= logState.firstSeq) return;
+  logState.loadingOlder = true;
+  try {
+    const data = await fetchLogPage(`before=${logState.nextBefore}`);
+    const list = getLogList();
+    // Oldest first in the page, so walk it backwards onto the end
+    for (let i = data.entries.length - 1; i >= 0; --i) {
+      list.appendChild(makeLogLine(data.entries[i].text));
+    }
+    logState.nextBefore = data.next_before;
+    updateOlderButton();
+  } catch (err) {
+    console.error("Failed to load older logs:", err);
+  } finally {
+    logState.loadingOlder = false;
+  }
+}
+
+async function catchUpLogs() {
+  // Entries logged while the WebSocket was disconnected
+  try {
+    for (;;) {
+      const data = await fetchLogPage(`after=${logState.newestSeq}`);
+      for (const e of data.entries) {
+        appendLogLine(e.seq, e.text);
+      }
+      if (data.entries.length < LOG_PAGE) break;
+    }
+  } catch (err) {
+    console.error("Failed to catch up logs:", err);
+  }
+}
+
+function setupLogScroll() {
+  const container = document.getElementById("logs");
+  if (!container) return;
+  container.addEventListener("scroll", () => {
+    if (container.scrollTop + container.clientHeight >= container.scrollHeight - 40) {
+      loadOlderLogs();
+    }
+  });
+}
+
 function setupLogWebSocket() {
   const protocol = (location.protocol === "https:") ? "wss:" : "ws:";
   const wsUrl = `${protocol}//${location.host}/ws`;
   const navTemp = document.getElementById("navTemp");
 
   let ws;
+  let connectedBefore = false;
 
   function connect() {
     ws = new WebSocket(wsUrl);
 
     ws.addEventListener("open", () => {
       console.log("[WS] Connected");
+      if (connectedBefore && logState.newestSeq) {
+        catchUpLogs();
+      }
+      connectedBefore = true;
     });
 
     ws.addEventListener("close", () => {
@@ -97,7 +189,7 @@ function setupLogWebSocket() {
       try {
         const data = JSON.parse(event.data);
         if (data.type === "log_append" && data.line) {
-          appendLogLine(data.line);
+          appendLogLine(data.seq, data.line);
         } else if (data.type === "temp_update" && navTemp && typeof data.temp === "number") {
           const t = data.temp;
           navTemp.textContent = `${t.toFixed(1)}°`;
@@ -151,5 +243,6 @@ async function syncTimeFromDevice() {
 
 document.addEventListener("DOMContentLoaded", () => {
   loadLogs();
+  setupLogScroll();
   setupLogWebSocket();
 });